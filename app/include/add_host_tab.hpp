@@ -10,6 +10,7 @@
 #include <borealis.hpp>
 #include "Settings.hpp"
 #include "GameStreamClient.hpp"
+#include "RequestExecutor.hpp"
 
 class AddHostTab : public brls::Box
 {
@@ -27,6 +28,7 @@ class AddHostTab : public brls::Box
     static void pauseSearching();
     static void startSearching();
     brls::Event<GSResult<std::vector<Host>>>::Subscription searchSubscription;
+    RequestToken requestToken;
 
     bool searchBoxIpExists(const std::string& ip);
     
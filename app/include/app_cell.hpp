@@ -15,6 +15,10 @@ using namespace brls;
 class AppCell : public Box {
   public:
     AppCell(const Host& host, const AppInfo& app, int currentApp);
+    ~AppCell() override;
+
+    void draw(NVGcontext* vg, float x, float y, float width, float height,
+              Style style, FrameContext* ctx) override;
 
     BRLS_BIND(Image, image, "image");
     BRLS_BIND(Label, title, "title");
@@ -25,5 +29,8 @@ class AppCell : public Box {
     void setFavorite(bool favorite);
 
   private:
+    bool boxartPending = false;
+    bool boxartPrioritized = false;
+
     void updateFavoriteAction(Host host, AppInfo app);
 };
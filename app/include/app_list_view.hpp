@@ -13,6 +13,7 @@
 #include <Settings.hpp>
 #include <borealis.hpp>
 #include "GameStreamClient.hpp"
+#include "RequestExecutor.hpp"
 
 #include <optional>
 
@@ -32,6 +33,7 @@ class AppListView : public Box {
     bool loading = false;
     bool inputBlocked = false;
     LoadingOverlay* loader = nullptr;
+    RequestToken requestToken;
     void blockInput(bool block);
 
     GridView* gridView;
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <HostMonitor.hpp>
 #include <Settings.hpp>
 #include <borealis.hpp>
 
@@ -15,6 +16,7 @@ enum HostState { FETCHING, AVAILABLE, UNAVAILABLE };
 class HostTab : public brls::Box {
   public:
     HostTab(const Host& host);
+    ~HostTab() override;
     void reloadHost();
 
     BRLS_BIND(brls::DetailCell, connect, "connect");
@@ -22,6 +24,9 @@ class HostTab : public brls::Box {
     BRLS_BIND(brls::Header, header, "header");
 
   private:
+    void updateState(const HostStatusInfo& hostState);
+
     Host host;
     HostState state = HostState::FETCHING;
+    brls::Event<HostStatusInfo>::Subscription statusSubscription;
 };
@@ -15,8 +15,14 @@ class LoadingOverlay : brls::Box {
 
     void layout();
     void setHidden(bool hide);
+    void setStatus(const std::string& status);
+
+    [[nodiscard]] bool isHidden() const { return hidden; }
 
   private:
     Box* holder = nullptr;
+    bool hidden = false;
+    std::string status;
     BRLS_BIND(brls::ProgressSpinner, progress, "progress");
+    BRLS_BIND(brls::Label, statusLabel, "status");
 };
@@ -15,11 +15,15 @@
 #include <optional>
 #include "GameStreamClient.hpp"
 #include "MoonlightSession.hpp"
+#include "RequestExecutor.hpp"
 #include "two_finger_scroll_recognizer.hpp"
 
 class StreamingView : public brls::Box {
   public:
     StreamingView(const Host& host, const AppInfo& app);
+
+    // Plays a session recording back, no host is contacted
+    StreamingView(const std::string& replayFile, bool replayFast);
     ~StreamingView();
 
     void draw(NVGcontext* vg, float x, float y, float width, float height,
@@ -39,8 +43,11 @@ class StreamingView : public brls::Box {
   private:
     Host host;
     AppInfo app;
+    std::string replayFile;
+    bool replayFast = false;
     MoonlightSession* session = nullptr;
     LoadingOverlay* loader = nullptr;
+    RequestToken requestToken;
     Box* keyboardHolder = nullptr;
     KeyboardView* keyboard = nullptr;
     bool blocked = false;
@@ -52,6 +59,9 @@ class StreamingView : public brls::Box {
     bool m_use_hdr = false;
     TwoFingerScrollGestureRecognizer* scrollTouchRecognizer = nullptr;
 
+    void setup();
+    void startStream();
+    void startReplay();
     void handleInput();
     void handleOverlayCombo();
     void handleMouseInputCombo();
@@ -182,13 +182,15 @@ void AddHostTab::connectHost(const std::string& address) {
                                     });
                                 }
                             });
-                        });
+                        },
+                        &requestToken);
                 } else {
                     showError(result.error(),
                               [] { AddHostTab::startSearching(); });
                 }
             });
-        });
+        },
+        true, &requestToken);
 }
 
 void AddHostTab::pauseSearching() {
@@ -210,6 +212,8 @@ AddHostTab::~AddHostTab() {
         searchSubscription);
 #elif defined(PLATFORM_IOS) || defined(PLATFORM_TVOS)
     darwin_mdns_stop();
+#else
+    GameStreamClient::stop_finding_hosts();
 #endif
 }
 
@@ -6,6 +6,7 @@
 //
 
 #include "app_cell.hpp"
+#include "BoxArtFetcher.hpp"
 #include "BoxArtManager.hpp"
 #include "Settings.hpp"
 #include "streaming_view.hpp"
@@ -38,21 +39,38 @@ AppCell::AppCell(const Host& host, const AppInfo& app, int currentApp) {
         image->setImageFromFile(
             BoxArtManager::get_texture_path(app.app_id));
     else {
+        boxartPending = true;
+
         ASYNC_RETAIN
-        GameStreamClient::instance().app_boxart(
-            host.address, app.app_id, [ASYNC_TOKEN, host, app](auto result) {
+        BoxArtFetcher::instance().fetch(
+            host.address, app.app_id, this, [ASYNC_TOKEN, app](auto result) {
                 ASYNC_RELEASE
 
-                if (result.isSuccess()) {
-                    BoxArtManager::instance().set_data(result.value(),
-                                                       app.app_id);
+                boxartPending = false;
+                if (result.isSuccess())
                     image->setImageFromFile(
                         BoxArtManager::get_texture_path(app.app_id));
-                }
             });
     }
 }
 
+AppCell::~AppCell() {
+    if (boxartPending)
+        BoxArtFetcher::instance().cancel(this);
+}
+
+void AppCell::draw(NVGcontext* vg, float x, float y, float width,
+                   float height, Style style, FrameContext* ctx) {
+    // Made it on screen, fetch its boxart before the ones further down
+    if (boxartPending && !boxartPrioritized && y + height > 0 &&
+        y < Application::contentHeight) {
+        boxartPrioritized = true;
+        BoxArtFetcher::instance().prioritize(this);
+    }
+
+    Box::draw(vg, x, y, width, height, style, ctx);
+}
+
 void AppCell::setFavorite(bool favorite) {
     favoriteAppImage->setVisibility(favorite ? Visibility::VISIBLE
                                              : Visibility::GONE);
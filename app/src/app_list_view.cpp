@@ -104,7 +104,8 @@ void AppListView::terninateApp() {
                     showError(result.error(), [this] {});
 
                 updateAppList();
-            });
+            },
+            &requestToken);
     });
 
     dialog->open();
@@ -178,12 +179,14 @@ void AppListView::updateAppList() {
                             showError(result.error(),
                                       [this] { this->dismiss(); });
                         }
-                    });
+                    },
+                    &requestToken);
             } else {
                 blockInput(false);
                 showError(result.error(), [this] { this->dismiss(); });
             }
-        });
+        },
+        true, &requestToken);
 }
 
 void AppListView::setCurrentApp(const AppInfo& app) {
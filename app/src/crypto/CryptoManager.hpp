@@ -5,11 +5,13 @@
 
 #include "OpenSSLCryptoManager.hpp"
 #define CryptoManager OpenSSLCryptoManager
+#define CRYPTO_BACKEND "OpenSSL"
 
 #elif defined(USE_MBEDTLS_CRYPTO)
 
 #include "MbedTLSCryptoManager.hpp"
 #define CryptoManager MbedTLSCryptoManager
+#define CRYPTO_BACKEND "mbedTLS"
 
 #else
 #error Select crypto!
@@ -1,110 +1,172 @@
 #include "Data.hpp"
 #include <borealis.hpp>
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
+#include <new>
 #include <string.h>
 
-Data::Data(unsigned char* bytes, size_t size) {
-    if (bytes && size > 0) {
-        m_bytes = (unsigned char*)malloc(size + 1);
-        m_bytes[size] = '\0';
-        memcpy(m_bytes, bytes, size);
-        m_size = size;
+// The bytes follow the header in the same allocation
+struct Data::Buffer {
+    std::atomic<size_t> references;
+    size_t capacity;
+
+    unsigned char* bytes() { return (unsigned char*)(this + 1); }
+
+    // One reference for the caller, room for the '\0' after capacity
+    static Buffer* allocate(size_t capacity) {
+        void* memory = ::operator new(sizeof(Buffer) + capacity + 1);
+        return new (memory) Buffer{{1}, capacity};
     }
-}
 
-Data::Data(size_t capacity) {
-    m_bytes = (unsigned char*)malloc(capacity + 1);
-    memset(m_bytes, 0, capacity + 1);
-    m_bytes[capacity] = '\0';
-    m_size = capacity;
-}
+    static void free(Buffer* buffer) {
+        buffer->~Buffer();
+        ::operator delete(buffer);
+    }
+};
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+// Value of every hex digit, -1 for anything else
+struct HexTable {
+    signed char values[256];
 
-Data::~Data() {
-    if (m_bytes) {
-        free(m_bytes);
+    constexpr HexTable() : values() {
+        for (int i = 0; i < 256; i++)
+            values[i] = -1;
+        for (int i = 0; i < 10; i++)
+            values['0' + i] = (signed char)i;
+        for (int i = 0; i < 6; i++) {
+            values['A' + i] = (signed char)(10 + i);
+            values['a' + i] = (signed char)(10 + i);
+        }
     }
-}
+};
 
-Data Data::subdata(size_t start, size_t size) {
-    if (start + size > m_size) {
-        brls::Logger::error("Data: Invalid data length...");
-        exit(-1);
+static constexpr HexTable hex_table;
+
+Data::Data(Buffer* buffer, const unsigned char* bytes, size_t size)
+    : m_buffer(buffer), m_bytes(bytes), m_size(size) {}
+
+Data::Data(const unsigned char* bytes, size_t size) {
+    if (bytes && size > 0) {
+        m_buffer = Buffer::allocate(size);
+        memcpy(m_buffer->bytes(), bytes, size);
+        m_buffer->bytes()[size] = '\0';
+        m_bytes = m_buffer->bytes();
+        m_size = size;
     }
-    return Data(&m_bytes[start], size);
 }
 
-Data Data::append(Data other) {
-    if (is_empty()) {
-        return other;
+Data::Data(size_t size) {
+    if (size > 0) {
+        m_buffer = Buffer::allocate(size);
+        memset(m_buffer->bytes(), 0, size + 1);
+        m_bytes = m_buffer->bytes();
+        m_size = size;
     }
+}
 
-    Data data(m_size + other.m_size);
-    memcpy(data.m_bytes, m_bytes, m_size);
-    memcpy(&data.m_bytes[m_size], other.m_bytes, other.m_size);
-    return data;
+void Data::release() {
+    if (m_buffer &&
+        m_buffer->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        Buffer::free(m_buffer);
+    m_buffer = nullptr;
+    m_bytes = nullptr;
+    m_size = 0;
 }
 
-Data::Data(const Data& that) : Data(0) {
-    if (m_bytes) {
-        free(m_bytes);
-    }
+Data::Data(const Data& that)
+    : m_buffer(that.m_buffer), m_bytes(that.m_bytes), m_size(that.m_size) {
+    if (m_buffer)
+        m_buffer->references.fetch_add(1, std::memory_order_relaxed);
+}
 
-    m_bytes = (unsigned char*)malloc(that.size() + 1);
-    memcpy(m_bytes, that.m_bytes, that.m_size);
-    m_bytes[that.m_size] = '\0';
-    m_size = that.m_size;
+Data::Data(Data&& that) noexcept
+    : m_buffer(that.m_buffer), m_bytes(that.m_bytes), m_size(that.m_size) {
+    that.m_buffer = nullptr;
+    that.m_bytes = nullptr;
+    that.m_size = 0;
 }
 
 Data& Data::operator=(const Data& that) {
     if (this != &that) {
-        if (m_bytes) {
-            free(m_bytes);
-        }
+        if (that.m_buffer)
+            that.m_buffer->references.fetch_add(1, std::memory_order_relaxed);
+        release();
+        m_buffer = that.m_buffer;
+        m_bytes = that.m_bytes;
+        m_size = that.m_size;
+    }
+    return *this;
+}
 
-        m_bytes = (unsigned char*)malloc(that.m_size + 1);
-        memcpy(m_bytes, that.m_bytes, that.m_size);
-        m_bytes[that.m_size] = '\0';
+Data& Data::operator=(Data&& that) noexcept {
+    if (this != &that) {
+        release();
+        m_buffer = that.m_buffer;
+        m_bytes = that.m_bytes;
         m_size = that.m_size;
+        that.m_buffer = nullptr;
+        that.m_bytes = nullptr;
+        that.m_size = 0;
     }
     return *this;
 }
 
+Data Data::subdata(size_t start, size_t size) const {
+    if (start + size > m_size) {
+        brls::Logger::error("Data: Invalid data length...");
+        exit(-1);
+    }
+    if (size == 0)
+        return Data();
+
+    m_buffer->references.fetch_add(1, std::memory_order_relaxed);
+    return Data(m_buffer, m_bytes + start, size);
+}
+
+Data Data::append(const Data& other) const {
+    if (is_empty())
+        return other;
+    if (other.is_empty())
+        return *this;
+
+    return Builder(m_size + other.m_size).append(*this).append(other).build();
+}
+
 Data Data::random_bytes(size_t size) {
-    unsigned char* bytes = (unsigned char*)malloc(sizeof(char) * size);
+    Data random_data(size);
+    unsigned char* bytes = random_data.m_buffer ? random_data.m_buffer->bytes()
+                                                : nullptr;
 
 #ifndef _WIN32
     srand(time(NULL));
 #endif
 
-    for (int i = 0; i < size; i++) {
+    for (size_t i = 0; i < size; i++) {
         bytes[i] = rand() % 255;
     }
-
-    Data random_data(size);
-    memcpy(random_data.m_bytes, bytes, size);
-    free(bytes);
     return random_data;
 }
 
-Data Data::read_from_file(std::string path) {
-    FILE* f = fopen(path.c_str(), "r");
+Data Data::read_from_file(const std::string& path) {
+    FILE* f = fopen(path.c_str(), "rb");
     if (f) {
         fseek(f, 0, SEEK_END);
-        int size = (int)ftell(f);
+        long size = ftell(f);
         fseek(f, 0, SEEK_SET);
 
-        char* buffer = (char*)malloc(size);
-        fread(buffer, 1, size, f);
-
-        Data data(buffer, size);
-        free(buffer);
+        Data data(size > 0 ? (size_t)size : 0);
+        if (data.m_buffer)
+            data.m_size = fread(data.m_buffer->bytes(), 1, size, f);
         fclose(f);
-        return data;
+        return data.m_size > 0 ? data : Data();
     }
     return Data();
 }
 
-void Data::write_to_file(std::string path) {
+void Data::write_to_file(const std::string& path) const {
     FILE* f = fopen(path.c_str(), "w");
     if (f) {
         fwrite(m_bytes, m_size, 1, f);
@@ -114,17 +176,18 @@ void Data::write_to_file(std::string path) {
     }
 }
 
+// Anything but a hex digit counts as 0, an odd last digit is dropped
 Data Data::hex_to_bytes() const {
     Data data(m_size / 2);
-    char byte_chars[3] = {'\0', '\0', '\0'};
-    unsigned long whole_byte;
+    if (!data.m_buffer)
+        return data;
 
-    int i = 0, counter = 0;
-    while (i < m_size) {
-        byte_chars[0] = m_bytes[i++];
-        byte_chars[1] = m_bytes[i++];
-        whole_byte = strtoul(byte_chars, NULL, 16);
-        data.m_bytes[counter++] = whole_byte;
+    unsigned char* bytes = data.m_buffer->bytes();
+    for (size_t i = 0; i < data.m_size; i++) {
+        signed char high = hex_table.values[m_bytes[i * 2]];
+        signed char low = hex_table.values[m_bytes[i * 2 + 1]];
+        bytes[i] = (unsigned char)((high < 0 ? 0 : high) << 4 |
+                                   (low < 0 ? 0 : low));
     }
     return data;
 }
@@ -135,14 +198,62 @@ Data Data::hex() const {
         return Data(&end, 1);
     }
 
-    int counter = 0;
-    Data hex(m_size * 2);
-    char fmt[3] = {'\0', '\0', '\0'};
-    for (int i = 0; i < m_size; i++) {
-        sprintf(fmt, "%02X", m_bytes[i]);
-        hex.m_bytes[counter++] = fmt[0];
-        hex.m_bytes[counter++] = fmt[1];
+    Buffer* buffer = Buffer::allocate(m_size * 2);
+    unsigned char* hex = buffer->bytes();
+    for (size_t i = 0; i < m_size; i++) {
+        hex[i * 2] = hex_digits[m_bytes[i] >> 4];
+        hex[i * 2 + 1] = hex_digits[m_bytes[i] & 0xF];
+    }
+    hex[m_size * 2] = '\0';
+    return Data(buffer, hex, m_size * 2);
+}
+
+Data::Builder::Builder(size_t capacity) {
+    if (capacity > 0)
+        reserve(capacity);
+}
+
+Data::Builder::~Builder() {
+    if (m_buffer)
+        Buffer::free(m_buffer);
+}
+
+// The builder holds the only reference, so the buffer can move
+void Data::Builder::reserve(size_t capacity) {
+    if (m_buffer && m_buffer->capacity >= capacity)
+        return;
+
+    Buffer* buffer = Buffer::allocate(capacity);
+    if (m_buffer) {
+        memcpy(buffer->bytes(), m_buffer->bytes(), m_size);
+        Buffer::free(m_buffer);
+    }
+    m_buffer = buffer;
+}
+
+unsigned char* Data::Builder::extend(size_t size) {
+    if (!m_buffer || m_size + size > m_buffer->capacity) {
+        size_t grown = m_buffer ? m_buffer->capacity * 2 : 0;
+        reserve(std::max(m_size + size, grown));
     }
-    hex.m_bytes[m_size * 2] = '\0';
-    return hex;
+    unsigned char* bytes = m_buffer->bytes() + m_size;
+    m_size += size;
+    return bytes;
+}
+
+Data::Builder& Data::Builder::append(const unsigned char* bytes, size_t size) {
+    if (size > 0)
+        memcpy(extend(size), bytes, size);
+    return *this;
+}
+
+Data Data::Builder::build() {
+    if (m_size == 0)
+        return Data();
+
+    m_buffer->bytes()[m_size] = '\0';
+    Data data(m_buffer, m_buffer->bytes(), m_size);
+    m_buffer = nullptr;
+    m_size = 0;
+    return data;
 }
@@ -2,35 +2,85 @@
 #include <string>
 #pragma once
 
+// Bytes in a reference counted buffer. Copies and subdata() share the
+// buffer instead of copying it, which is safe as a buffer never changes
+// once a Data holds it. A whole buffer ends with a '\0' past size(), so
+// hex() results and files can go on as C strings; a subdata() view of the
+// middle of one can't.
 class Data {
+    struct Buffer;
+
   public:
-    Data() : Data(0){};
-    Data(unsigned char* bytes, size_t size);
-    Data(char* bytes, size_t size) : Data((unsigned char*)bytes, size){};
-    Data(size_t capacity);
+    Data() = default;
+    Data(const unsigned char* bytes, size_t size);
+    Data(const char* bytes, size_t size)
+        : Data((const unsigned char*)bytes, size){};
+    // size zeroed bytes
+    explicit Data(size_t size);
 
-    ~Data();
+    ~Data() { release(); }
 
-    unsigned char* bytes() const { return m_bytes; }
+    Data(const Data& that);
+    Data(Data&& that) noexcept;
+    Data& operator=(const Data& that);
+    Data& operator=(Data&& that) noexcept;
 
-    size_t size() const { return m_size; }
+    const unsigned char* bytes() const {
+        return m_bytes ? m_bytes : (const unsigned char*)"";
+    }
 
-    Data subdata(size_t start, size_t size);
-    Data append(Data other);
+    size_t size() const { return m_size; }
 
-    Data(const Data& that);
-    Data& operator=(const Data& that);
+    Data subdata(size_t start, size_t size) const;
+    // Several appends in a row go faster with a Builder
+    Data append(const Data& other) const;
 
     static Data random_bytes(size_t size);
-    static Data read_from_file(std::string path);
-    void write_to_file(std::string path);
+    static Data read_from_file(const std::string& path);
+    void write_to_file(const std::string& path) const;
 
     Data hex_to_bytes() const;
     Data hex() const;
 
     bool is_empty() const { return m_size == 0; }
 
+    // Appends into one growing buffer, build() hands it to a Data without
+    // copying it
+    class Builder {
+      public:
+        explicit Builder(size_t capacity = 0);
+        ~Builder();
+
+        Builder(const Builder&) = delete;
+        Builder& operator=(const Builder&) = delete;
+
+        Builder& append(const unsigned char* bytes, size_t size);
+        Builder& append(const Data& data) {
+            return append(data.bytes(), data.size());
+        }
+        // Appends size bytes for the caller to write into, valid until the
+        // next append
+        unsigned char* extend(size_t size);
+
+        size_t size() const { return m_size; }
+        void clear() { m_size = 0; }
+
+        // Leaves the builder empty
+        Data build();
+
+      private:
+        void reserve(size_t capacity);
+
+        Buffer* m_buffer = nullptr;
+        size_t m_size = 0;
+    };
+
   private:
-    unsigned char* m_bytes = nullptr;
+    Data(Buffer* buffer, const unsigned char* bytes, size_t size);
+
+    void release();
+
+    Buffer* m_buffer = nullptr;
+    const unsigned char* m_bytes = nullptr;
     size_t m_size = 0;
 };
@@ -10,6 +10,7 @@
 #include <mbedtls/sha256.h>
 #include <mbedtls/x509.h>
 #include <mbedtls/x509_crt.h>
+#include <algorithm>
 #include <string.h>
 
 static Data m_cert;
@@ -59,7 +60,7 @@ Data MbedTLSCryptoManager::cert_data() { return m_cert; }
 
 Data MbedTLSCryptoManager::key_data() { return m_key; }
 
-Data MbedTLSCryptoManager::SHA1_hash_data(Data data) {
+Data MbedTLSCryptoManager::SHA1_hash_data(const Data& data) {
     mbedtls_sha1_context ctx;
     unsigned char sha1[20];
     mbedtls_sha1_init(&ctx);
@@ -68,7 +69,7 @@ Data MbedTLSCryptoManager::SHA1_hash_data(Data data) {
     return Data(sha1, sizeof(sha1));
 }
 
-Data MbedTLSCryptoManager::SHA256_hash_data(Data data) {
+Data MbedTLSCryptoManager::SHA256_hash_data(const Data& data) {
     mbedtls_sha256_context ctx;
     unsigned char sha256[32];
     mbedtls_sha256_init(&ctx);
@@ -77,65 +78,64 @@ Data MbedTLSCryptoManager::SHA256_hash_data(Data data) {
     return Data(sha256, sizeof(sha256));
 }
 
-Data MbedTLSCryptoManager::create_AES_key_from_salt_SHA1(Data salted_pin) {
+Data MbedTLSCryptoManager::create_AES_key_from_salt_SHA1(
+    const Data& salted_pin) {
     return SHA1_hash_data(salted_pin).subdata(0, 16);
 }
 
-Data MbedTLSCryptoManager::create_AES_key_from_salt_SHA256(Data salted_pin) {
+Data MbedTLSCryptoManager::create_AES_key_from_salt_SHA256(
+    const Data& salted_pin) {
     return SHA256_hash_data(salted_pin).subdata(0, 16);
 }
 
-static int get_encrypt_size(Data data) {
+static int get_encrypt_size(const Data& data) {
     // the size is the length of the data ceiling to the nearest 16 bytes
     return (((int)data.size() + 15) / 16) * 16;
 }
 
-Data MbedTLSCryptoManager::aes_encrypt(Data data, Data key) {
+Data MbedTLSCryptoManager::aes_encrypt(const Data& data, const Data& key) {
     mbedtls_aes_context ctx;
     mbedtls_aes_init(&ctx);
     mbedtls_aes_setkey_enc(&ctx, key.bytes(), 128);
 
     int size = get_encrypt_size(data);
-    unsigned char* buffer = (unsigned char*)malloc(size);
-    unsigned char* block_rounded_buffer = (unsigned char*)calloc(1, size);
-    memcpy(block_rounded_buffer, data.bytes(), data.size());
-
-    int block_offset = 0;
-    while (block_offset < size) {
-        mbedtls_aes_crypt_ecb(&ctx, MBEDTLS_AES_ENCRYPT,
-                              block_rounded_buffer + block_offset,
+    Data::Builder encrypted(size);
+    unsigned char* buffer = encrypted.extend(size);
+
+    // The last block gets padded with zeros
+    for (int block_offset = 0; block_offset < size; block_offset += 16) {
+        unsigned char block[16] = {};
+        memcpy(block, data.bytes() + block_offset,
+               std::min<size_t>(16, data.size() - block_offset));
+        mbedtls_aes_crypt_ecb(&ctx, MBEDTLS_AES_ENCRYPT, block,
                               buffer + block_offset);
-        block_offset += 16;
     }
 
-    Data encrypted_data = Data((char*)buffer, size);
     mbedtls_aes_free(&ctx);
-    free(buffer);
-    free(block_rounded_buffer);
-    return encrypted_data;
+    return encrypted.build();
 }
 
-Data MbedTLSCryptoManager::aes_decrypt(Data data, Data key) {
+// A partial block at the end can't be decrypted and is dropped
+Data MbedTLSCryptoManager::aes_decrypt(const Data& data, const Data& key) {
     mbedtls_aes_context ctx;
     mbedtls_aes_init(&ctx);
     mbedtls_aes_setkey_dec(&ctx, key.bytes(), 128);
-    unsigned char* buffer = (unsigned char*)malloc(data.size());
 
-    int block_offset = 0;
-    while (block_offset < data.size()) {
+    size_t size = data.size() / 16 * 16;
+    Data::Builder decrypted(size);
+    unsigned char* buffer = decrypted.extend(size);
+
+    for (size_t block_offset = 0; block_offset < size; block_offset += 16) {
         mbedtls_aes_crypt_ecb(&ctx, MBEDTLS_AES_DECRYPT,
                               data.bytes() + block_offset,
                               buffer + block_offset);
-        block_offset += 16;
     }
 
-    Data decrypted_data = Data(buffer, data.size());
     mbedtls_aes_free(&ctx);
-    free(buffer);
-    return decrypted_data;
+    return decrypted.build();
 }
 
-Data MbedTLSCryptoManager::signature(Data cert) {
+Data MbedTLSCryptoManager::signature(const Data& cert) {
     mbedtls_x509_crt x509;
     mbedtls_x509_crt_init(&x509);
 
@@ -146,13 +146,14 @@ Data MbedTLSCryptoManager::signature(Data cert) {
     return data;
 }
 
-bool MbedTLSCryptoManager::verify_signature(Data data, Data signature,
-                                            Data cert) {
+bool MbedTLSCryptoManager::verify_signature(const Data& data,
+                                            const Data& signature,
+                                            const Data& cert) {
     // TODO
     return true;
 }
 
-Data MbedTLSCryptoManager::sign_data(Data data, Data key) {
+Data MbedTLSCryptoManager::sign_data(const Data& data, const Data& key) {
     mbedtls_pk_context pk;
     mbedtls_entropy_context entropy;
     mbedtls_ctr_drbg_context ctr_drbg;
@@ -3,8 +3,10 @@
 #include "OpenSSLCryptoManager.hpp"
 #include "Settings.hpp"
 //#include "Logger.hpp"
+#include <algorithm>
 #include <string.h>
 #include <cstdlib>
+#include <mutex>
 #include <openssl/aes.h>
 #include <openssl/sha.h>
 #include <openssl/x509.h>
@@ -15,32 +17,107 @@
 static Data m_cert;
 static Data m_key;
 
+// Guards the pair and what got parsed out of it, pairing runs on request
+// workers while the pair may still be getting generated at launch
+static std::mutex m_mutex;
+
+// Certificates and keys get parsed once rather than on every call. Ours
+// stay, other ones share a slot, which holds the host's during pairing.
+struct ParsedCert {
+    Data pem;
+    X509* x509 = nullptr;
+};
+
+static ParsedCert m_own_cert;
+static ParsedCert m_other_cert;
+static Data m_parsed_key_pem;
+static EVP_PKEY* m_parsed_key = nullptr;
+
 static const int NUM_BITS = 2048;
 static const int SERIAL = 0;
 static const int NUM_YEARS = 10;
 
-static bool _generate_new_cert_key_pair();
+static bool _generate_new_cert_key_pair(Data* cert, Data* key);
+
+static bool same_bytes(const Data& a, const Data& b) {
+    return a.size() == b.size() &&
+        (a.bytes() == b.bytes() || memcmp(a.bytes(), b.bytes(), a.size()) == 0);
+}
+
+// Callers hold m_mutex
+static X509* parsed_cert(const Data& cert) {
+    ParsedCert& parsed = same_bytes(cert, m_cert) ? m_own_cert : m_other_cert;
+    if (parsed.x509 && same_bytes(parsed.pem, cert))
+        return parsed.x509;
+    
+    X509_free(parsed.x509);
+    BIO* bio = BIO_new_mem_buf(cert.bytes(), (int)cert.size());
+    parsed.x509 = PEM_read_bio_X509(bio, NULL, NULL, NULL);
+    BIO_free(bio);
+    
+    parsed.pem = parsed.x509 ? cert : Data();
+    return parsed.x509;
+}
+
+// Callers hold m_mutex
+static EVP_PKEY* parsed_key(const Data& key) {
+    if (m_parsed_key && same_bytes(m_parsed_key_pem, key))
+        return m_parsed_key;
+    
+    EVP_PKEY_free(m_parsed_key);
+    BIO* bio = BIO_new_mem_buf(key.bytes(), (int)key.size());
+    m_parsed_key = PEM_read_bio_PrivateKey(bio, NULL, NULL, NULL);
+    BIO_free(bio);
+    
+    m_parsed_key_pem = m_parsed_key ? key : Data();
+    return m_parsed_key;
+}
+
+// Callers hold m_mutex. Parsing the new pair right away spares pairing it.
+static void set_cert_key_pair(const Data& cert, const Data& key) {
+    m_cert = cert;
+    m_key = key;
+    
+    X509_free(m_own_cert.x509);
+    m_own_cert = ParsedCert();
+    EVP_PKEY_free(m_parsed_key);
+    m_parsed_key = nullptr;
+    m_parsed_key_pem = Data();
+    
+    if (!m_cert.is_empty() && !m_key.is_empty()) {
+        parsed_cert(m_cert);
+        parsed_key(m_key);
+    }
+}
 
 bool OpenSSLCryptoManager::load_cert_key_pair() {
-    if (m_key.is_empty() || m_cert.is_empty()) {
-        Data cert = Data::read_from_file(Settings::instance().key_dir() + "/" + CERTIFICATE_FILE_NAME);
-        Data key = Data::read_from_file(Settings::instance().key_dir() + "/" + KEY_FILE_NAME);
-        
-        if (!cert.is_empty() && !key.is_empty()) {
-            m_cert = cert;
-            m_key = key;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_key.is_empty() && !m_cert.is_empty())
             return true;
-        }
-        return false;
     }
-    return true;
+    
+    Data cert = Data::read_from_file(Settings::instance().key_dir() + "/" + CERTIFICATE_FILE_NAME);
+    Data key = Data::read_from_file(Settings::instance().key_dir() + "/" + KEY_FILE_NAME);
+    
+    if (!cert.is_empty() && !key.is_empty()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        set_cert_key_pair(cert, key);
+        return true;
+    }
+    return false;
 }
 
+// Generates without holding m_mutex, that takes seconds
 bool OpenSSLCryptoManager::generate_new_cert_key_pair() {
-    if (_generate_new_cert_key_pair()) {
-        if (!m_cert.is_empty() && !m_key.is_empty()) {
-            m_cert.write_to_file(Settings::instance().key_dir() + "/" + CERTIFICATE_FILE_NAME);
-            m_key.write_to_file(Settings::instance().key_dir() + "/" + KEY_FILE_NAME);
+    Data cert, key;
+    if (_generate_new_cert_key_pair(&cert, &key)) {
+        if (!cert.is_empty() && !key.is_empty()) {
+            cert.write_to_file(Settings::instance().key_dir() + "/" + CERTIFICATE_FILE_NAME);
+            key.write_to_file(Settings::instance().key_dir() + "/" + KEY_FILE_NAME);
+            
+            std::lock_guard<std::mutex> lock(m_mutex);
+            set_cert_key_pair(cert, key);
             return true;
         }
     }
@@ -50,84 +127,84 @@ bool OpenSSLCryptoManager::generate_new_cert_key_pair() {
 void OpenSSLCryptoManager::remove_cert_key_pair() {
     remove((Settings::instance().key_dir() + "/" + CERTIFICATE_FILE_NAME).c_str());
     remove((Settings::instance().key_dir() + "/" + KEY_FILE_NAME).c_str());
-    m_cert = Data();
-    m_key = Data();
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    set_cert_key_pair(Data(), Data());
 }
 
 Data OpenSSLCryptoManager::cert_data() {
+    std::lock_guard<std::mutex> lock(m_mutex);
     return m_cert;
 }
 
 Data OpenSSLCryptoManager::key_data() {
+    std::lock_guard<std::mutex> lock(m_mutex);
     return m_key;
 }
 
-Data OpenSSLCryptoManager::SHA1_hash_data(Data data) {
+Data OpenSSLCryptoManager::SHA1_hash_data(const Data& data) {
     unsigned char sha1[20];
     SHA1(data.bytes(), data.size(), sha1);
     return Data(sha1, sizeof(sha1));
 }
 
-Data OpenSSLCryptoManager::SHA256_hash_data(Data data) {
+Data OpenSSLCryptoManager::SHA256_hash_data(const Data& data) {
     unsigned char sha256[32];
     SHA256(data.bytes(), data.size(), sha256);
     return Data(sha256, sizeof(sha256));
 }
 
-Data OpenSSLCryptoManager::create_AES_key_from_salt_SHA1(Data salted_pin) {
+Data OpenSSLCryptoManager::create_AES_key_from_salt_SHA1(const Data& salted_pin) {
     return SHA1_hash_data(salted_pin).subdata(0, 16);
 }
 
-Data OpenSSLCryptoManager::create_AES_key_from_salt_SHA256(Data salted_pin) {
+Data OpenSSLCryptoManager::create_AES_key_from_salt_SHA256(const Data& salted_pin) {
     return SHA256_hash_data(salted_pin).subdata(0, 16);
 }
 
-static int get_encrypt_size(Data data) {
+static int get_encrypt_size(const Data& data) {
     // the size is the length of the data ceiling to the nearest 16 bytes
     return (((int)data.size() + 15) / 16) * 16;
 }
 
-Data OpenSSLCryptoManager::aes_encrypt(Data data, Data key) {
+Data OpenSSLCryptoManager::aes_encrypt(const Data& data, const Data& key) {
     AES_KEY aes_key;
-    AES_set_encrypt_key((unsigned char*)key.bytes(), 128, &aes_key);
+    AES_set_encrypt_key(key.bytes(), 128, &aes_key);
+
     int size = get_encrypt_size(data);
-    unsigned char* buffer = (unsigned char*)malloc(size);
-    unsigned char* block_rounded_buffer = (unsigned char*)calloc(1, size);
-    memcpy(block_rounded_buffer, data.bytes(), data.size());
-    
-    // AES_encrypt only encrypts the first 16 bytes so iterate the entire buffer
-    int block_offset = 0;
-    while (block_offset < size) {
-        AES_encrypt(block_rounded_buffer + block_offset, buffer + block_offset, &aes_key);
-        block_offset += 16;
+    Data::Builder encrypted(size);
+    unsigned char* buffer = encrypted.extend(size);
+
+    // The last block gets padded with zeros
+    for (int block_offset = 0; block_offset < size; block_offset += 16) {
+        unsigned char block[16] = {};
+        memcpy(block, data.bytes() + block_offset,
+               std::min<size_t>(16, data.size() - block_offset));
+        AES_encrypt(block, buffer + block_offset, &aes_key);
     }
-    
-    Data encrypted_data = Data((char*)buffer, size);
-    free(buffer);
-    free(block_rounded_buffer);
-    return encrypted_data;
+
+    return encrypted.build();
 }
 
-Data OpenSSLCryptoManager::aes_decrypt(Data data, Data key) {
+// A partial block at the end can't be decrypted and is dropped
+Data OpenSSLCryptoManager::aes_decrypt(const Data& data, const Data& key) {
     AES_KEY aes_key;
     AES_set_decrypt_key(key.bytes(), 128, &aes_key);
-    unsigned char* buffer = (unsigned char*)malloc(data.size());
-    
-    // AES_decrypt only decrypts the first 16 bytes so iterate the entire buffer
-    int block_offset = 0;
-    while (block_offset < data.size()) {
+
+    size_t size = data.size() / 16 * 16;
+    Data::Builder decrypted(size);
+    unsigned char* buffer = decrypted.extend(size);
+
+    for (size_t block_offset = 0; block_offset < size; block_offset += 16) {
         AES_decrypt(data.bytes() + block_offset, buffer + block_offset, &aes_key);
-        block_offset += 16;
     }
-    
-    Data decrypted_data = Data(buffer, data.size());
-    free(buffer);
-    return decrypted_data;
+
+    return decrypted.build();
 }
 
-Data OpenSSLCryptoManager::signature(Data cert) {
-    BIO* bio = BIO_new_mem_buf(cert.bytes(), cert.size());
-    X509* x509 = PEM_read_bio_X509(bio, NULL, NULL, NULL);
+Data OpenSSLCryptoManager::signature(const Data& cert) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    X509* x509 = parsed_cert(cert);
     
     if (!x509) {
 //        Logger::error("Crypto", "Unable to parse certificate in memory!");
@@ -144,16 +221,12 @@ Data OpenSSLCryptoManager::signature(Data cert) {
     X509_get0_signature(&asn_signature, NULL, x509);
 #endif
     
-    Data sig = Data(asn_signature->data, asn_signature->length);
-    X509_free(x509);
-    return sig;
+    return Data(asn_signature->data, asn_signature->length);
 }
 
-bool OpenSSLCryptoManager::verify_signature(Data data, Data signature, Data cert) {
-    BIO* bio = BIO_new_mem_buf(cert.bytes(), cert.size());
-    X509* x509 = PEM_read_bio_X509(bio, NULL, NULL, NULL);
-    
-    BIO_free(bio);
+bool OpenSSLCryptoManager::verify_signature(const Data& data, const Data& signature, const Data& cert) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    X509* x509 = parsed_cert(cert);
     
     if (!x509) {
 //        Logger::error("Crypto", "Unable to parse certificate in memory...");
@@ -167,17 +240,14 @@ bool OpenSSLCryptoManager::verify_signature(Data data, Data signature, Data cert
     EVP_DigestVerifyUpdate(mdctx, data.bytes(), data.size());
     int result = EVP_DigestVerifyFinal(mdctx, signature.bytes(), signature.size());
     
-    X509_free(x509);
     EVP_PKEY_free(pub_key);
     EVP_MD_CTX_destroy(mdctx);
     return result > 0;
 }
 
-Data OpenSSLCryptoManager::sign_data(Data data, Data key) {
-    BIO* bio = BIO_new_mem_buf(key.bytes(), key.size());
-    EVP_PKEY* pkey = PEM_read_bio_PrivateKey(bio, NULL, NULL, NULL);
-    
-    BIO_free(bio);
+Data OpenSSLCryptoManager::sign_data(const Data& data, const Data& key) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    EVP_PKEY* pkey = parsed_key(key);
     
     if (!pkey) {
 //        Logger::error("Crypto", "Unable to parse private key in memory...");
@@ -192,13 +262,12 @@ Data OpenSSLCryptoManager::sign_data(Data data, Data key) {
     unsigned char* signature = (unsigned char*)malloc(slen);
     int result = EVP_DigestSignFinal(mdctx, signature, &slen);
     
-    EVP_PKEY_free(pkey);
     EVP_MD_CTX_destroy(mdctx);
     
     if (result <= 0) {
         free(signature);
 //        Logger::error("Crypto", "Unable to sign data...");
-        Data();
+        return Data();
     }
     
     Data signed_data = Data(signature, slen);
@@ -236,7 +305,7 @@ static Data _key_data(EVP_PKEY* pk) {
     return data;
 }
 
-static bool _generate_new_cert_key_pair() {
+static bool _generate_new_cert_key_pair(Data* cert_data, Data* key_data) {
 //    CRYPTO_mem_ctrl(CRYPTO_MEM_CHECK_ON);
     BIO *bio_err = BIO_new_fp(stderr, BIO_NOCLOSE);
     
@@ -281,8 +350,8 @@ static bool _generate_new_cert_key_pair() {
     
     BIO_free(bio_err);
     
-    m_cert = _cert_data(cert);
-    m_key = _key_data(pk);
+    *cert_data = _cert_data(cert);
+    *key_data = _key_data(pk);
     
     X509_free(cert);
     EVP_PKEY_free(pk);
@@ -20,7 +20,13 @@ HostTab::HostTab(const Host& host) : host(host) {
     remove->setText("common/remove"_i18n);
     remove->title->setTextColor(RGB(229, 57, 53));
 
-    reloadHost();
+    header->setSubtitle(host.address);
+    updateState(HostMonitor::instance().state(host.address));
+    statusSubscription = HostMonitor::instance().status_event()->subscribe(
+        [this](const HostStatusInfo& hostState) {
+            if (hostState.address == this->host.address)
+                updateState(hostState);
+        });
 
     registerAction("Rename"_i18n, ControllerButton::BUTTON_START,
                    [this](View* view) {
@@ -78,26 +84,34 @@ HostTab::HostTab(const Host& host) : host(host) {
     });
 }
 
+HostTab::~HostTab() {
+    HostMonitor::instance().status_event()->unsubscribe(statusSubscription);
+}
+
 void HostTab::reloadHost() {
     state = FETCHING;
     header->setTitle("host/status"_i18n + ": " + "host/fetching"_i18n);
-    header->setSubtitle(host.address);
     connect->setText("host/wait"_i18n);
 
-    ASYNC_RETAIN
-    GameStreamClient::instance().connect(
-        host.address, [ASYNC_TOKEN](const GSResult<SERVER_DATA>& result) {
-            ASYNC_RELEASE
+    HostMonitor::instance().refresh(host.address);
+}
 
-            if (result.isSuccess()) {
-                header->setTitle("host/status"_i18n + ": " + "host/ready"_i18n);
-                connect->setText("host/connect"_i18n);
-                state = AVAILABLE;
-            } else {
-                header->setTitle("host/status"_i18n + ": " +
-                                 "host/unable"_i18n);
-                connect->setText("host/wake_up"_i18n);
-                state = UNAVAILABLE;
-            }
-        });
+void HostTab::updateState(const HostStatusInfo& hostState) {
+    switch (hostState.status) {
+    case HOST_STATUS_UNKNOWN:
+        state = FETCHING;
+        header->setTitle("host/status"_i18n + ": " + "host/fetching"_i18n);
+        connect->setText("host/wait"_i18n);
+        break;
+    case HOST_STATUS_ONLINE:
+        state = AVAILABLE;
+        header->setTitle("host/status"_i18n + ": " + "host/ready"_i18n);
+        connect->setText("host/connect"_i18n);
+        break;
+    case HOST_STATUS_OFFLINE:
+        state = UNAVAILABLE;
+        header->setTitle("host/status"_i18n + ": " + "host/unable"_i18n);
+        connect->setText("host/wake_up"_i18n);
+        break;
+    }
 }
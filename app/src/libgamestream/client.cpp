@@ -28,7 +28,9 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
-#include <sstream>
+#include <atomic>
+#include <future>
+#include <mutex>
 
 #define CHANNEL_COUNT_STEREO 2
 #define CHANNEL_COUNT_51_SURROUND 6
@@ -57,19 +59,79 @@ int extractVersionQuadFromString(const char* string, int* quad) {
     return 0;
 }
 
+_SERVER_DATA::_SERVER_DATA(const _SERVER_DATA& other) { *this = other; }
+
+_SERVER_DATA& _SERVER_DATA::operator=(const _SERVER_DATA& other) {
+    if (this == &other)
+        return *this;
+
+    address = other.address;
+    connectAddress = other.connectAddress;
+    serverInfoAppVersion = other.serverInfoAppVersion;
+    serverInfoGfeVersion = other.serverInfoGfeVersion;
+    mac = other.mac;
+    gpuType = other.gpuType;
+    paired = other.paired;
+    supports4K = other.supports4K;
+    currentGame = other.currentGame;
+    serverMajorVersion = other.serverMajorVersion;
+    gsVersion = other.gsVersion;
+    hostname = other.hostname;
+    serverInfo = other.serverInfo;
+    httpPort = other.httpPort;
+    httpsPort = other.httpsPort;
+
+    if (other.serverInfo.address)
+        serverInfo.address = connectAddress.c_str();
+    if (other.serverInfo.serverInfoAppVersion)
+        serverInfo.serverInfoAppVersion = serverInfoAppVersion.c_str();
+    if (other.serverInfo.serverInfoGfeVersion)
+        serverInfo.serverInfoGfeVersion = serverInfoGfeVersion.c_str();
+    return *this;
+}
+
 bool _SERVER_DATA::isSunshine() {
     int AppVersionQuad[4];
     extractVersionQuadFromString(serverInfoAppVersion.c_str(), AppVersionQuad);
     return AppVersionQuad[3] < 0;
 }
 
+// The host as it goes into the request URLs
+static std::string url_host(PSERVER_DATA server) {
+    return http_url_host(server->address);
+}
+
+// The stream connects where the last request did, so a host with IPv4 and
+// IPv6 addresses isn't raced again
+static void update_connect_address(PSERVER_DATA server) {
+    server->connectAddress = http_connected_address(server->address);
+    server->serverInfo.address = server->connectAddress.c_str();
+}
+
 static int load_serverinfo(PSERVER_DATA server, bool https) {
     int ret = GS_INVALID;
     char url[4096];
     std::string pairedText;
     std::string currentGameText;
     std::string stateText;
-    std::string httpsPortText;
+    int httpsPort = 0;
+
+    // currentgame, PairStatus, appversion and state are present on all
+    // versions of GFE that this client supports
+    xml_field fields[] = {
+        {"currentgame", XML_FIELD_STRING, &currentGameText, true},
+        {"PairStatus", XML_FIELD_STRING, &pairedText, true},
+        {"appversion", XML_FIELD_STRING, &server->serverInfoAppVersion, true},
+        {"state", XML_FIELD_STRING, &stateText, true},
+        {"ServerCodecModeSupport", XML_FIELD_INT,
+         &server->serverInfo.serverCodecModeSupport, false},
+        {"gputype", XML_FIELD_STRING, &server->gpuType, false},
+        {"GsVersion", XML_FIELD_STRING, &server->gsVersion, false},
+        {"hostname", XML_FIELD_STRING, &server->hostname, false},
+        {"GfeVersion", XML_FIELD_STRING, &server->serverInfoGfeVersion, false},
+        {"HttpsPort", XML_FIELD_INT, &httpsPort, false},
+        {"mac", XML_FIELD_STRING, &server->mac, false},
+    };
 
     // Modern GFE versions don't allow serverinfo to be fetched over HTTPS
     // if the client is not already paired. Since we can't pair without
@@ -78,71 +140,26 @@ static int load_serverinfo(PSERVER_DATA server, bool https) {
     // doesn't accurately tell us if we're paired.
 
     snprintf(url, sizeof(url), "%s://%s:%d/serverinfo?uniqueid=%s",
-             https ? "https" : "http", server->serverInfo.address,
+             https ? "https" : "http", url_host(server).c_str(),
              https ? server->httpsPort : server->httpPort, unique_id.c_str());
 
     Data data;
 
-    if (http_request(url, &data, HTTPRequestTimeoutLow) != GS_OK) {
+    if (http_request(url, &data, HTTPRequestTimeoutLow, true) != GS_OK) {
         ret = GS_IO_ERROR;
         goto cleanup;
     }
 
-    if (xml_status(data) == GS_ERROR) {
-        ret = GS_ERROR;
-        goto cleanup;
-    }
-
-    if (xml_search(data, "currentgame", &currentGameText) != GS_OK) {
-        goto cleanup;
-    }
-
-    if (xml_search(data, "PairStatus", &pairedText) != GS_OK)
-        goto cleanup;
-
-    if (xml_search(data, "appversion", &server->serverInfoAppVersion) !=
+    if ((ret = xml_extract(data, fields, sizeof(fields) / sizeof(*fields))) !=
         GS_OK) {
         goto cleanup;
     }
 
-    if (xml_search(data, "state", &stateText) != GS_OK)
-        goto cleanup;
-
-    if (xml_search(data, "ServerCodecModeSupport",
-                   &server->serverInfo.serverCodecModeSupport) != GS_OK)
-        goto cleanup;
-
-    if (xml_search(data, "gputype", &server->gpuType) != GS_OK)
-        goto cleanup;
-
-    if (xml_search(data, "GsVersion", &server->gsVersion) != GS_OK)
-        goto cleanup;
-
-    if (xml_search(data, "hostname", &server->hostname) != GS_OK)
-        goto cleanup;
-
-    if (xml_search(data, "GfeVersion", &server->serverInfoGfeVersion) != GS_OK)
-        goto cleanup;
-
-    if (xml_search(data, "HttpsPort", &httpsPortText) != GS_OK)
-        goto cleanup;
-
-    if (xml_search(data, "mac", &server->mac) != GS_OK)
-        goto cleanup;
-
-    // These fields are present on all version of GFE that this client
-    // supports
-    if (currentGameText.empty() || pairedText.empty() ||
-        server->serverInfoAppVersion.empty() || stateText.empty()) {
-        goto cleanup;
-    }
-
     server->paired = pairedText == "1";
-    server->currentGame =
-        currentGameText.empty() ? 0 : atoi(currentGameText.c_str());
+    server->currentGame = atoi(currentGameText.c_str());
     server->supports4K = server->serverInfo.serverCodecModeSupport != 0;
     server->serverMajorVersion = atoi(server->serverInfoAppVersion.c_str());
-    server->httpsPort = atoi(httpsPortText.c_str());
+    server->httpsPort = httpsPort;
     if (!server->httpsPort)
         server->httpsPort = 47984;
 
@@ -152,7 +169,6 @@ static int load_serverinfo(PSERVER_DATA server, bool https) {
         // if streaming is not active.
         server->currentGame = 0;
     }
-    ret = GS_OK;
 
 cleanup:
     return ret;
@@ -195,7 +211,8 @@ static int load_server_status(PSERVER_DATA server) {
     return ret;
 }
 
-static std::string _gs_error = "";
+// Host polls run on several workers at once, each reads its own error
+static thread_local std::string _gs_error = "";
 
 void gs_set_error(std::string error) { _gs_error = error; }
 
@@ -206,6 +223,54 @@ std::string gs_error() {
     return _gs_error;
 }
 
+static std::mutex _keys_mutex;
+static std::shared_future<bool> _keys;
+
+static bool load_or_generate_keys() {
+    uint64_t started = LiGetMillis();
+    if (CryptoManager::load_cert_key_pair()) {
+        brls::Logger::info("Client: Loaded certs in {} ms ({})",
+                           LiGetMillis() - started, CRYPTO_BACKEND);
+        return true;
+    }
+
+    brls::Logger::info("Client: No certs, generate new...");
+    if (!CryptoManager::generate_new_cert_key_pair()) {
+        brls::Logger::info("Client: Failed to generate certs...");
+        return false;
+    }
+
+    brls::Logger::info("Client: Generated certs in {} ms ({})",
+                       LiGetMillis() - started, CRYPTO_BACKEND);
+    return true;
+}
+
+void gs_prepare_keys() {
+    std::lock_guard<std::mutex> lock(_keys_mutex);
+    if (!_keys.valid()) {
+        _keys = std::async(std::launch::async, load_or_generate_keys).share();
+    }
+}
+
+// A failed attempt doesn't stick, the next gs_init tries again
+static bool gs_wait_keys() {
+    gs_prepare_keys();
+
+    std::shared_future<bool> keys;
+    {
+        std::lock_guard<std::mutex> lock(_keys_mutex);
+        keys = _keys;
+    }
+
+    if (keys.get()) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(_keys_mutex);
+    _keys = std::shared_future<bool>();
+    return false;
+}
+
 int gs_unpair(PSERVER_DATA server) {
     int ret = GS_OK;
     char url[4096];
@@ -213,22 +278,27 @@ int gs_unpair(PSERVER_DATA server) {
     Data data;
 
     snprintf(url, sizeof(url), "http://%s:%u/unpair?uniqueid=%s",
-             server->serverInfo.address,
+             url_host(server).c_str(),
              server->httpPort,
              unique_id.c_str());
     ret = http_request(url, &data, HTTPRequestTimeoutLow);
+
+    // A resumed session would still count as paired with some hosts
+    http_close_connections();
     return ret;
 }
 
-static int gs_pair_validate(Data& data, std::string* result) {
+// The field a pairing stage needs comes along in the same pass
+static int gs_pair_validate(Data& data, std::string* result,
+                            const char* node = nullptr,
+                            std::string* value = nullptr) {
     *result = "";
 
-    int ret = GS_OK;
-    if ((ret = xml_status(data) != GS_OK)) {
-        return ret;
-    } else if ((ret = xml_search(data, "paired", result)) != GS_OK) {
-        return ret;
-    }
+    xml_field fields[] = {
+        {"paired", XML_FIELD_STRING, result, false},
+        {node, XML_FIELD_STRING, value, true},
+    };
+    int ret = xml_extract(data, fields, node ? 2 : 1);
 
     //    if (strcmp(*result, "1") != 0) {
     //        gs_error = "Pairing failed";
@@ -249,6 +319,7 @@ int gs_pair(PSERVER_DATA server, char* pin) {
     int ret = GS_OK;
     Data data;
     std::string result;
+    std::string value;
     char url[4096];
 
     if (server->paired) {
@@ -265,36 +336,48 @@ int gs_pair(PSERVER_DATA server, char* pin) {
 
     brls::Logger::info("Client: Pairing with generation {} server",
                        server->serverMajorVersion);
+
+    // Whatever time isn't spent waiting for the host goes to our crypto
+    uint64_t started = LiGetMillis();
+    uint64_t host_ms = 0;
+    auto pair_request = [&host_ms](const char* url, Data* data) {
+        uint64_t sent = LiGetMillis();
+        int ret = http_request(url, data, HTTPRequestTimeoutLong);
+        host_ms += LiGetMillis() - sent;
+        return ret;
+    };
+
     brls::Logger::info("Client: Start pairing stage #1");
 
     Data salt = Data::random_bytes(16);
-    Data salted_pin = salt.append(Data(pin, strlen(pin)));
+    Data salted_pin = Data::Builder(salt.size() + strlen(pin))
+                          .append(salt)
+                          .append((unsigned char*)pin, strlen(pin))
+                          .build();
 //    brls::Logger::info("Client: PIN: {}, salt {}", pin, salt.hex().bytes());
 
     snprintf(url, sizeof(url),
              "http://%s:%u/"
              "pair?uniqueid=%s&devicename=roth&updateState=1&phrase="
              "getservercert&salt=%s&clientcert=%s",
-             server->serverInfo.address, 
+             url_host(server).c_str(), 
              server->httpPort,
              unique_id.c_str(), salt.hex().bytes(),
              CryptoManager::cert_data().hex().bytes());
 
-    if ((ret = http_request(url, &data, HTTPRequestTimeoutLong)) != GS_OK) {
+    if ((ret = pair_request(url, &data)) != GS_OK) {
         return gs_pair_cleanup(ret, server, &result);
     }
 
-    if ((ret = gs_pair_validate(data, &result) != GS_OK)) {
-        return gs_pair_cleanup(ret, server, &result);
-    }
-
-    if ((ret = xml_search(data, "plaincert", &result)) != GS_OK) {
+    if ((ret = gs_pair_validate(data, &result, "plaincert", &value)) !=
+        GS_OK) {
         return gs_pair_cleanup(ret, server, &result);
     }
 
     brls::Logger::info("Client: Start pairing stage #2");
 
-    Data plainCert = Data((char*)result.c_str(), result.size());
+    Data serverCert =
+        Data((char*)value.c_str(), value.size()).hex_to_bytes();
     Data aesKey;
 
     // Gen 7 servers use SHA256 to get the key
@@ -315,38 +398,38 @@ int gs_pair(PSERVER_DATA server, char* pin) {
         url, sizeof(url),
         "http://%s:%u/"
         "pair?uniqueid=%s&devicename=roth&updateState=1&clientchallenge=%s",
-        server->serverInfo.address, 
+        url_host(server).c_str(), 
         server->httpPort,
         unique_id.c_str(),
         encryptedChallenge.hex().bytes());
 
-    if ((ret = http_request(url, &data, HTTPRequestTimeoutLong)) != GS_OK) {
-        return gs_pair_cleanup(ret, server, &result);
-    }
-
-    if ((ret = gs_pair_validate(data, &result) != GS_OK)) {
+    if ((ret = pair_request(url, &data)) != GS_OK) {
         return gs_pair_cleanup(ret, server, &result);
     }
 
-    if (xml_search(data, "challengeresponse", &result) != GS_OK) {
-        ret = GS_INVALID;
+    if ((ret = gs_pair_validate(data, &result, "challengeresponse",
+                                &value)) != GS_OK) {
         return gs_pair_cleanup(ret, server, &result);
     }
 
     brls::Logger::info("Client: Start pairing stage #3");
 
     Data encServerChallengeResp =
-        Data((char*)result.c_str(), result.size()).hex_to_bytes();
+        Data((char*)value.c_str(), value.size()).hex_to_bytes();
     Data decServerChallengeResp =
         CryptoManager::aes_decrypt(encServerChallengeResp, aesKey);
     Data serverResponse = decServerChallengeResp.subdata(0, hashLength);
     Data serverChallenge = decServerChallengeResp.subdata(hashLength, 16);
 
     Data clientSecret = Data::random_bytes(16);
+    Data clientSignature = CryptoManager::signature(CryptoManager::cert_data());
     Data challengeRespHashInput =
-        serverChallenge
-            .append(CryptoManager::signature(CryptoManager::cert_data()))
-            .append(clientSecret);
+        Data::Builder(serverChallenge.size() + clientSignature.size() +
+                      clientSecret.size())
+            .append(serverChallenge)
+            .append(clientSignature)
+            .append(clientSecret)
+            .build();
 
     Data challengeRespHash;
 
@@ -364,42 +447,42 @@ int gs_pair(PSERVER_DATA server, char* pin) {
         url, sizeof(url),
         "http://%s:%u/"
         "pair?uniqueid=%s&devicename=roth&updateState=1&serverchallengeresp=%s",
-        server->serverInfo.address,
+        url_host(server).c_str(),
         server->httpPort,
         unique_id.c_str(),
         challengeRespEncrypted.hex().bytes());
 
-    if ((ret = http_request(url, &data, HTTPRequestTimeoutLong)) != GS_OK) {
+    if ((ret = pair_request(url, &data)) != GS_OK) {
         return gs_pair_cleanup(ret, server, &result);
     }
 
-    if ((ret = gs_pair_validate(data, &result) != GS_OK)) {
-        return gs_pair_cleanup(ret, server, &result);
-    }
-
-    if (xml_search(data, "pairingsecret", &result) != GS_OK) {
-        ret = GS_INVALID;
+    if ((ret = gs_pair_validate(data, &result, "pairingsecret", &value)) !=
+        GS_OK) {
         return gs_pair_cleanup(ret, server, &result);
     }
 
     brls::Logger::info("Client: Start pairing stage #4");
 
     Data serverSecretResp =
-        Data((char*)result.c_str(), result.size()).hex_to_bytes();
+        Data((char*)value.c_str(), value.size()).hex_to_bytes();
     Data serverSecret = serverSecretResp.subdata(0, 16);
     Data serverSignature = serverSecretResp.subdata(16, 256);
 
     if (!CryptoManager::verify_signature(serverSecret, serverSignature,
-                                         plainCert.hex_to_bytes())) {
+                                         serverCert)) {
         gs_set_error("MITM attack detected");
         ret = GS_FAILED;
         return gs_pair_cleanup(ret, server, &result);
     }
 
+    Data serverCertSignature = CryptoManager::signature(serverCert);
     Data serverChallengeRespHashInput =
-        randomChallenge
-            .append(CryptoManager::signature(plainCert.hex_to_bytes()))
-            .append(serverSecret);
+        Data::Builder(randomChallenge.size() + serverCertSignature.size() +
+                      serverSecret.size())
+            .append(randomChallenge)
+            .append(serverCertSignature)
+            .append(serverSecret)
+            .build();
     Data serverChallengeRespHash;
 
     if (server->serverMajorVersion >= 7) {
@@ -417,11 +500,11 @@ int gs_pair(PSERVER_DATA server, char* pin) {
         url, sizeof(url),
         "http://%s:%u/"
         "pair?uniqueid=%s&devicename=roth&updateState=1&clientpairingsecret=%s",
-        server->serverInfo.address, 
+        url_host(server).c_str(), 
         server->httpPort,
         unique_id.c_str(),
         clientPairingSecret.hex().bytes());
-    if ((ret = http_request(url, &data, HTTPRequestTimeoutLong)) != GS_OK) {
+    if ((ret = pair_request(url, &data)) != GS_OK) {
         return gs_pair_cleanup(ret, server, &result);
     }
 
@@ -435,8 +518,8 @@ int gs_pair(PSERVER_DATA server, char* pin) {
         url, sizeof(url),
         "https://%s:%u/"
         "pair?uniqueid=%s&devicename=roth&updateState=1&phrase=pairchallenge",
-        server->serverInfo.address, server->httpsPort, unique_id.c_str());
-    if ((ret = http_request(url, &data, HTTPRequestTimeoutLong)) != GS_OK) {
+        url_host(server).c_str(), server->httpsPort, unique_id.c_str());
+    if ((ret = pair_request(url, &data)) != GS_OK) {
         return gs_pair_cleanup(ret, server, &result);
     }
 
@@ -445,38 +528,44 @@ int gs_pair(PSERVER_DATA server, char* pin) {
     }
 
     server->paired = true;
+    brls::Logger::info("Client: Paired in {} ms, {} ms of it waiting for the "
+                       "host ({})",
+                       LiGetMillis() - started, host_ms, CRYPTO_BACKEND);
 
     return gs_pair_cleanup(ret, server, &result);
 }
 
-int gs_applist(PSERVER_DATA server, PAPP_LIST* list) {
+int gs_applist(PSERVER_DATA server, AppInfoList* list) {
     int ret = GS_OK;
     char url[4096];
     Data data;
 
     snprintf(url, sizeof(url), "https://%s:%u/applist?uniqueid=%s",
-             server->serverInfo.address, server->httpsPort, unique_id.c_str());
+             url_host(server).c_str(), server->httpsPort, unique_id.c_str());
 
-    if (http_request(url, &data, HTTPRequestTimeoutMedium) != GS_OK)
+    if (http_request(url, &data, HTTPRequestTimeoutMedium, true) != GS_OK)
         ret = GS_IO_ERROR;
-    else if (xml_status(data) == GS_ERROR)
-        ret = GS_ERROR;
-    else if (xml_applist(data, list) != GS_OK)
-        ret = GS_INVALID;
+    else
+        ret = xml_applist(data, list);
     return ret;
 }
 
-int gs_app_boxart(PSERVER_DATA server, int app_id, Data* out) {
-    int ret = GS_OK;
+std::string gs_app_boxart_url(PSERVER_DATA server, int app_id) {
     char url[4096];
-    Data data;
 
     snprintf(
         url, sizeof(url),
         "https://%s:%u/appasset?uniqueid=%s&appid=%d&AssetType=2&AssetIdx=0",
-        server->serverInfo.address, server->httpsPort, unique_id.c_str(), app_id);
+        url_host(server).c_str(), server->httpsPort, unique_id.c_str(), app_id);
+    return url;
+}
+
+int gs_app_boxart(PSERVER_DATA server, int app_id, Data* out) {
+    int ret = GS_OK;
+    Data data;
 
-    if (http_request(url, &data, HTTPRequestTimeoutMedium) != GS_OK) {
+    if (http_request(gs_app_boxart_url(server, app_id), &data,
+                     HTTPRequestTimeoutMedium, true) != GS_OK) {
         ret = GS_IO_ERROR;
     } else {
         *out = data;
@@ -484,6 +573,20 @@ int gs_app_boxart(PSERVER_DATA server, int app_id, Data* out) {
     return ret;
 }
 
+int gs_ping(PSERVER_DATA server) {
+    char url[4096];
+    Data data;
+
+    // Plain HTTP, so only the round trip gets measured and not a TLS handshake
+    snprintf(url, sizeof(url), "http://%s:%u/serverinfo?uniqueid=%s",
+             url_host(server).c_str(), server->httpPort, unique_id.c_str());
+
+    if (http_request(url, &data, HTTPRequestTimeoutLow) != GS_OK)
+        return GS_IO_ERROR;
+
+    return xml_status(data) == GS_ERROR ? GS_ERROR : GS_OK;
+}
+
 int gs_start_app(PSERVER_DATA server, STREAM_CONFIGURATION* config, int appId,
                  bool sops, bool localaudio, int gamepad_mask) {
     int ret = GS_OK;
@@ -501,6 +604,11 @@ int gs_start_app(PSERVER_DATA server, STREAM_CONFIGURATION* config, int appId,
     int rikeyid = 0;
 
     Data data;
+    std::string sessionUrl;
+    xml_field fields[] = {
+        {"gamesession", XML_FIELD_STRING, &result, false},
+        {"sessionUrl0", XML_FIELD_STRING, &sessionUrl, false},
+    };
 
     if (server->currentGame == 0) {
         int channelCounnt =
@@ -516,38 +624,36 @@ int gs_start_app(PSERVER_DATA server, STREAM_CONFIGURATION* config, int appId,
                  "launch?uniqueid=%s&appid=%d&mode=%dx%dx%d&additionalStates=1&"
                  "sops=%d&rikey=%s&rikeyid=%d&localAudioPlayMode=%d&"
                  "surroundAudioInfo=%d&remoteControllersBitmap=%d&gcmap=%d%s",
-                 server->serverInfo.address, server->httpsPort, unique_id.c_str(), appId,
+                 url_host(server).c_str(), server->httpsPort, unique_id.c_str(), appId,
                  config->width, config->height, fps, sops, rand.hex().bytes(),
                  rikeyid, localaudio, (mask << 16) + channelCounnt,
                  gamepad_mask, gamepad_mask, LiGetLaunchUrlQueryParameters());
     } else {
         snprintf(url, sizeof(url),
                  "https://%s:%u/resume?uniqueid=%s&rikey=%s&rikeyid=%d%s",
-                 server->serverInfo.address, server->httpsPort, unique_id.c_str(),
+                 url_host(server).c_str(), server->httpsPort, unique_id.c_str(),
                  rand.hex().bytes(), rikeyid, LiGetLaunchUrlQueryParameters());
     }
 
     if ((ret = http_request(url, &data, HTTPRequestTimeoutLong)) == GS_OK) {
         server->currentGame = appId;
+        update_connect_address(server);
     } else {
         goto exit;
     }
 
-    if ((ret = xml_status(data) != GS_OK)) {
-        goto exit;
-    } else if ((ret = xml_search(data, "gamesession", &result)) != GS_OK) {
+    if ((ret = xml_extract(data, fields, 2)) != GS_OK)
         goto exit;
-    }
 
     if (result == "0") {
         ret = GS_FAILED;
         goto exit;
     }
 
-    if (xml_search(data, "sessionUrl0", &result) == GS_OK) {
-        const std::string::size_type size = result.size();
+    if (!sessionUrl.empty()) {
+        const std::string::size_type size = sessionUrl.size();
         server->serverInfo.rtspSessionUrl = new char[size + 1];
-        memcpy((void *) server->serverInfo.rtspSessionUrl, result.c_str(), size + 1);
+        memcpy((void *) server->serverInfo.rtspSessionUrl, sessionUrl.c_str(), size + 1);
     } else {
         brls::Logger::error("sessionUrl0 not found");
     }
@@ -561,17 +667,15 @@ int gs_quit_app(PSERVER_DATA server) {
     char url[4096];
     std::string result;
     Data data;
+    xml_field fields[] = {{"cancel", XML_FIELD_STRING, &result, false}};
 
     snprintf(url, sizeof(url), "https://%s:%u/cancel?uniqueid=%s",
-             server->serverInfo.address, server->httpsPort, unique_id.c_str());
+             url_host(server).c_str(), server->httpsPort, unique_id.c_str());
     if ((ret = http_request(url, &data, HTTPRequestTimeoutMedium)) != GS_OK)
         goto exit;
 
-    if ((ret = xml_status(data) != GS_OK)) {
-        goto exit;
-    } else if ((ret = xml_search(data, "cancel", &result)) != GS_OK) {
+    if ((ret = xml_extract(data, fields, 1)) != GS_OK)
         goto exit;
-    }
 
     if (result == "0") {
         ret = GS_FAILED;
@@ -583,42 +687,42 @@ exit:
 }
 
 int gs_init(PSERVER_DATA server, const std::string address) {
-    std::stringstream addressStream(address);
-    std::string segment;
-    std::vector<std::string> seglist;
+    std::string host;
     unsigned short httpPort = 47989; // Default HTTP port
 
-    while(std::getline(addressStream, segment, ':'))
-    {
-       seglist.push_back(segment);
-    }
-
-    // Override port if it presented
-    if (seglist.size() > 1) {
-        httpPort = atoi(seglist[1].c_str());
+    if (!http_parse_address(address, &host, &httpPort)) {
+        gs_set_error("Invalid address: " + address);
+        return GS_INVALID;
     }
-    
-    if (!CryptoManager::load_cert_key_pair()) {
-        brls::Logger::info("Client: No certs, generate new...");
 
-        if (!CryptoManager::generate_new_cert_key_pair()) {
-            brls::Logger::info("Client: Failed to generate certs...");
-            return GS_FAILED;
-        }
+    uint64_t started = LiGetMillis();
+    if (!gs_wait_keys()) {
+        gs_set_error("Failed to generate certs");
+        return GS_FAILED;
     }
+    uint64_t keys_ready = LiGetMillis();
 
     http_init(Settings::instance().key_dir());
 
     LiInitializeServerInformation(&server->serverInfo);
-    server->address = seglist[0];
-    server->serverInfo.address = server->address.c_str();
+    server->address = host;
     server->httpPort = httpPort;
     server->httpsPort = 0; /* Populated by load_server_status() */
 
     int result = load_server_status(server);
+    update_connect_address(server);
     server->serverInfo.serverInfoAppVersion =
         server->serverInfoAppVersion.c_str();
     server->serverInfo.serverInfoGfeVersion =
         server->serverInfoGfeVersion.c_str();
+
+    // Includes waiting for a key pair still being generated at launch
+    static std::atomic<bool> first_connect{true};
+    if (result == GS_OK && first_connect.exchange(false)) {
+        brls::Logger::info("Client: First connect took {} ms, {} ms of it "
+                           "waiting for certs ({})",
+                           LiGetMillis() - started, keys_ready - started,
+                           CRYPTO_BACKEND);
+    }
     return result;
 }
@@ -28,7 +28,8 @@
 #define MAX_SUPPORTED_GFE_VERSION 7
 
 typedef struct _SERVER_DATA {
-    std::string address;
+    std::string address; // Host name or IP, IPv6 without brackets
+    std::string connectAddress; // The IP the stream connects to
     std::string serverInfoAppVersion;
     std::string serverInfoGfeVersion;
     std::string mac;
@@ -43,15 +44,26 @@ typedef struct _SERVER_DATA {
     unsigned short httpPort;
     unsigned short httpsPort;
     bool isSunshine();
+
+    // serverInfo points into the strings above, a copy points it into
+    // its own ones
+    _SERVER_DATA() = default;
+    _SERVER_DATA(const _SERVER_DATA& other);
+    _SERVER_DATA& operator=(const _SERVER_DATA& other);
 } SERVER_DATA, *PSERVER_DATA;
 
 void gs_set_error(std::string error);
 std::string gs_error();
 
+// Loads or generates the client key pair in the background, gs_init waits
+// for it. Generating one takes seconds, so the app starts this at launch.
+void gs_prepare_keys();
 int gs_init(PSERVER_DATA server, const std::string address);
+std::string gs_app_boxart_url(PSERVER_DATA server, int app_id);
 int gs_app_boxart(PSERVER_DATA server, int app_id, Data* out);
+int gs_ping(PSERVER_DATA server);
 int gs_start_app(PSERVER_DATA server, PSTREAM_CONFIGURATION config, int appId, bool sops, bool localaudio, int gamepad_mask);
-int gs_applist(PSERVER_DATA server, PAPP_LIST* app_list);
+int gs_applist(PSERVER_DATA server, AppInfoList* app_list);
 int gs_unpair(PSERVER_DATA server);
 int gs_pair(PSERVER_DATA server, char* pin);
 int gs_quit_app(PSERVER_DATA server);
@@ -23,38 +23,371 @@
 #include "errors.h"
 #include <borealis/core/logger.hpp>
 
+#include <arpa/inet.h>
 #include <curl/curl.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstring>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
 
-static bool curlGlobalInit = false;
+// Idle handles kept per host, ready to go with all options set
+#define MAX_IDLE_HANDLES 4
+
+// Bounds of the adaptive timeouts, in ms
+#define MIN_RTO 50
+#define MIN_CONNECT_TIMEOUT 250
+#define MAX_CONNECT_TIMEOUT 5000
+#define MAX_LOW_CONNECT_TIMEOUT 2000
+
+// Idempotent requests get this many more attempts after a pause doubling
+// from RETRY_DELAY ms. The connect timeout doubles with each attempt, the
+// time to answer doubles once.
+#define MAX_RETRIES 2
+#define RETRY_DELAY 100
+
+// How long the first address family gets before the other one races it,
+// in ms (RFC 8305). Connects to hosts without a winner yet get it on top.
+#define HAPPY_EYEBALLS_DELAY 250
+
+static std::once_flag curlGlobalInit;
 static std::string certificateFilePath;
 static std::string keyFilePath;
 
+// DNS and TLS sessions are shared by every request. Open connections
+// aren't, curl's connection cache can't be used by several threads at
+// once; they get reused through the idle handles below instead.
+// Closing all connections swaps in a new share, the old one is freed
+// once the last request still using it is done.
+static CURLSH* curlShare = nullptr;
+static std::vector<CURLSH*> retiredShares;
+static std::mutex shareLocks[CURL_LOCK_DATA_LAST];
+
+static std::mutex poolMutex;
+static std::map<std::string, std::vector<CURL*>> idleHandles;
+
+// Hosts that failed a handshake with a resumed TLS session
+static std::set<std::string> noResumeHosts;
+
+// Round trip time estimate per host, smoothed like TCP does (RFC 6298),
+// shared by its HTTP and HTTPS ports. In ms.
+struct HostTiming {
+    bool measured = false;
+    double srtt = 0;
+    double rttvar = 0;
+    uint32_t requests = 0;
+    uint32_t timeouts = 0;
+    uint32_t retries = 0;
+};
+
+static std::mutex timingMutex;
+static std::map<std::string, HostTiming> hostTimings;
+
+// The IP each host name last connected to, later connections go straight
+// to it instead of racing its addresses again. The connect-to list of a
+// handle has to live as long as the handle uses it.
+static std::mutex addressMutex;
+static std::map<std::string, std::string> connectedAddresses;
+static std::map<CURL*, curl_slist*> connectToLists;
+
 CURL* makeCurl();
 void freeCurl(CURL* curl);
 
-struct HTTP_DATA {
-    char* memory;
-    size_t size;
-};
+static size_t _write_curl(char* contents, size_t size, size_t nmemb,
+                          void* userp) {
+    size_t realsize = size * nmemb;
+    auto* buffer = (std::string*)userp;
+    buffer->append((char*)contents, realsize);
+    return realsize;
+}
 
-static size_t _write_curl(void* contents, size_t size, size_t nmemb,
+static size_t _write_data(char* contents, size_t size, size_t nmemb,
                           void* userp) {
     size_t realsize = size * nmemb;
-    auto* mem = (HTTP_DATA*)userp;
+    auto* builder = (Data::Builder*)userp;
+    builder->append((unsigned char*)contents, realsize);
+    return realsize;
+}
 
-    mem->memory = (char*)realloc(mem->memory, mem->size + realsize + 1);
-    if (mem->memory == NULL)
-        return 0;
+static void _lock_share(CURL*, curl_lock_data data, curl_lock_access, void*) {
+    shareLocks[data].lock();
+}
 
-    memcpy(&(mem->memory[mem->size]), contents, realsize);
-    mem->size += realsize;
-    mem->memory[mem->size] = 0;
-    return realsize;
+static void _unlock_share(CURL*, curl_lock_data data, void*) {
+    shareLocks[data].unlock();
+}
+
+static CURLSH* make_share() {
+    CURLSH* share = curl_share_init();
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, _lock_share);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, _unlock_share);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    return share;
+}
+
+// scheme://host:port, the part of the URL a connection can be reused for
+static std::string http_origin(const std::string& url) {
+    size_t scheme = url.find("://");
+    if (scheme == std::string::npos)
+        return url;
+    return url.substr(0, url.find('/', scheme + 3));
+}
+
+// The address part of the URL, without brackets for IPv6
+static std::string http_host(const std::string& url) {
+    size_t start = url.find("://");
+    start = start == std::string::npos ? 0 : start + 3;
+
+    if (start < url.size() && url[start] == '[') {
+        size_t end = url.find(']', start);
+        return url.substr(start + 1, end == std::string::npos
+                                         ? std::string::npos
+                                         : end - start - 1);
+    }
+    return url.substr(start, url.find_first_of(":/", start) - start);
+}
+
+// IP literals have nothing to race
+static bool is_ip_literal(const std::string& host) {
+    struct in_addr address;
+    return host.find(':') != std::string::npos ||
+           inet_pton(AF_INET, host.c_str(), &address) == 1;
+}
+
+bool http_parse_address(const std::string& address, std::string* host,
+                        unsigned short* port) {
+    std::string name, port_text;
+    size_t colon = address.find(':');
+
+    if (!address.empty() && address[0] == '[') {
+        size_t end = address.find(']');
+        if (end == std::string::npos)
+            return false;
+        name = address.substr(1, end - 1);
+        if (end + 1 < address.size()) {
+            if (address[end + 1] != ':' || end + 2 == address.size())
+                return false;
+            port_text = address.substr(end + 2);
+        }
+    } else if (colon != std::string::npos &&
+               address.find(':', colon + 1) == std::string::npos) {
+        name = address.substr(0, colon);
+        port_text = address.substr(colon + 1);
+        if (port_text.empty())
+            return false;
+    } else {
+        name = address;
+    }
+
+    if (name.empty())
+        return false;
+
+    if (!port_text.empty()) {
+        if (port_text.find_first_not_of("0123456789") != std::string::npos ||
+            port_text.size() > 5)
+            return false;
+        unsigned long value = std::stoul(port_text);
+        if (value == 0 || value > 65535)
+            return false;
+        *port = (unsigned short)value;
+    }
+
+    *host = name;
+    return true;
+}
+
+std::string http_url_host(const std::string& host) {
+    if (host.find(':') == std::string::npos)
+        return host;
+
+    // The zone of a link local address gets its '%' escaped (RFC 6874)
+    std::string escaped = "[";
+    for (char c : host) {
+        if (c == '%')
+            escaped += "%25";
+        else
+            escaped += c;
+    }
+    return escaped + "]";
+}
+
+std::string http_format_address(const std::string& host, unsigned short port,
+                                unsigned short default_port) {
+    if (port == default_port)
+        return host;
+    if (host.find(':') != std::string::npos)
+        return "[" + host + "]:" + std::to_string(port);
+    return host + ":" + std::to_string(port);
+}
+
+std::string http_connected_address(const std::string& host) {
+    std::lock_guard<std::mutex> lock(addressMutex);
+    auto it = connectedAddresses.find(host);
+    return it == connectedAddresses.end() ? host : it->second;
+}
+
+// Keeps the address a new connection won with, and forgets it once it
+// can't be connected to anymore, so the next connect races again
+static void record_address(const std::string& host, CURL* curl,
+                           CURLcode result) {
+    if (is_ip_literal(host))
+        return;
+
+    std::lock_guard<std::mutex> lock(addressMutex);
+    if (result == CURLE_OK) {
+        char* ip = nullptr;
+        curl_easy_getinfo(curl, CURLINFO_PRIMARY_IP, &ip);
+        if (!ip || !*ip)
+            return;
+
+        auto& connected = connectedAddresses[host];
+        if (connected != ip) {
+            brls::Logger::info("Curl: {} connects to {}", host, ip);
+            connected = ip;
+        }
+    } else if (result == CURLE_COULDNT_CONNECT ||
+               result == CURLE_OPERATION_TIMEDOUT) {
+        if (connectedAddresses.erase(host)) {
+            brls::Logger::info("Curl: {} unreachable at its last address, "
+                               "racing its addresses again",
+                               host);
+        }
+    }
+}
+
+// Points the handle at the host's last winning address on any port, if
+// it has one. true if it has.
+static bool connect_to_address(CURL* curl, const std::string& host) {
+    std::lock_guard<std::mutex> lock(addressMutex);
+    curl_slist* list = nullptr;
+
+    auto connected = connectedAddresses.find(host);
+    if (connected != connectedAddresses.end()) {
+        std::string entry =
+            host + "::" + http_url_host(connected->second) + ":";
+        list = curl_slist_append(nullptr, entry.c_str());
+    }
+
+    curl_easy_setopt(curl, CURLOPT_CONNECT_TO, list);
+    auto& current = connectToLists[curl];
+    curl_slist_free_all(current);
+    current = list;
+    return list != nullptr;
+}
+
+// Callers hold timingMutex
+static double retransmission_timeout(const HostTiming& timing) {
+    return std::max(timing.srtt + 4 * timing.rttvar, (double)MIN_RTO);
+}
+
+// Requests that can't be retried keep the full connect timeout, a host
+// waking up from power saving shouldn't fail them
+static void request_timeouts(const std::string& host,
+                             HTTPRequestTimeout timeout, int attempt,
+                             bool adaptive, long* connect_ms, long* total_ms) {
+    long class_connect = std::min((long)timeout, 5L) * 1000;
+    long max_connect = timeout == HTTPRequestTimeoutLow
+                           ? MAX_LOW_CONNECT_TIMEOUT
+                           : MAX_CONNECT_TIMEOUT;
+    long answer = (long)timeout * 1000;
+
+    long connect = class_connect;
+    {
+        std::lock_guard<std::mutex> lock(timingMutex);
+        auto it = hostTimings.find(host);
+        if (it != hostTimings.end() && it->second.measured) {
+            double rto = retransmission_timeout(it->second);
+            if (adaptive) {
+                connect = std::clamp((long)(4 * rto),
+                                     (long)MIN_CONNECT_TIMEOUT, class_connect);
+            }
+            answer = std::max(answer, (long)(8 * rto));
+        }
+    }
+
+    *connect_ms = std::min(connect << attempt, std::max(max_connect, connect));
+    *total_ms = *connect_ms + (attempt > 0 ? answer * 2 : answer);
+}
+
+// Timeouts and dropped connections are worth another try, a refused
+// connection or an HTTP error isn't
+static bool should_retry(CURLcode result) {
+    switch (result) {
+    case CURLE_OPERATION_TIMEDOUT:
+    case CURLE_GOT_NOTHING:
+    case CURLE_SEND_ERROR:
+    case CURLE_RECV_ERROR:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// A new connection gives the TCP handshake time, a reused one the time to
+// the first byte of the answer
+static void record_result(const std::string& host, CURL* curl,
+                          CURLcode result) {
+    double sample = -1;
+    if (result == CURLE_OK) {
+        long connects = 0;
+        double lookup = 0, connect = 0, pretransfer = 0, starttransfer = 0;
+        curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+        curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME, &lookup);
+        curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME, &connect);
+        curl_easy_getinfo(curl, CURLINFO_PRETRANSFER_TIME, &pretransfer);
+        curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME, &starttransfer);
+        sample = (connects > 0 ? connect - lookup
+                               : starttransfer - pretransfer) * 1000;
+    }
+
+    std::lock_guard<std::mutex> lock(timingMutex);
+    auto& timing = hostTimings[host];
+    timing.requests++;
+
+    if (result == CURLE_OPERATION_TIMEDOUT) {
+        // Back off like a retransmission would, until an answer comes in
+        timing.timeouts++;
+        if (timing.measured)
+            timing.rttvar = std::max(timing.rttvar * 2, timing.srtt);
+    } else if (sample >= 0) {
+        if (!timing.measured) {
+            timing.measured = true;
+            timing.srtt = sample;
+            timing.rttvar = sample / 2;
+        } else {
+            timing.rttvar =
+                0.75 * timing.rttvar + 0.25 * std::fabs(timing.srtt - sample);
+            timing.srtt = 0.875 * timing.srtt + 0.125 * sample;
+        }
+    }
+}
+
+bool http_host_stats(const std::string& address, HTTPHostStats* stats) {
+    // Timings are kept by the host as it is in the URL, without a port
+    std::string host;
+    unsigned short port;
+    if (!http_parse_address(address, &host, &port))
+        return false;
+
+    std::lock_guard<std::mutex> lock(timingMutex);
+    auto it = hostTimings.find(host);
+    if (it == hostTimings.end())
+        return false;
+
+    auto& timing = it->second;
+    *stats = {(uint32_t)std::lround(timing.srtt),
+              (uint32_t)std::lround(timing.rttvar), timing.requests,
+              timing.timeouts, timing.retries};
+    return true;
 }
 
 int http_init(const std::string& key_directory) {
-    if (!curlGlobalInit) {
+    std::call_once(curlGlobalInit, [&key_directory] {
 #if LIBCURL_VERSION_NUM >= 0x075600
 #ifdef USE_OPENSSL_CRYPTO
         curl_global_sslset(CURLSSLBACKEND_OPENSSL, NULL, NULL);
@@ -64,24 +397,22 @@ int http_init(const std::string& key_directory) {
 #endif
         curl_global_init(CURL_GLOBAL_ALL);
         brls::Logger::info("Curl: {}", curl_version());
-    } else {
-        return GS_OK;
-    }
 
-    certificateFilePath = key_directory + "/" + CERTIFICATE_FILE_NAME;
-    keyFilePath = key_directory + "/" + KEY_FILE_NAME;
-
-    curlGlobalInit = true;
+        std::lock_guard<std::mutex> lock(poolMutex);
+        certificateFilePath = key_directory + "/" + CERTIFICATE_FILE_NAME;
+        keyFilePath = key_directory + "/" + KEY_FILE_NAME;
+        curlShare = make_share();
+    });
     return GS_OK;
 }
 
+// Callers hold poolMutex
 CURL* makeCurl() {
     auto curl = curl_easy_init();
 
     if (!curl)
         return nullptr;
 
-    curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
     curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
     curl_easy_setopt(curl, CURLOPT_SSLENGINE_DEFAULT, 1L);
     curl_easy_setopt(curl, CURLOPT_SSLCERTTYPE, "PEM");
@@ -89,62 +420,230 @@ CURL* makeCurl() {
     curl_easy_setopt(curl, CURLOPT_SSLKEYTYPE, "PEM");
     curl_easy_setopt(curl, CURLOPT_SSLKEY, keyFilePath.c_str());
     curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, _write_curl);
     curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
-    curl_easy_setopt(curl, CURLOPT_SSL_SESSIONID_CACHE, 0L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+#if LIBCURL_VERSION_NUM >= 0x073B00
+    curl_easy_setopt(curl, CURLOPT_HAPPY_EYEBALLS_TIMEOUT_MS,
+                     (long)HAPPY_EYEBALLS_DELAY);
+#endif
+    curl_easy_setopt(curl, CURLOPT_SHARE, curlShare);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, curlShare);
 
     return curl;
 }
 
 void freeCurl(CURL* curl) {
     curl_easy_cleanup(curl);
+
+    std::lock_guard<std::mutex> lock(addressMutex);
+    auto it = connectToLists.find(curl);
+    if (it != connectToLists.end()) {
+        curl_slist_free_all(it->second);
+        connectToLists.erase(it);
+    }
 }
 
-int http_request(const std::string& url, Data* data,
-                 HTTPRequestTimeout timeout) {
-    brls::Logger::info("Curl: Request:\n{}", url.c_str());
+// Callers hold poolMutex
+static void cleanup_retired_shares() {
+    retiredShares.erase(
+        std::remove_if(retiredShares.begin(), retiredShares.end(),
+                       [](CURLSH* share) {
+                           return curl_share_cleanup(share) == CURLSHE_OK;
+                       }),
+        retiredShares.end());
+}
+
+static CURL* acquire_curl(const std::string& origin) {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    auto& handles = idleHandles[origin];
+    if (!handles.empty()) {
+        CURL* curl = handles.back();
+        handles.pop_back();
+        return curl;
+    }
+    return makeCurl();
+}
 
-    auto* http_data = (HTTP_DATA*)malloc(sizeof(HTTP_DATA));
-    http_data->memory = (char*)malloc(1);
-    http_data->size = 0;
+static void release_curl(const std::string& origin, CURL* curl, bool reuse) {
+    std::lock_guard<std::mutex> lock(poolMutex);
 
-    auto curl = makeCurl();
-    if (!curl) return GS_FAILED;
+    CURLSH* share = nullptr;
+    curl_easy_getinfo(curl, CURLINFO_PRIVATE, (char**)&share);
+
+    auto& handles = idleHandles[origin];
+    if (reuse && share == curlShare && handles.size() < MAX_IDLE_HANDLES) {
+        handles.push_back(curl);
+        return;
+    }
+
+    freeCurl(curl);
+    if (share != curlShare)
+        cleanup_retired_shares();
+}
 
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, http_data);
+void http_close_connections() {
+    std::lock_guard<std::mutex> lock(poolMutex);
+
+    for (auto& [origin, handles] : idleHandles) {
+        for (auto curl : handles)
+            freeCurl(curl);
+    }
+    idleHandles.clear();
+    noResumeHosts.clear();
+
+    if (curlShare) {
+        retiredShares.push_back(curlShare);
+        curlShare = make_share();
+        cleanup_retired_shares();
+    }
+}
+
+static bool can_resume(const std::string& origin) {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    return noResumeHosts.count(origin) == 0;
+}
+
+// Each chunk of the answer goes to write, along with response
+static void setup_request(CURL* curl, const std::string& url,
+                          HTTPRequestTimeout timeout,
+                          curl_write_callback write, void* response,
+                          bool resume, int attempt, bool adaptive) {
+    std::string host = http_host(url);
+    long connect_ms, total_ms;
+    request_timeouts(host, timeout, attempt, adaptive, &connect_ms,
+                     &total_ms);
+
+    // Without a winner yet the second address family starts late
+    if (!connect_to_address(curl, host) && !is_ip_literal(host)) {
+        connect_ms += HAPPY_EYEBALLS_DELAY;
+        total_ms += HAPPY_EYEBALLS_DELAY;
+    }
+
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
     curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeout);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, total_ms);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, connect_ms);
+    curl_easy_setopt(curl, CURLOPT_SSL_SESSIONID_CACHE, resume ? 1L : 0L);
+}
 
+static CURLcode perform(CURL* curl, const std::string& host) {
     CURLcode res = curl_easy_perform(curl);
+    record_result(host, curl, res);
+    record_address(host, curl, res);
+    return res;
+}
+
+CURL* http_acquire_handle(const std::string& url, HTTPRequestTimeout timeout,
+                          std::string* response) {
+    std::string origin = http_origin(url);
+    auto curl = acquire_curl(origin);
+    if (curl)
+        setup_request(curl, url, timeout, _write_curl, response,
+                      can_resume(origin), 0, false);
+    return curl;
+}
+
+void http_release_handle(const std::string& url, CURL* curl, CURLcode result) {
+    // Aborted transfers say nothing about the host
+    if (result != CURLE_ABORTED_BY_CALLBACK) {
+        record_result(http_host(url), curl, result);
+        record_address(http_host(url), curl, result);
+    }
+    release_curl(http_origin(url), curl, result == CURLE_OK);
+}
+
+int http_request(const std::string& url, Data* data,
+                 HTTPRequestTimeout timeout, bool idempotent) {
+    brls::Logger::info("Curl: Request:\n{}", url.c_str());
+
+    std::string origin = http_origin(url);
+    std::string host = http_host(url);
+    auto curl = acquire_curl(origin);
+    if (!curl) return GS_FAILED;
+
+    // Answers go straight into the buffer the Data gets
+    Data::Builder response;
+    bool resume = can_resume(origin);
+    setup_request(curl, url, timeout, _write_data, &response, resume, 0,
+                  idempotent);
+
+    CURLcode res = perform(curl, host);
+
+    // Some hosts can't resume a session of a client certificate,
+    // retry with a full handshake and stop resuming with them
+    if (res == CURLE_SSL_CONNECT_ERROR && resume) {
+        brls::Logger::info("Curl: Handshake failed, retrying without TLS "
+                           "session resumption");
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            noResumeHosts.insert(origin);
+        }
+        response.clear();
+        curl_easy_setopt(curl, CURLOPT_SSL_SESSIONID_CACHE, 0L);
+        curl_easy_setopt(curl, CURLOPT_FRESH_CONNECT, 1L);
+        res = perform(curl, host);
+        curl_easy_setopt(curl, CURLOPT_FRESH_CONNECT, 0L);
+    }
+
+    for (int retry = 1;
+         idempotent && retry <= MAX_RETRIES && should_retry(res); retry++) {
+        int delay = RETRY_DELAY << (retry - 1);
+        brls::Logger::info("Curl: {} from {}, retry {} of {} in {} ms",
+                           curl_easy_strerror(res), host, retry, MAX_RETRIES,
+                           delay);
+        {
+            std::lock_guard<std::mutex> lock(timingMutex);
+            hostTimings[host].retries++;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+
+        // The old connection may be half open, start over on a new one
+        response.clear();
+        setup_request(curl, url, timeout, _write_data, &response,
+                      can_resume(origin), retry, true);
+        curl_easy_setopt(curl, CURLOPT_FRESH_CONNECT, 1L);
+        res = perform(curl, host);
+        curl_easy_setopt(curl, CURLOPT_FRESH_CONNECT, 0L);
+    }
+
+    // A handle that failed may hold a broken connection, don't keep it
+    release_curl(origin, curl, res == CURLE_OK);
 
     if (res != CURLE_OK) {
         gs_set_error(curl_easy_strerror(res));
         brls::Logger::error("Curl: error: {}", gs_error().c_str());
-        free(http_data->memory);
-        free(http_data);
+        if (res == CURLE_OPERATION_TIMEDOUT) {
+            HTTPHostStats stats;
+            http_host_stats(host, &stats);
+            brls::Logger::error(
+                "Curl: {}: rtt {} ms, variance {} ms, {} of {} requests "
+                "timed out, {} retries",
+                host, stats.rtt, stats.rtt_variance, stats.timeouts,
+                stats.requests, stats.retries);
+        }
         return GS_FAILED;
-    } else if (http_data->memory == nullptr) {
-        brls::Logger::error("Curl: memory = NULL");
-        free(http_data->memory);
-        free(http_data);
-        return GS_OUT_OF_MEMORY;
     }
 
-    *data = Data(http_data->memory, http_data->size);
+    *data = response.build();
 
-    if (http_data->size > 3000) {
+    if (data->size() > 3000) {
         brls::Logger::info("Curl: Response: Ok");
     } else {
-        brls::Logger::info("Curl: Response:\n{}", http_data->memory);
+        brls::Logger::info("Curl: Response:\n{}", (const char*)data->bytes());
     }
 
-    free(http_data->memory);
-    free(http_data);
-    freeCurl(curl);
-
     return GS_OK;
 }
 
 void http_cleanup() {
+    http_close_connections();
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        retiredShares.push_back(curlShare);
+        curlShare = nullptr;
+        cleanup_retired_shares();
+    }
     curl_global_cleanup();
-}
\ No newline at end of file
+}
@@ -20,13 +20,64 @@
 #pragma once
 
 #include "Data.hpp"
+#include <cstdint>
+#include <curl/curl.h>
 
+// How long a host may take to answer, in seconds, for a host we know
+// nothing about yet. Once its round trip time is measured the connect
+// timeout follows it, and answers get longer on a slow link.
 enum HTTPRequestTimeout : long {
     HTTPRequestTimeoutLow = 1,
     HTTPRequestTimeoutMedium = 5,
     HTTPRequestTimeoutLong = 120
 };
 
+// What the HTTP layer learned about a host, for logs and telemetry
+struct HTTPHostStats {
+    uint32_t rtt;          // Smoothed, in ms, 0 if not measured yet
+    uint32_t rtt_variance;
+    uint32_t requests;
+    uint32_t timeouts;
+    uint32_t retries;
+};
+
+// Splits "host", "host:port", "[ipv6]" or "[ipv6]:port". A bare IPv6
+// literal is all host. The port is left alone when the address has none,
+// false if the address is empty or its port isn't one.
+bool http_parse_address(const std::string& address, std::string* host,
+                        unsigned short* port);
+// The host as it goes into a URL, IPv6 literals in brackets
+std::string http_url_host(const std::string& host);
+// The address to save for a host, the port only if it isn't default_port
+std::string http_format_address(const std::string& host, unsigned short port,
+                                unsigned short default_port);
+
 int http_init(const std::string& key_directory);
-int http_request(const std::string& url, Data* data, HTTPRequestTimeout timeout);
+// Only requests without side effects should pass idempotent, they get
+// retried with backoff when the host doesn't answer in time
+int http_request(const std::string& url, Data* data, HTTPRequestTimeout timeout,
+                 bool idempotent = false);
+
+// A handle set up like the ones http_request uses, sharing their
+// connections and TLS sessions, for callers running their own curl_multi
+// loop. The response body gets appended to *response.
+CURL* http_acquire_handle(const std::string& url, HTTPRequestTimeout timeout,
+                          std::string* response);
+// Takes the result of the transfer, only a handle that succeeded gets
+// reused. Its timing counts towards the host's round trip time.
+void http_release_handle(const std::string& url, CURL* curl, CURLcode result);
+
+// Takes a saved address, with a port or not. false if no request went to
+// the host yet.
+bool http_host_stats(const std::string& address, HTTPHostStats* stats);
+
+// The IP the last connection to the host went to. Hosts with both IPv4 and
+// IPv6 addresses get both raced, and the winner used until it fails. The
+// host itself until one connected, and for IP literals.
+std::string http_connected_address(const std::string& host);
+
+// Drops kept-alive connections and cached TLS sessions, for when the
+// host's view of our certificate changes
+void http_close_connections();
+void http_cleanup();
 
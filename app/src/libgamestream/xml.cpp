@@ -23,6 +23,7 @@
 
 #include <expat.h>
 #include <string.h>
+#include <vector>
 
 #define STATUS_OK 200
 
@@ -48,41 +49,89 @@ static void XMLCALL _xml_end_element(void* userData, const char* name) {
     }
 }
 
+enum xml_app_field {
+    XML_APP_NONE,
+    XML_APP_ID,
+    XML_APP_TITLE,
+    XML_APP_HDR,
+    XML_APP_COLLECTOR,
+};
+
+struct xml_applist_query {
+    AppInfoList* apps;
+    xml_app_field field;
+    // Text of the current field, reused for every one of them
+    std::string text;
+    int status;
+    std::string status_message;
+};
+
 static void XMLCALL _xml_start_applist_element(void* userData, const char* name,
                                                const char** atts) {
-    struct xml_query* search = (struct xml_query*)userData;
+    struct xml_applist_query* query = (struct xml_applist_query*)userData;
     if (strcmp("App", name) == 0) {
-        PAPP_LIST app = (PAPP_LIST)malloc(sizeof(APP_LIST));
-        if (app == NULL) {
-            return;
+        query->apps->emplace_back();
+        return;
+    }
+
+    if (strcmp("root", name) == 0) {
+        for (int i = 0; atts[i]; i += 2) {
+            if (strcmp("status_code", atts[i]) == 0) {
+                query->status = atoi(atts[i + 1]);
+            } else if (strcmp("status_message", atts[i]) == 0) {
+                query->status_message = atts[i + 1];
+            }
         }
+        return;
+    }
+
+    if (query->apps->empty())
+        return;
 
-        app->id = 0;
-        app->name = NULL;
-        app->next = (PAPP_LIST)search->data;
-        search->data = app;
-    } else if (strcmp("ID", name) == 0 || strcmp("AppTitle", name) == 0) {
-        search->memory = (char*)malloc(1);
-        search->size = 0;
-        search->start = 1;
+    if (strcmp("ID", name) == 0) {
+        query->field = XML_APP_ID;
+    } else if (strcmp("AppTitle", name) == 0) {
+        query->field = XML_APP_TITLE;
+    } else if (strcmp("IsHdrSupported", name) == 0) {
+        query->field = XML_APP_HDR;
+    } else if (strcmp("IsAppCollectorGame", name) == 0) {
+        query->field = XML_APP_COLLECTOR;
+    } else {
+        return;
     }
+    query->text.clear();
 }
 
 static void XMLCALL _xml_end_applist_element(void* userData, const char* name) {
-    struct xml_query* search = (struct xml_query*)userData;
-    if (search->start) {
-        PAPP_LIST list = (PAPP_LIST)search->data;
-        if (list == NULL)
-            return;
+    struct xml_applist_query* query = (struct xml_applist_query*)userData;
+    if (query->field == XML_APP_NONE)
+        return;
 
-        if (strcmp("ID", name) == 0) {
-            list->id = atoi(search->memory);
-            free(search->memory);
-        } else if (strcmp("AppTitle", name) == 0) {
-            list->name = search->memory;
-        }
-        search->start = 0;
+    AppInfo& app = query->apps->back();
+    switch (query->field) {
+    case XML_APP_ID:
+        app.app_id = atoi(query->text.c_str());
+        break;
+    case XML_APP_TITLE:
+        app.name = query->text;
+        break;
+    case XML_APP_HDR:
+        app.hdr_supported = query->text == "1";
+        break;
+    case XML_APP_COLLECTOR:
+        app.app_collector_game = query->text == "1";
+        break;
+    default:
+        break;
     }
+    query->field = XML_APP_NONE;
+}
+
+static void XMLCALL _xml_applist_data(void* userData, const XML_Char* s,
+                                      int len) {
+    struct xml_applist_query* query = (struct xml_applist_query*)userData;
+    if (query->field != XML_APP_NONE)
+        query->text.append(s, len);
 }
 
 static void XMLCALL _xml_start_status_element(void* userData, const char* name,
@@ -118,6 +167,128 @@ static void XMLCALL _xml_write_data(void* userData, const XML_Char* s,
 }
 
 
+struct xml_extraction {
+    const xml_field* fields;
+    size_t count;
+    std::vector<bool> found;
+    int field;
+    int depth;
+    std::string text;
+    int status;
+    std::string status_message;
+};
+
+static void XMLCALL _xml_start_extract_element(void* userData,
+                                               const char* name,
+                                               const char** atts) {
+    struct xml_extraction* extraction = (struct xml_extraction*)userData;
+
+    if (extraction->field >= 0) {
+        // Nested element, its text still belongs to the field
+        extraction->depth++;
+        return;
+    }
+
+    if (strcmp("root", name) == 0) {
+        for (int i = 0; atts[i]; i += 2) {
+            if (strcmp("status_code", atts[i]) == 0) {
+                extraction->status = atoi(atts[i + 1]);
+            } else if (strcmp("status_message", atts[i]) == 0) {
+                extraction->status_message = atts[i + 1];
+            }
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < extraction->count; i++) {
+        if (!extraction->found[i] &&
+            strcmp(extraction->fields[i].node, name) == 0) {
+            extraction->field = (int)i;
+            extraction->depth = 0;
+            extraction->text.clear();
+            return;
+        }
+    }
+}
+
+static void XMLCALL _xml_end_extract_element(void* userData,
+                                             const char* name) {
+    struct xml_extraction* extraction = (struct xml_extraction*)userData;
+    if (extraction->field < 0)
+        return;
+
+    if (extraction->depth > 0) {
+        extraction->depth--;
+        return;
+    }
+
+    // An empty required field doesn't count, a later one still may
+    const xml_field& field = extraction->fields[extraction->field];
+    if (!field.required || !extraction->text.empty()) {
+        if (field.type == XML_FIELD_INT) {
+            *(int*)field.value = atoi(extraction->text.c_str());
+        } else {
+            *(std::string*)field.value = extraction->text;
+        }
+        extraction->found[extraction->field] = true;
+    }
+    extraction->field = -1;
+}
+
+static void XMLCALL _xml_extract_data(void* userData, const XML_Char* s,
+                                      int len) {
+    struct xml_extraction* extraction = (struct xml_extraction*)userData;
+    if (extraction->field >= 0)
+        extraction->text.append(s, len);
+}
+
+int xml_extract(const Data& data, const xml_field* fields, size_t count) {
+    struct xml_extraction extraction;
+    extraction.fields = fields;
+    extraction.count = count;
+    extraction.found.assign(count, false);
+    extraction.field = -1;
+    extraction.depth = 0;
+    extraction.status = 0;
+
+    XML_Parser parser = XML_ParserCreate("UTF-8");
+    XML_SetUserData(parser, &extraction);
+    XML_SetElementHandler(parser, _xml_start_extract_element,
+                          _xml_end_extract_element);
+    XML_SetCharacterDataHandler(parser, _xml_extract_data);
+
+    if (!XML_Parse(parser, (const char*)data.bytes(), (int)data.size(), 1)) {
+        XML_Error code = XML_GetErrorCode(parser);
+        gs_set_error(XML_ErrorString(code));
+        XML_ParserFree(parser);
+        return GS_INVALID;
+    }
+    XML_ParserFree(parser);
+
+    if (extraction.status != STATUS_OK) {
+        gs_set_error(extraction.status_message);
+        return GS_ERROR;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (extraction.found[i])
+            continue;
+
+        if (fields[i].required) {
+            gs_set_error(std::string("Missing ") + fields[i].node +
+                         " in the response");
+            return GS_INVALID;
+        }
+
+        if (fields[i].type == XML_FIELD_INT) {
+            *(int*)fields[i].value = 0;
+        } else {
+            ((std::string*)fields[i].value)->clear();
+        }
+    }
+    return GS_OK;
+}
+
 int xml_search(const Data& data, const std::string node, int* result) {
     std::string text;
     auto res = xml_search(data, node, &text);
@@ -153,28 +324,53 @@ int xml_search(const Data& data, const std::string node, std::string* result) {
     return GS_OK;
 }
 
-int xml_applist(const Data& data, PAPP_LIST* app_list) {
-    struct xml_query query;
-    query.memory = (char*)calloc(1, 1);
-    query.size = 0;
-    query.start = 0;
-    query.data = NULL;
+// Counts <App> tags up front, so the list gets allocated once
+static size_t _xml_count_apps(const Data& data) {
+    static const char tag[] = "<App>";
+    const char* bytes = (const char*)data.bytes();
+    const char* end = bytes + data.size();
+
+    size_t count = 0;
+    for (const char* p = bytes;
+         (p = (const char*)memchr(p, '<', end - p)) != NULL; p++) {
+        if ((size_t)(end - p) >= sizeof(tag) - 1 &&
+            memcmp(p, tag, sizeof(tag) - 1) == 0)
+            count++;
+    }
+    return count;
+}
+
+int xml_applist(const Data& data, AppInfoList* app_list) {
+    struct xml_applist_query query;
+    query.apps = app_list;
+    query.field = XML_APP_NONE;
+    query.text.reserve(256);
+    query.status = 0;
+
+    app_list->clear();
+    app_list->reserve(_xml_count_apps(data));
 
     XML_Parser parser = XML_ParserCreate("UTF-8");
     XML_SetUserData(parser, &query);
     XML_SetElementHandler(parser, _xml_start_applist_element,
                           _xml_end_applist_element);
-    XML_SetCharacterDataHandler(parser, _xml_write_data);
+    XML_SetCharacterDataHandler(parser, _xml_applist_data);
 
     if (!XML_Parse(parser, (const char*)data.bytes(), (int)data.size(), 1)) {
         XML_Error code = XML_GetErrorCode(parser);
         gs_set_error(XML_ErrorString(code));
         XML_ParserFree(parser);
+        app_list->clear();
         return GS_INVALID;
     }
 
     XML_ParserFree(parser);
-    *app_list = (PAPP_LIST)query.data;
+
+    if (query.status != STATUS_OK) {
+        gs_set_error(query.status_message);
+        app_list->clear();
+        return GS_ERROR;
+    }
     return GS_OK;
 }
 
@@ -20,13 +20,39 @@
 #include "Data.hpp"
 #pragma once
 
-typedef struct _APP_LIST {
-    char* name;
-    int id;
-    struct _APP_LIST* next;
-} APP_LIST, *PAPP_LIST;
+#include <string>
+#include <vector>
+
+struct AppInfo {
+    std::string name;
+    int app_id = 0;
+    bool hdr_supported = false;
+    // GFE's own collection of games rather than one the user added
+    bool app_collector_game = false;
+};
+
+using AppInfoList = std::vector<AppInfo>;
+
+enum xml_field_type { XML_FIELD_STRING, XML_FIELD_INT };
+
+// Where xml_extract stores the text of an element, value points to a
+// std::string or an int depending on type
+typedef struct _XML_FIELD {
+    const char* node;
+    xml_field_type type;
+    void* value;
+    bool required;
+} xml_field;
+
+// Checks the status of the root element and fills every field in a single
+// pass over the document. The first element of each name counts, missing
+// fields come out empty or 0, and required ones need some text.
+// Returns GS_ERROR with the host's status message for a failed request.
+int xml_extract(const Data& data, const xml_field* fields, size_t count);
 
 int xml_search(const Data& data, const std::string node, int* result);
 int xml_search(const Data& data, const std::string node, std::string* result);
-int xml_applist(const Data& data, PAPP_LIST* app_list);
+// Apps in the order the host lists them, GS_ERROR with the host's status
+// message for a failed request
+int xml_applist(const Data& data, AppInfoList* app_list);
 int xml_status(const Data& data);
@@ -21,6 +21,13 @@ const std::string loadingOverlayXML = R"xml(
         width="92"
         height="92"/>
 
+    <brls:Label
+        id="status"
+        fontSize="18"
+        marginTop="16"
+        textColor="@theme/brls/header/subtitle"
+        horizontalAlign="center"/>
+
 </brls:Box>
 )xml";
 
@@ -42,6 +49,15 @@ void LoadingOverlay::layout() {
 }
 
 void LoadingOverlay::setHidden(bool hide) {
+    hidden = hide;
     setAlpha(hide ? 0 : 1);
     progress->animate(!hide);
 }
+
+void LoadingOverlay::setStatus(const std::string& status) {
+    if (this->status == status)
+        return;
+
+    this->status = status;
+    statusLabel->setText(status);
+}
@@ -23,6 +23,8 @@
 #include "settings_tab.hpp"
 
 #include "DiscoverManager.hpp"
+#include "GameStreamClient.hpp"
+#include "HostMonitor.hpp"
 #include "MoonlightSession.hpp"
 #include "SwitchMoonlightSessionDecoderAndRenderProvider.hpp"
 #include "utils/LogManager.hpp"
@@ -89,6 +91,8 @@ int main(int argc, char* argv[]) {
         brls::Logger::info("Working dir: {}", home);
     }
 
+    GameStreamClient::prepare_keys();
+
     // Have the application register an action on every activity that will quit
     // when you press BUTTON_START
     brls::Application::setGlobalQuit(false);
@@ -121,10 +125,13 @@ int main(int argc, char* argv[]) {
     brls::Application::enableDebuggingView(Settings::instance().write_log());
     brls::Application::setSwapInputKeys(Settings::instance().swap_ui_keys());
 
+    HostMonitor::instance().start();
+
     // Run the app
     while (brls::Application::mainLoop())
         ;
 
+    HostMonitor::instance().stop();
     GameStreamClient::instance().stop();
     DiscoverManager::instance().pause();
     
@@ -29,11 +29,45 @@ bool canStartApp(int argc, char** argv) {
     return true;
 }
 
+void pushStreamingView(StreamingView* view) {
+    auto* frame = new AppletFrame(view);
+    frame->setBackground(ViewBackground::NONE);
+    frame->setHeaderVisibility(brls::Visibility::GONE);
+    frame->setFooterVisibility(brls::Visibility::GONE);
+    Application::pushActivity(new Activity(frame));
+}
+
+// --replay=<file> [--replay-fast] plays a recorded session back offline
+bool startReplayFromArgs(int argc, char** argv) {
+    std::string replay_pref = "--replay=";
+    std::string file;
+    bool fast = false;
+
+    for (int i = 1; i < argc; i++) {
+        auto arg = std::string(argv[i]);
+
+        if (arg.rfind(replay_pref, 0) == 0) {
+            file = arg.substr(replay_pref.length());
+        } else if (arg == "--replay-fast") {
+            fast = true;
+        }
+    }
+
+    if (file.empty()) return false;
+
+    Logger::debug("Replay {}", file);
+
+    pushStreamingView(new StreamingView(file, fast));
+    return true;
+}
+
 bool startFromArgs(int argc, char** argv) {
     if (!canStartApp(argc, argv)) return true;
 
     if (argc <= 1) return false;
 
+    if (startReplayFromArgs(argc, argv)) return true;
+
     std::string args_pref[4] = {"--host=", "--ip=", "--appid=", "--appname="};
     std::string args[4];
 
@@ -70,11 +104,7 @@ bool startFromArgs(int argc, char** argv) {
         const Host& host = *it;
         AppInfo info { appName, stoi(appId) };
 
-        auto* frame = new AppletFrame(new StreamingView(host, info));
-        frame->setBackground(ViewBackground::NONE);
-        frame->setHeaderVisibility(brls::Visibility::GONE);
-        frame->setFooterVisibility(brls::Visibility::GONE);
-        Application::pushActivity(new Activity(frame));
+        pushStreamingView(new StreamingView(host, info));
 
         return true;
     }
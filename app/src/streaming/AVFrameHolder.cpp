@@ -11,7 +11,7 @@ AVFrameQueue::AVFrameQueue() {}
 
 AVFrameQueue::~AVFrameQueue() {
     for (; !queue.empty(); queue.pop()) {
-        AVFrame* frame = queue.front();
+        AVFrame* frame = queue.front().frame;
         av_frame_free(&frame);
     }
 
@@ -21,9 +21,9 @@ AVFrameQueue::~AVFrameQueue() {
     }
 }
 
-void AVFrameQueue::push(AVFrame* item) {
+void AVFrameQueue::push(AVFrame* item, const AVFrameTiming& timing) {
     std::lock_guard<std::mutex> lock(m_mutex);
-    queue.push(item);
+    queue.push({item, timing});
 
     if (queue.size() > limit) {
         queue.pop();
@@ -31,20 +31,42 @@ void AVFrameQueue::push(AVFrame* item) {
     }
 }
 
-AVFrame* AVFrameQueue::pop() {
+AVFrame* AVFrameQueue::pop(AVFrameTiming* timing, bool* is_new) {
     std::lock_guard<std::mutex> lock(m_mutex);
 
     if (!queue.empty()) {
-        AVFrame* item = queue.front();
+        Item item = queue.front();
         queue.pop();
-        bufferFrame = item;
+        bufferFrame = item.frame;
+        bufferTiming = item.timing;
+        *is_new = true;
     } else {
         fakeFrameUsedStat ++;
+        *is_new = false;
     }
 
+    *timing = bufferTiming;
     return bufferFrame;
 }
 
+size_t AVFrameQueue::trim(size_t max_size) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    size_t dropped = 0;
+    while (queue.size() > max_size) {
+        queue.pop();
+        dropped++;
+    }
+
+    framesDroppedStat += dropped;
+    return dropped;
+}
+
+void AVFrameQueue::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    queue = {};
+}
+
 size_t AVFrameQueue::size() const {
     return queue.size();
 }
@@ -62,5 +84,6 @@ void AVFrameQueue::cleanup() {
     fakeFrameUsedStat = 0;
     framesDroppedStat = 0;
     bufferFrame = nullptr;
+    bufferTiming = {};
     queue = {};
 }
\ No newline at end of file
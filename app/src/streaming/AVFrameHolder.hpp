@@ -10,13 +10,25 @@ extern "C" {
 #include <libavcodec/avcodec.h>
 }
 
+// Timestamps travelling with a decoded frame, used for A/V sync
+struct AVFrameTiming {
+    uint32_t host_pts = 0;      // Host presentation time, ms
+    uint64_t receive_time = 0;  // LiGetMillis() when the first packet arrived
+};
+
 class AVFrameQueue {
 public:
     explicit AVFrameQueue();
     ~AVFrameQueue();
 
-    void push(AVFrame* item);
-    AVFrame* pop();
+    void push(AVFrame* item, const AVFrameTiming& timing);
+    AVFrame* pop(AVFrameTiming* timing, bool* is_new);
+
+    // Drops the oldest frames until at most max_size remain
+    size_t trim(size_t max_size);
+    // Drops every queued frame without counting them as drops, the last
+    // shown one stays
+    void clear();
 
     [[nodiscard]] size_t size() const;
     [[nodiscard]] size_t getFakeFrameUsage() const;
@@ -26,10 +38,16 @@ public:
 
 private:
     friend class AVFrameHolder;
+    struct Item {
+        AVFrame* frame;
+        AVFrameTiming timing;
+    };
+
     size_t limit;
-    std::queue<AVFrame*> queue;
+    std::queue<Item> queue;
     std::queue<AVFrame*> freeQueue;
     AVFrame* bufferFrame = nullptr;
+    AVFrameTiming bufferTiming;
     std::mutex m_mutex;
     size_t fakeFrameUsedStat = 0;
     size_t framesDroppedStat = 0;
@@ -37,8 +55,8 @@ private:
 
 class AVFrameHolder : public Singleton<AVFrameHolder> {
   public:
-    void push(AVFrame* frame) {
-        m_frame_queue.push(frame);
+    void push(AVFrame* frame, const AVFrameTiming& timing = {}) {
+        m_frame_queue.push(frame, timing);
         
         #ifdef PLATFORM_SWITCH
         #ifdef VERBOSE_FRAME_LOGGING
@@ -48,8 +66,12 @@ class AVFrameHolder : public Singleton<AVFrameHolder> {
         #endif
     }
 
-    void get(const std::function<void(AVFrame*)>& fn) {
-        auto frame = m_frame_queue.pop();
+    // is_new is false when the previous frame is shown again
+    // because nothing new was decoded in time
+    void get(const std::function<void(AVFrame*, const AVFrameTiming&, bool is_new)>& fn) {
+        AVFrameTiming timing;
+        bool is_new = false;
+        auto frame = m_frame_queue.pop(&timing, &is_new);
 
         if (frame) {
             #ifdef PLATFORM_SWITCH
@@ -58,7 +80,7 @@ class AVFrameHolder : public Singleton<AVFrameHolder> {
                                (void*)frame, m_frame_queue.size());
             #endif
             #endif
-            fn(frame);
+            fn(frame, timing, is_new);
         }
     }
 
@@ -70,6 +92,9 @@ class AVFrameHolder : public Singleton<AVFrameHolder> {
         m_frame_queue.cleanup();
     }
 
+    size_t trim(size_t max_size) { return m_frame_queue.trim(max_size); }
+    void clear() { m_frame_queue.clear(); }
+
     [[nodiscard]] size_t getFakeFrameStat() const { return m_frame_queue.getFakeFrameUsage(); }
     [[nodiscard]] size_t getFrameDropStat() const { return m_frame_queue.getFramesDropStat(); }
     [[nodiscard]] size_t getFrameQueueSize() const { return m_frame_queue.size(); }
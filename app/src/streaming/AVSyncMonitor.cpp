@@ -0,0 +1,105 @@
+#include "AVSyncMonitor.hpp"
+#include "Settings.hpp"
+#include <Limelight.h>
+#include <borealis.hpp>
+#include <cmath>
+
+static float smooth(float current, float sample, bool has_value, float factor) {
+    return has_value ? current + (sample - current) * factor : sample;
+}
+
+void AVSyncMonitor::prepare() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_stats = {};
+    m_has_video = false;
+    m_has_audio = false;
+    m_audio_packets = 0;
+    m_audio_skip = 0;
+    m_last_correction = 0;
+    m_correction = Settings::instance().av_sync_correction();
+    m_target = Settings::instance().av_sync_target();
+}
+
+void AVSyncMonitor::set_audio_format(int samples_per_frame, int sample_rate) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_audio_frame_duration =
+        sample_rate > 0 ? (float)samples_per_frame * 1000 / sample_rate : 0;
+}
+
+bool AVSyncMonitor::audio_received() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Audio packets carry no host timestamp, but the host sends them
+    // at a fixed cadence, so the packet index gives the host timeline
+    m_stats.audio_host_pts =
+        (uint32_t)(m_audio_packets++ * m_audio_frame_duration);
+
+    if (m_audio_skip > 0) {
+        m_audio_skip -= m_audio_frame_duration;
+        return false;
+    }
+    return true;
+}
+
+void AVSyncMonitor::audio_queued(int queued_duration) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_stats.audio_latency = smooth(m_stats.audio_latency,
+                                   (float)queued_duration, m_has_audio,
+                                   smoothing);
+    m_has_audio = true;
+}
+
+void AVSyncMonitor::video_presented(const AVFrameTiming& timing) {
+    if (timing.receive_time == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint64_t now = LiGetMillis();
+    m_stats.video_host_pts = timing.host_pts;
+    m_stats.video_latency =
+        smooth(m_stats.video_latency, (float)(now - timing.receive_time),
+               m_has_video, smoothing);
+    m_has_video = true;
+
+    if (m_has_audio) {
+        m_stats.av_offset = m_stats.video_latency - m_stats.audio_latency;
+        correct(now);
+    }
+}
+
+void AVSyncMonitor::correct(uint64_t now) {
+    if (!m_correction || now - m_last_correction < correction_interval_ms)
+        return;
+
+    if (std::fabs(m_stats.av_offset) <= (float)m_target)
+        return;
+
+    m_last_correction = now;
+
+    if (m_stats.av_offset > 0) {
+        // Video is late, show the newest decoded frame right away
+        size_t dropped = AVFrameHolder::instance().trim(1);
+        if (dropped == 0)
+            return;
+
+        brls::Logger::debug("AVSyncMonitor: Offset {:.1f} ms, dropped {} frames",
+                            m_stats.av_offset, dropped);
+    } else {
+        // Audio is late, let the device queue drain by the excess
+        m_audio_skip = -m_stats.av_offset - (float)m_target / 2;
+
+        brls::Logger::debug("AVSyncMonitor: Offset {:.1f} ms, skipping {:.1f} ms of audio",
+                            m_stats.av_offset, m_audio_skip);
+    }
+
+    m_stats.corrections++;
+}
+
+AVSyncStats AVSyncMonitor::stats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "AVFrameHolder.hpp"
+#include "Singleton.hpp"
+#include <cstdint>
+#include <mutex>
+
+struct AVSyncStats {
+    // Time from the first network packet to presentation, ms
+    float video_latency;
+    float audio_latency;
+
+    // video_latency - audio_latency, positive when video is behind audio
+    float av_offset;
+
+    // Host timestamps of the last presented frame / queued audio packet
+    uint32_t video_host_pts;
+    uint32_t audio_host_pts;
+
+    uint32_t corrections;
+};
+
+// Compares when audio and video actually reach the user.
+// Both sides are measured from the moment their data was received, so the
+// difference shows how far apart the two pipelines are, regardless of how
+// deep each of the queues is.
+// With av_sync_correction enabled, the side that runs behind gets trimmed:
+// queued video frames are dropped, or incoming audio packets are skipped
+// until the device queue drains.
+class AVSyncMonitor : public Singleton<AVSyncMonitor> {
+  public:
+    void prepare();
+    void set_audio_format(int samples_per_frame, int sample_rate);
+
+    // Audio thread, returns false if the packet should not be played
+    bool audio_received();
+    void audio_queued(int queued_duration);
+
+    // Render thread, for every newly presented frame
+    void video_presented(const AVFrameTiming& timing);
+
+    [[nodiscard]] AVSyncStats stats();
+
+  private:
+    void correct(uint64_t now);
+
+    static constexpr float smoothing = 0.05f;
+    static constexpr int correction_interval_ms = 1000;
+
+    std::mutex m_mutex;
+    AVSyncStats m_stats = {};
+
+    bool m_has_video = false;
+    bool m_has_audio = false;
+    bool m_correction = false;
+    int m_target = 0;
+
+    float m_audio_frame_duration = 0;
+    uint64_t m_audio_packets = 0;
+    float m_audio_skip = 0;
+    uint64_t m_last_correction = 0;
+};
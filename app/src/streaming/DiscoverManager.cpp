@@ -7,6 +7,10 @@
 
 #include "DiscoverManager.hpp"
 #include "GameStreamClient.hpp"
+#include "NetworkInterfaces.hpp"
+#include "RequestExecutor.hpp"
+#include <Limelight.h>
+#include <algorithm>
 
 using namespace brls::literals;
 
@@ -15,8 +19,11 @@ DiscoverManager::DiscoverManager() {
     start();
 }
 
+// Probes and serverinfo requests still running finish, their results get
+// dropped
 void DiscoverManager::reset() {
     pause();
+    generation++;
     counter = 0;
     addresses.clear();
     _hosts.clear();
@@ -32,44 +39,98 @@ void DiscoverManager::start() {
             return;
         }
 
+        network = GameStreamClient::local_network();
+        sweepStart = LiGetMillis();
         paused = true;
     }
 
     if (paused) {
         paused = false;
-        brls::async([] { DiscoverManager::instance().loop(); });
+
+        // A batch from before the pause carries on by itself
+        if (!probing)
+            probeNext();
     }
     brls::sync([this] { getHostsUpdateEvent()->fire(hosts); });
 }
 
 void DiscoverManager::pause() { paused = true; }
 
-void DiscoverManager::loop() {
-    brls::async([this] {
-        while (counter < addresses.size() && !paused) {
-            SERVER_DATA server_data;
+void DiscoverManager::probeNext() {
+    if (paused)
+        return;
+
+    if (counter >= addresses.size()) {
+        finishSweep();
+        return;
+    }
+
+    size_t end = std::min(counter + probe_batch, addresses.size());
+    std::vector<std::string> batch(addresses.begin() + counter,
+                                   addresses.begin() + end);
+    counter = end;
+    probing = true;
+
+    uint64_t batchGeneration = generation;
+    RequestExecutor::instance().submit<std::vector<std::string>>(
+        REQUEST_PRIORITY_DISCOVERY, network, nullptr,
+        [batch] {
+            return GSResult<std::vector<std::string>>::success(
+                network_probe(batch, probe_port, probe_timeout_ms));
+        },
+        [this, batchGeneration](GSResult<std::vector<std::string>> result) {
+            probing = false;
+
+            if (batchGeneration == generation) {
+                for (const std::string& address : result.value())
+                    checkHost(address);
+            }
+
+            probeNext();
+        });
+}
+
+void DiscoverManager::checkHost(const std::string& address) {
+    checking++;
 
-            int status = gs_init(&server_data, addresses[counter]);
-            if (status == GS_OK) {
+    uint64_t checkGeneration = generation;
+    GameStreamClient::instance().connect(
+        address,
+        [this, address, checkGeneration](GSResult<SERVER_DATA> result) {
+            checking--;
+
+            bool known = std::any_of(_hosts.begin(), _hosts.end(),
+                                     [&address](const Host& host) {
+                                         return host.address == address;
+                                     });
+            if (checkGeneration == generation && result.isSuccess() &&
+                !known) {
                 Host host;
-                host.address = addresses[counter];
-                host.hostname = server_data.hostname;
-                host.mac = server_data.mac;
+                host.address = address;
+                host.hostname = result.value().hostname;
+                host.mac = result.value().mac;
                 _hosts.push_back(host);
                 hosts = hosts.success(_hosts);
-                brls::sync([this] { getHostsUpdateEvent()->fire(hosts); });
+                getHostsUpdateEvent()->fire(hosts);
             }
 
-            counter++;
-        }
+            finishSweep();
+        },
+        false);
+}
 
-        if (counter == addresses.size() && _hosts.empty()) {
-            hosts = hosts.failure("discovery_manager/no_host"_i18n);
-            brls::sync([this] { getHostsUpdateEvent()->fire(hosts); });
-        }
+// Once every address got probed and every responsive one answered
+void DiscoverManager::finishSweep() {
+    if (probing || checking > 0 || counter < addresses.size() || paused)
+        return;
 
-        paused = true;
-    });
+    brls::Logger::info("DiscoverManager: {} hosts found on {} in {} ms",
+                       _hosts.size(), network, LiGetMillis() - sweepStart);
+
+    paused = true;
+    if (_hosts.empty())
+        hosts = hosts.failure("discovery_manager/no_host"_i18n);
+    getHostsUpdateEvent()->fire(hosts);
 }
 
 DiscoverManager::~DiscoverManager() { paused = true; }
@@ -11,9 +11,14 @@
 #include "Settings.hpp"
 #include "Singleton.hpp"
 #include <borealis.hpp>
-#include <pthread.h>
+#include <cstdint>
 #include <stdio.h>
 
+// Looks for hosts on the local networks where multicast isn't available.
+// They get probed probe_batch addresses at a time with non-blocking
+// connects to the GameStream port, only the ones that accept get a
+// serverinfo request. Found hosts go out with the update event as they
+// come. Everything but the probes runs on the UI thread.
 class DiscoverManager : public Singleton<DiscoverManager> {
   public:
     DiscoverManager();
@@ -32,11 +37,23 @@ class DiscoverManager : public Singleton<DiscoverManager> {
     void pause();
 
   private:
-    void loop();
+    void probeNext();
+    void checkHost(const std::string& address);
+    void finishSweep();
+
+    static constexpr uint16_t probe_port = 47989;
+    static constexpr size_t probe_batch = 32;
+    static constexpr int probe_timeout_ms = 400;
+
     std::vector<std::string> addresses;
+    std::string network;
     GSResult<std::vector<Host>> hosts;
     std::vector<Host> _hosts;
     brls::Event<GSResult<std::vector<Host>>> hostsUpdateEvent;
-    int counter = 0;
+    size_t counter = 0;
     bool paused = true;
+    bool probing = false;
+    int checking = 0;
+    uint64_t generation = 0;
+    uint64_t sweepStart = 0;
 };
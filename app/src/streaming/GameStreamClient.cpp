@@ -1,41 +1,20 @@
 #include "GameStreamClient.hpp"
+#include "MdnsDiscovery.hpp"
+#include "NetworkInterfaces.hpp"
+#include "RequestExecutor.hpp"
 #include "Settings.hpp"
 #include "WakeOnLanManager.hpp"
+#include <Limelight.h>
+#include <algorithm>
 #include <borealis.hpp>
+#include <set>
 #include <thread>
 #include <unistd.h>
 #include <vector>
 
 #include <curl/curl.h>
-#include <libretro-common/retro_timers.h>
 #include <cstring>
 
-#include <arpa/inet.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <fmt/core.h>
-
-#ifndef PLATFORM_PSV
-#include <net/if.h>
-#include <sys/ioctl.h>
-#endif
-
-#if defined(PLATFORM_SWITCH)
-#include <switch.h>
-
-// TODO: Remove when presented in LibNX
-struct ipv6_mreq {
-	struct in6_addr ipv6mr_multiaddr;
-	unsigned int    ipv6mr_interface;
-};
-#endif
-
-#ifndef MULTICAST_DISABLED
-extern "C" {
-#include <mdns.h>
-}
-#endif
-
 using namespace brls;
 
 GameStreamClient::GameStreamClient() { start(); }
@@ -44,143 +23,49 @@ void GameStreamClient::start() {}
 
 void GameStreamClient::stop() {}
 
-static uint32_t get_my_ip_address() {
-    uint32_t address = 0;
-#if defined(__linux) || defined(__APPLE__)
-    struct ifreq ifr;
-    ifr.ifr_addr.sa_family = AF_INET;
-    strncpy(ifr.ifr_name, "en0", IFNAMSIZ - 1);
+void GameStreamClient::prepare_keys() { gs_prepare_keys(); }
 
-    int fd = socket(AF_INET, SOCK_DGRAM, 0);
-    ioctl(fd, SIOCGIFADDR, &ifr);
-    close(fd);
-
-    address = ((struct sockaddr_in*)&ifr.ifr_addr)->sin_addr.s_addr;
-#elif defined(PLATFORM_SWITCH)
-    nifmGetCurrentIpAddress(&address);
-#endif
-    return address;
-}
+// Hosts on networks wider than this only get looked for around us
+#define MAX_FIND_ADDRESSES_PER_NETWORK 512
 
 std::vector<std::string> GameStreamClient::host_addresses_for_find() {
     std::vector<std::string> addresses;
-
-    uint32_t address = get_my_ip_address();
-    bool isSucceed = address != 0;
-
-    if (isSucceed) {
-        uint32_t a = address & 0xFF;
-        uint32_t b = (address >> 8) & 0xFF;
-        uint32_t c = (address >> 16) & 0xFF;
-        uint32_t d = (address >> 24) & 0xFF;
-
-        for (int i = 0; i < 256; i++) {
-            if (i == d) {
-                continue;
-            }
-            addresses.push_back(std::to_string(a) + "." + std::to_string(b) +
-                                "." + std::to_string(c) + "." +
-                                std::to_string(i));
+    std::set<std::string> seen;
+
+    for (const auto& interface : network_interfaces()) {
+        for (auto& address :
+             network_hosts(interface, MAX_FIND_ADDRESSES_PER_NETWORK)) {
+            // Two interfaces can share a network
+            if (seen.insert(address).second)
+                addresses.push_back(std::move(address));
         }
     }
     return addresses;
 }
 
-bool GameStreamClient::can_find_host() { return get_my_ip_address() != 0; }
-
-#ifndef MULTICAST_DISABLED
- static std::vector<Host> foundHosts;
- static std::string foundHost;
-
-std::string get_ip_str(const struct sockaddr *addr)
-{
-    char addrStr[INET6_ADDRSTRLEN];
-    if (addr->sa_family == AF_INET) {
-        inet_ntop(addr->sa_family, &((struct sockaddr_in*)addr)->sin_addr, addrStr, sizeof(addrStr));
-        unsigned short port = htons(((struct sockaddr_in*)addr)->sin_port);
-        return fmt::format("{}", addrStr);
-    }
-    else {
-        struct sockaddr_in6* sin6 = (struct sockaddr_in6*)addr;
-        inet_ntop(addr->sa_family, &sin6->sin6_addr, addrStr, sizeof(addrStr));
-        unsigned short port = ntohs(((struct sockaddr_in6*)addr)->sin6_port);
-        if (sin6->sin6_scope_id != 0) {
-            // Link-local addresses with scope IDs are special
-            return fmt::format("{}{}", addrStr, sin6->sin6_scope_id);
-        }
-        else {
-            return fmt::format("{}", addrStr);
-        }
-    }
+bool GameStreamClient::can_find_host() {
+    auto interfaces = network_interfaces();
+    return std::any_of(interfaces.begin(), interfaces.end(),
+                       [](const NetworkInterface& interface) {
+                           return interface.address != 0;
+                       });
 }
 
-static int mdns_discovery_callback(int sock, const struct sockaddr* from, size_t addrlen,
-                                   mdns_entry_type_t entry, uint16_t query_id, uint16_t type,
-                                   uint16_t rclass, uint32_t ttl, const void* data, size_t size,
-                                   size_t offset, size_t length, size_t record_offset,
-                                   size_t record_length, void* user_data)
-{
-    if (type == MDNS_RECORDTYPE_A) {
-        foundHost = get_ip_str(from);
+std::string GameStreamClient::local_network() {
+    for (const auto& interface : network_interfaces()) {
+        if (interface.address != 0)
+            return network_cidr(interface);
     }
-    return 0;
+    return "unknown";
 }
 
+#ifndef MULTICAST_DISABLED
 void GameStreamClient::find_hosts(ServerCallback<std::vector<Host>>& callback) {
-    brls::async([callback] {
-        foundHosts.clear();
-
-        size_t capacity = 2048;
-        void* buffer = malloc(capacity);
-        size_t records;
-
-
-        int sock = mdns_socket_open_ipv4(nullptr);
-        if (sock < 0) {
-            return;
-        }
-
-        if (mdns_query_send(sock, MDNS_RECORDTYPE_PTR,
-                        MDNS_STRING_CONST("_nvstream._tcp.local"),
-                        buffer, capacity, 0)) {
-            brls::sync([callback] {
-                callback(GSResult<std::vector<Host>>::failure(
-                        "error/unknown_error"_i18n));
-            });
-            return;
-        }
-
-        int empty_cnt = 0;
-        while (true) {
-            records = mdns_query_recv(sock, buffer, capacity, mdns_discovery_callback, (void*)(&callback), 0);
-            if (records == 0) {
-                empty_cnt++;
-            } else {
-                empty_cnt = 0;
-
-                SERVER_DATA server_data;
-
-                int status = gs_init(&server_data, foundHost);
-                if (status == GS_OK) {
-                    Host host;
-                    host.address = foundHost;
-                    host.hostname = server_data.hostname;
-                    host.mac = server_data.mac;
-                    foundHosts.push_back(host);
-
-                    brls::sync([callback] {
-                        callback(GSResult<std::vector<Host>>::success(foundHosts));
-                    });
-                }
-            }
-            // wait 30sec after last receive
-            if (empty_cnt >= 10) {
-                break;
-            }
+    MdnsDiscovery::instance().start(callback);
+}
 
-            retro_sleep(500);
-        }
-    });
+void GameStreamClient::stop_finding_hosts() {
+    MdnsDiscovery::instance().stop();
 }
 #endif
 
@@ -190,168 +75,211 @@ bool GameStreamClient::can_wake_up_host(const Host& host) {
 
 void GameStreamClient::wake_up_host(const Host& host,
                                     ServerCallback<bool>& callback) {
-    brls::async([host, callback] {
+    // Calls back as soon as the host is up rather than after a fixed wait.
+    // That can take half a minute of sleeping between probes, so it gets a
+    // thread of its own instead of holding a request worker meanwhile.
+    std::thread([host, callback] {
         auto result = WakeOnLanManager::wake_up_host(host);
+        brls::sync([callback, result] { callback(result); });
+    }).detach();
+}
 
-        if (result.isSuccess()) {
-            usleep(5'000'000);
-            brls::sync([callback, result] { callback(result); });
-        } else {
-            brls::sync([callback, result] { callback(result); });
-        }
-    });
+std::shared_ptr<const SERVER_DATA>
+GameStreamClient::cached_server(const std::string& address) {
+    std::lock_guard<std::mutex> lock(m_server_mutex);
+    auto it = m_server_data.find(address);
+    if (it == m_server_data.end())
+        return nullptr;
+    return it->second.data;
+}
+
+// Data that changed on our side, like after pairing or a launch, isn't
+// fresh: the next connect() asks the host again
+void GameStreamClient::store_server(const std::string& address,
+                                    const SERVER_DATA& data, bool fresh) {
+    auto snapshot = std::make_shared<const SERVER_DATA>(data);
+    std::lock_guard<std::mutex> lock(m_server_mutex);
+    m_server_data[address] = {snapshot, fresh ? LiGetMillis() : 0};
+}
+
+void GameStreamClient::invalidate(const std::string& address) {
+    std::lock_guard<std::mutex> lock(m_server_mutex);
+    auto it = m_server_data.find(address);
+    if (it != m_server_data.end())
+        it->second.fetched_at = 0;
+}
+
+SERVER_DATA GameStreamClient::server_data(const std::string& address) {
+    auto server = cached_server(address);
+    return server ? *server : SERVER_DATA();
 }
 
 void GameStreamClient::connect(const std::string& address,
-                               ServerCallback<SERVER_DATA>& callback) {
+                               ServerCallback<SERVER_DATA>& callback,
+                               bool cached, const RequestToken* token) {
     if (address.empty()) {
         callback(GSResult<SERVER_DATA>::failure("Address is Empty"));
         return;
     }
 
-    SERVER_DATA* data = new SERVER_DATA();
-    brls::async([this, address, callback, data] {
-        int status = gs_init(data, address);
+    auto cancelled = token ? token->state() : nullptr;
+    auto deliver = [callback, cancelled](GSResult<SERVER_DATA> result) {
+        if (!cancelled || !*cancelled)
+            callback(result);
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(m_server_mutex);
+        auto it = m_server_data.find(address);
+        if (cached && it != m_server_data.end() && it->second.fetched_at &&
+            LiGetMillis() - it->second.fetched_at < server_data_ttl_ms) {
+            auto server = it->second.data;
+            brls::sync([deliver, server] {
+                deliver(GSResult<SERVER_DATA>::success(*server));
+            });
+            return;
+        }
+
+        // A fetch is on its way already
+        auto& waiters = m_connecting[address];
+        waiters.push_back(deliver);
+        if (waiters.size() > 1)
+            return;
+    }
+
+    // Shared by every waiter, so it has no token of its own
+    RequestExecutor::instance().submit<SERVER_DATA>(
+        REQUEST_PRIORITY_SERVERINFO, address, nullptr,
+        [this, address] {
+            SERVER_DATA data = SERVER_DATA();
+            int status = gs_init(&data, address);
 
-        brls::sync([this, address, callback, status, data] {
-            if (status == GS_OK) {
-                m_server_data[address] = *data;
-                callback(GSResult<SERVER_DATA>::success(m_server_data[address]));
-            } else {
-                callback(GSResult<SERVER_DATA>::failure(gs_error()));
+            if (status != GS_OK) {
+                invalidate(address);
+                return GSResult<SERVER_DATA>::failure(gs_error());
             }
+
+            store_server(address, data, true);
+            return GSResult<SERVER_DATA>::success(data);
+        },
+        [this, address](GSResult<SERVER_DATA> result) {
+            std::vector<std::function<void(GSResult<SERVER_DATA>)>> waiters;
+            {
+                std::lock_guard<std::mutex> lock(m_server_mutex);
+                waiters = std::move(m_connecting[address]);
+                m_connecting.erase(address);
+            }
+
+            for (auto& waiter : waiters)
+                waiter(result);
         });
-    });
 }
 
 void GameStreamClient::pair(const std::string& address, const std::string& pin,
-                            ServerCallback<bool>& callback) {
-    if (m_server_data.count(address) == 0) {
+                            ServerCallback<bool>& callback,
+                            const RequestToken* token) {
+    auto server = cached_server(address);
+    if (!server) {
         callback(GSResult<bool>::failure("Firstly call connect()..."));
         return;
     }
 
-    brls::async([this, address, pin, callback] {
-        int status = gs_pair(&m_server_data[address], (char*)pin.c_str());
-
-        brls::sync([callback, status] {
-            if (status == GS_OK) {
-                callback(GSResult<bool>::success(true));
-            } else {
-                callback(GSResult<bool>::failure(gs_error()));
-            }
-        });
-    });
+    RequestExecutor::instance().submit<bool>(
+        REQUEST_PRIORITY_SESSION, address, token,
+        [this, address, server, pin] {
+            SERVER_DATA data = *server;
+            if (gs_pair(&data, (char*)pin.c_str()) != GS_OK)
+                return GSResult<bool>::failure(gs_error());
+
+            store_server(address, data, false);
+            return GSResult<bool>::success(true);
+        },
+        callback);
 }
 
 void GameStreamClient::applist(const std::string& address,
-                               ServerCallback<AppInfoList>& callback) {
-    if (m_server_data.count(address) == 0) {
+                               ServerCallback<AppInfoList>& callback,
+                               const RequestToken* token) {
+    auto server = cached_server(address);
+    if (!server) {
         callback(GSResult<AppInfoList>::failure(
             "Firstly call connect() & pair()..."));
         return;
     }
 
-    brls::async([this, address, callback] {
-        PAPP_LIST list;
-
-        int status = gs_applist(&m_server_data[address], &list);
-        if (status != CURLE_OK) {
-            callback(GSResult<AppInfoList>::failure(gs_error()));
-            return;
-        }
-
-        AppInfoList app_list;
-
-        while (list) {
-
-            std::string name = std::string(list->name);
-            int id = list->id;
-            AppInfo info;
-            info.name = name;
-            info.app_id = id;
-            app_list.push_back(info);
-            list = list->next;
-        }
-
-        std::sort(app_list.begin(), app_list.end(),
-                  [](const AppInfo& a, const AppInfo& b) { return a.name < b.name; });
-
-        brls::sync([app_list, callback, status] {
-            if (status == GS_OK) {
-                callback(GSResult<AppInfoList>::success(app_list));
-            } else {
-                callback(GSResult<AppInfoList>::failure(gs_error()));
-            }
-        });
-    });
+    RequestExecutor::instance().submit<AppInfoList>(
+        REQUEST_PRIORITY_APPLIST, address, token,
+        [server] {
+            SERVER_DATA data = *server;
+            AppInfoList app_list;
+            if (gs_applist(&data, &app_list) != GS_OK)
+                return GSResult<AppInfoList>::failure(gs_error());
+
+            std::sort(app_list.begin(), app_list.end(),
+                      [](const AppInfo& a, const AppInfo& b) {
+                          return a.name < b.name;
+                      });
+            return GSResult<AppInfoList>::success(std::move(app_list));
+        },
+        callback);
 }
 
-void GameStreamClient::app_boxart(const std::string& address, int app_id,
-                                  ServerCallback<Data>& callback) {
-    if (m_server_data.count(address) == 0) {
-        callback(GSResult<Data>::failure("Firstly call connect() & pair()..."));
-        return;
-    }
-
-    brls::async([this, address, app_id, callback] {
-        Data data;
-        int status = gs_app_boxart(&m_server_data[address], app_id, &data);
+std::string GameStreamClient::app_boxart_url(const std::string& address,
+                                             int app_id) {
+    auto server = cached_server(address);
+    if (!server)
+        return "";
 
-        brls::sync([callback, data, status] {
-            if (status == GS_OK) {
-                callback(GSResult<Data>::success(data));
-            } else {
-                callback(GSResult<Data>::failure(gs_error()));
-            }
-        });
-    });
+    SERVER_DATA data = *server;
+    return gs_app_boxart_url(&data, app_id);
 }
 
 void GameStreamClient::start(const std::string& address,
                              STREAM_CONFIGURATION config, int app_id,
-                             ServerCallback<STREAM_CONFIGURATION>& callback) {
-    if (m_server_data.count(address) == 0) {
+                             ServerCallback<STREAM_CONFIGURATION>& callback,
+                             const RequestToken* token) {
+    auto server = cached_server(address);
+    if (!server) {
         callback(GSResult<STREAM_CONFIGURATION>::failure(
             "Firstly call connect() & pair()..."));
         return;
     }
 
-    m_config = config;
-
-    brls::async([this, address, app_id, callback] {
-        int status = gs_start_app(&m_server_data[address], &m_config, app_id,
-                                  Settings::instance().sops(),
-                                  Settings::instance().play_audio(), 0x1);
-
-        brls::sync([this, callback, status] {
-            if (status == GS_OK) {
-                callback(GSResult<STREAM_CONFIGURATION>::success(m_config));
-            } else {
-                callback(GSResult<STREAM_CONFIGURATION>::failure(gs_error()));
-            }
-        });
-    });
+    RequestExecutor::instance().submit<STREAM_CONFIGURATION>(
+        REQUEST_PRIORITY_SESSION, address, token,
+        [this, address, server, config, app_id]() mutable {
+            SERVER_DATA data = *server;
+            if (gs_start_app(&data, &config, app_id,
+                             Settings::instance().sops(),
+                             Settings::instance().play_audio(),
+                             0x1) != GS_OK)
+                return GSResult<STREAM_CONFIGURATION>::failure(gs_error());
+
+            // Keeps the session URL of the launch for server_data()
+            store_server(address, data, false);
+            return GSResult<STREAM_CONFIGURATION>::success(config);
+        },
+        callback);
 }
 
 void GameStreamClient::quit(const std::string& address,
-                            ServerCallback<bool>& callback) {
-    if (m_server_data.count(address) == 0) {
+                            ServerCallback<bool>& callback,
+                            const RequestToken* token) {
+    auto server = cached_server(address);
+    if (!server) {
         callback(GSResult<bool>::failure("Firstly call connect() & pair()..."));
         return;
     }
 
-    auto server_data = m_server_data[address];
-
-    brls::async([server_data, callback] {
-        int status = gs_quit_app((PSERVER_DATA)&server_data);
-
-        brls::sync([callback, status] {
-            if (status == GS_OK) {
-                callback(GSResult<bool>::success(true));
-            } else {
-                callback(GSResult<bool>::failure(gs_error()));
-            }
-        });
-    });
+    RequestExecutor::instance().submit<bool>(
+        REQUEST_PRIORITY_SESSION, address, token,
+        [this, address, server] {
+            SERVER_DATA data = *server;
+            if (gs_quit_app(&data) != GS_OK)
+                return GSResult<bool>::failure(gs_error());
+
+            invalidate(address);
+            return GSResult<bool>::success(true);
+        },
+        callback);
 }
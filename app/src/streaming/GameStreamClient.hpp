@@ -3,8 +3,11 @@
 #include "Settings.hpp"
 #include "client.h"
 #include "errors.h"
+#include <cstdint>
 #include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -41,47 +44,83 @@ template <typename T> struct GSResult {
 template <class T>
 using ServerCallback = const std::function<void(GSResult<T>)>;
 
-//struct Host;
-
-struct AppInfo {
-    std::string name;
-    int app_id;
-};
+class RequestToken;
 
-using AppInfoList = std::vector<AppInfo>;
+//struct Host;
 
 class GameStreamClient : public Singleton<GameStreamClient> {
   public:
-    SERVER_DATA server_data(const std::string& address) {
-        return m_server_data[address];
-    }
+    // The last known data, empty if the host never got connected
+    SERVER_DATA server_data(const std::string& address);
 
     GameStreamClient();
 
     void start();
     void stop();
 
+    // Gets the client key pair ready in the background, connect() waits for
+    // it. The first launch has to generate one, which takes seconds.
+    static void prepare_keys();
+
     static std::vector<std::string> host_addresses_for_find();
 
+    // Identifies the local network, for anything cached per network
+    static std::string local_network();
+
     static bool can_find_host();
+
+    // Calls back with every host found so far, each time one more shows
+    // up, until stop_finding_hosts()
     static void find_hosts(ServerCallback<std::vector<Host>>& callback);
+    static void stop_finding_hosts();
 
     static bool can_wake_up_host(const Host& host);
     static void wake_up_host(const Host& host, ServerCallback<bool>& callback);
 
+    // Requests run on the RequestExecutor. Callbacks of a cancelled
+    // token don't get called.
+
+    // Answers from the cache while its data is younger than
+    // server_data_ttl_ms, unless cached is false. Connects to the same
+    // host at the same time share one fetch.
     void connect(const std::string& address,
-                 ServerCallback<SERVER_DATA>& callback);
+                 ServerCallback<SERVER_DATA>& callback, bool cached = true,
+                 const RequestToken* token = nullptr);
     void pair(const std::string& address, const std::string& pin,
-              ServerCallback<bool>& callback);
+              ServerCallback<bool>& callback,
+              const RequestToken* token = nullptr);
     void applist(const std::string& address,
-                 ServerCallback<AppInfoList>& callback);
-    void app_boxart(const std::string& address, int app_id,
-                    ServerCallback<Data>& callback);
+                 ServerCallback<AppInfoList>& callback,
+                 const RequestToken* token = nullptr);
+    // Empty until the host got connected, see BoxArtFetcher
+    std::string app_boxart_url(const std::string& address, int app_id);
     void start(const std::string& address, STREAM_CONFIGURATION config,
-               int app_id, ServerCallback<STREAM_CONFIGURATION>& callback);
-    void quit(const std::string& address, ServerCallback<bool>& callback);
+               int app_id, ServerCallback<STREAM_CONFIGURATION>& callback,
+               const RequestToken* token = nullptr);
+    void quit(const std::string& address, ServerCallback<bool>& callback,
+              const RequestToken* token = nullptr);
+
+    // The next connect() fetches the host again. Pairing, launching and
+    // quitting do this on their own.
+    void invalidate(const std::string& address);
 
   private:
-    std::map<std::string, SERVER_DATA> m_server_data;
-    STREAM_CONFIGURATION m_config;
+    struct CachedServer {
+        std::shared_ptr<const SERVER_DATA> data;
+        uint64_t fetched_at; // 0 once invalidated
+    };
+
+    std::shared_ptr<const SERVER_DATA> cached_server(const std::string& address);
+    void store_server(const std::string& address, const SERVER_DATA& data,
+                      bool fresh);
+
+    static constexpr uint64_t server_data_ttl_ms = 10000;
+
+    // Written from the workers, read from everywhere. Entries are
+    // snapshots that get replaced as a whole, so a reader keeps using its
+    // own without holding the lock.
+    std::mutex m_server_mutex;
+    std::map<std::string, CachedServer> m_server_data;
+    std::map<std::string, std::vector<std::function<void(GSResult<SERVER_DATA>)>>>
+        m_connecting;
 };
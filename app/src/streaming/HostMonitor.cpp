@@ -0,0 +1,158 @@
+#include "HostMonitor.hpp"
+#include <Limelight.h>
+#include <algorithm>
+
+HostStatusInfo HostMonitor::state(const std::string& address) {
+    auto it = m_entries.find(address);
+    if (it == m_entries.end()) {
+        HostStatusInfo state;
+        state.address = address;
+        return state;
+    }
+    return it->second.state;
+}
+
+void HostMonitor::start() {
+    if (m_running)
+        return;
+
+    brls::Logger::info("HostMonitor: Started");
+    m_running = true;
+    tick(++m_generation);
+}
+
+// Polls already running still finish and publish their result
+void HostMonitor::stop() {
+    if (!m_running)
+        return;
+
+    brls::Logger::info("HostMonitor: Stopped");
+    m_running = false;
+    m_generation++;
+}
+
+void HostMonitor::refresh(const std::string& address) {
+    auto& entry = m_entries[address];
+    entry.state.address = address;
+    entry.next_poll = 0;
+    entry.failures = 0;
+    entry.refresh = true;
+    poll_due_hosts();
+}
+
+// A stop() and start() in between leaves the old timer with a stale
+// generation, so only one of them keeps going
+void HostMonitor::tick(uint64_t generation) {
+    if (!m_running || generation != m_generation)
+        return;
+
+    poll_due_hosts();
+    brls::delay(tick_interval_ms, [this, generation] { tick(generation); });
+}
+
+void HostMonitor::poll_due_hosts() {
+    auto hosts = Settings::instance().hosts();
+
+    // Forget hosts that got removed, unless their poll is still running
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        bool saved = std::any_of(hosts.begin(), hosts.end(),
+                                 [&it](const Host& host) {
+                                     return host.address == it->first;
+                                 });
+        if (!saved && !it->second.polling && !it->second.refresh) {
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    uint64_t now = LiGetMillis();
+    for (auto& [address, entry] : m_entries) {
+        // Refreshed hosts also get polled while stopped
+        if (m_polls >= max_polls)
+            break;
+        if (entry.polling || entry.next_poll > now ||
+            (!m_running && !entry.refresh))
+            continue;
+
+        entry.polling = true;
+        m_polls++;
+
+        std::string poll_address = address;
+        GameStreamClient::instance().connect(
+            address, [this, poll_address](GSResult<SERVER_DATA> result) {
+                finish_poll(poll_address, result);
+            },
+            false);
+    }
+
+    if (!m_running)
+        return;
+
+    for (const Host& host : hosts) {
+        if (m_polls >= max_polls)
+            break;
+        if (m_entries.count(host.address))
+            continue;
+
+        auto& entry = m_entries[host.address];
+        entry.state.address = host.address;
+        entry.polling = true;
+        m_polls++;
+
+        std::string poll_address = host.address;
+        GameStreamClient::instance().connect(
+            host.address, [this, poll_address](GSResult<SERVER_DATA> result) {
+                finish_poll(poll_address, result);
+            },
+            false);
+    }
+}
+
+void HostMonitor::finish_poll(const std::string& address,
+                              const GSResult<SERVER_DATA>& result) {
+    m_polls--;
+
+    auto it = m_entries.find(address);
+    if (it == m_entries.end())
+        return;
+
+    auto& entry = it->second;
+    HostStatusInfo state = entry.state;
+    if (result.isSuccess()) {
+        state.status = HOST_STATUS_ONLINE;
+        state.paired = result.value().paired;
+        state.current_game = result.value().currentGame;
+        state.error.clear();
+
+        entry.failures = 0;
+        entry.next_poll = LiGetMillis() + online_interval_ms;
+    } else {
+        state.status = HOST_STATUS_OFFLINE;
+        state.error = result.error();
+
+        entry.failures++;
+        entry.next_poll =
+            LiGetMillis() + std::min(offline_interval_ms
+                                         << std::min(entry.failures - 1, 5),
+                                     max_offline_interval_ms);
+    }
+
+    bool changed = state.status != entry.state.status ||
+                   state.paired != entry.state.paired ||
+                   state.current_game != entry.state.current_game;
+    bool refresh = entry.refresh;
+
+    if (changed) {
+        brls::Logger::info("HostMonitor: {} is {}", address,
+                           state.status == HOST_STATUS_ONLINE ? "online"
+                                                              : "offline");
+    }
+
+    entry.state = state;
+    entry.polling = false;
+    entry.refresh = false;
+
+    if (changed || refresh)
+        m_status_event.fire(state);
+}
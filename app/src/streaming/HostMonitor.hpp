@@ -0,0 +1,69 @@
+#pragma once
+
+#include "GameStreamClient.hpp"
+#include "RequestExecutor.hpp"
+#include "Settings.hpp"
+#include "Singleton.hpp"
+#include <borealis.hpp>
+#include <cstdint>
+#include <map>
+#include <string>
+
+enum HostStatus { HOST_STATUS_UNKNOWN, HOST_STATUS_ONLINE, HOST_STATUS_OFFLINE };
+
+struct HostStatusInfo {
+    std::string address;
+    HostStatus status = HOST_STATUS_UNKNOWN;
+    bool paired = false;
+    int current_game = 0;
+    std::string error;
+};
+
+// Keeps the status of every saved host up to date, so the host tabs show
+// it right away instead of each connecting on its own. Polls go through
+// GameStreamClient::connect past its cache, a few hosts at a time, and
+// keep that cache warm for the app list and streaming. Online hosts get
+// polled every online_interval_ms, offline ones back off from
+// offline_interval_ms up to max_offline_interval_ms.
+// Lives on the UI thread, the status event fires there too.
+class HostMonitor : public Singleton<HostMonitor> {
+  public:
+    brls::Event<HostStatusInfo>* status_event() { return &m_status_event; }
+
+    // HOST_STATUS_UNKNOWN until the first poll of the host is done
+    HostStatusInfo state(const std::string& address);
+
+    void start();
+    void stop();
+
+    // Polls the host now, like after waking it up. The status event fires
+    // once it's done even if nothing changed.
+    void refresh(const std::string& address);
+
+  private:
+    struct Entry {
+        HostStatusInfo state;
+        uint64_t next_poll = 0;
+        int failures = 0;
+        bool polling = false;
+        bool refresh = false;
+    };
+
+    void tick(uint64_t generation);
+    void poll_due_hosts();
+    void finish_poll(const std::string& address,
+                     const GSResult<SERVER_DATA>& result);
+
+    static constexpr int tick_interval_ms = 500;
+    // Leaves a worker free for what the user asked for
+    static constexpr int max_polls = RequestExecutor::worker_count - 1;
+    static constexpr uint64_t online_interval_ms = 10'000;
+    static constexpr uint64_t offline_interval_ms = 2'000;
+    static constexpr uint64_t max_offline_interval_ms = 60'000;
+
+    brls::Event<HostStatusInfo> m_status_event;
+    std::map<std::string, Entry> m_entries;
+    bool m_running = false;
+    uint64_t m_generation = 0;
+    int m_polls = 0;
+};
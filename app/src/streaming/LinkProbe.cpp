@@ -0,0 +1,190 @@
+#include "LinkProbe.hpp"
+#include "Settings.hpp"
+#include <Limelight.h>
+#include <algorithm>
+#include <borealis.hpp>
+#include <ctime>
+#include <jansson.h>
+#include <vector>
+
+#define LINK_PROBE_FILE "/link_probe.json"
+
+// Part of the measured throughput a stream may use
+#define THROUGHPUT_HEADROOM 0.7
+#define HIGH_JITTER_MS 20
+
+std::string LinkProbe::cache_key(const std::string& address) {
+    return address + "@" + GameStreamClient::local_network();
+}
+
+bool LinkProbe::cached(const std::string& address, LinkProbeResult* result) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    load_cache();
+
+    auto entry = m_cache.find(cache_key(address));
+    if (entry == m_cache.end() ||
+        time(nullptr) - entry->second.time > cache_lifetime)
+        return false;
+
+    *result = entry->second;
+    return true;
+}
+
+LinkProbeResult LinkProbe::probe(const std::string& address,
+                                 SERVER_DATA server, int app_id) {
+    LinkProbeResult result = {};
+
+    std::vector<uint32_t> rtts;
+    for (int i = 0; i < ping_count; i++) {
+        uint64_t start = LiGetMillis();
+        if (gs_ping(&server) == GS_OK) {
+            rtts.push_back((uint32_t)(LiGetMillis() - start));
+        } else {
+            result.failures++;
+        }
+    }
+
+    if (!rtts.empty()) {
+        std::sort(rtts.begin(), rtts.end());
+        result.rtt = rtts[rtts.size() / 2];
+
+        uint32_t deviation = 0;
+        for (uint32_t rtt : rtts)
+            deviation += rtt > result.rtt ? rtt - result.rtt : result.rtt - rtt;
+        result.jitter = deviation / (uint32_t)rtts.size();
+    }
+
+    // Boxart is the largest thing a host serves, fetch it until there is
+    // enough data for a throughput estimate
+    size_t bytes = 0;
+    uint64_t elapsed = 0;
+    for (int i = 0; i < max_transfers && bytes < transfer_size; i++) {
+        Data data;
+        uint64_t start = LiGetMillis();
+        if (gs_app_boxart(&server, app_id, &data) != GS_OK || data.is_empty()) {
+            result.failures++;
+            break;
+        }
+
+        // Leave out the request round trip, only the transfer counts
+        uint64_t duration = LiGetMillis() - start;
+        elapsed += duration > result.rtt ? duration - result.rtt : 1;
+        bytes += data.size();
+    }
+
+    if (bytes >= min_transfer_size && elapsed > 0)
+        result.throughput = (uint32_t)(bytes * 8 / elapsed);
+
+    result.time = time(nullptr);
+
+    brls::Logger::info(
+        "LinkProbe: {} RTT {} ms, jitter {} ms, throughput {} kbps "
+        "({} bytes), {} failed requests",
+        address, result.rtt, result.jitter, result.throughput, bytes,
+        result.failures);
+
+    // A host that didn't answer at all tells nothing about the network
+    if (rtts.empty())
+        return result;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    load_cache();
+    m_cache[cache_key(address)] = result;
+    save_cache();
+    return result;
+}
+
+LinkSuggestion LinkProbe::suggest(const LinkProbeResult& result,
+                                  const QualityTier& requested,
+                                  VideoCodec codec, int server_codecs) {
+    LinkSuggestion suggestion = {requested, codec};
+    if (result.time == 0)
+        return suggestion;
+
+    double budget = result.throughput > 0
+                        ? result.throughput * THROUGHPUT_HEADROOM
+                        : requested.bitrate;
+
+    // A jittery or lossy link won't sustain what a short transfer shows
+    if (result.jitter > HIGH_JITTER_MS)
+        budget *= 0.7;
+    if (result.failures > 0)
+        budget *= 0.5;
+
+    if (budget >= requested.bitrate)
+        return suggestion;
+
+    auto tiers = QualityController::ladder(requested);
+    suggestion.tier = tiers.back();
+    for (auto& tier : tiers) {
+        if (tier.bitrate <= budget) {
+            suggestion.tier = tier;
+            break;
+        }
+    }
+
+    // HEVC gets the same picture out of fewer bits
+    if (codec == H264 && (server_codecs & SCM_HEVC))
+        suggestion.codec = H265;
+
+    return suggestion;
+}
+
+void LinkProbe::load_cache() {
+    if (m_loaded)
+        return;
+    m_loaded = true;
+
+    std::string path = Settings::instance().working_dir() + LINK_PROBE_FILE;
+    json_t* root = json_load_file(path.c_str(), 0, nullptr);
+    if (!root)
+        return;
+
+    if (json_typeof(root) == JSON_OBJECT) {
+        const char* key;
+        json_t* value;
+        json_object_foreach(root, key, value) {
+            if (json_typeof(value) != JSON_OBJECT)
+                continue;
+
+            LinkProbeResult result = {};
+            if (json_t* rtt = json_object_get(value, "rtt"))
+                result.rtt = (uint32_t)json_integer_value(rtt);
+            if (json_t* jitter = json_object_get(value, "jitter"))
+                result.jitter = (uint32_t)json_integer_value(jitter);
+            if (json_t* throughput = json_object_get(value, "throughput"))
+                result.throughput = (uint32_t)json_integer_value(throughput);
+            if (json_t* failures = json_object_get(value, "failures"))
+                result.failures = (uint32_t)json_integer_value(failures);
+            if (json_t* time = json_object_get(value, "time"))
+                result.time = (int64_t)json_integer_value(time);
+
+            if (result.time != 0)
+                m_cache[key] = result;
+        }
+    }
+
+    json_decref(root);
+}
+
+void LinkProbe::save_cache() {
+    json_t* root = json_object();
+    int64_t now = time(nullptr);
+
+    for (auto& [key, result] : m_cache) {
+        if (now - result.time > cache_lifetime)
+            continue;
+
+        json_t* value = json_object();
+        json_object_set_new(value, "rtt", json_integer(result.rtt));
+        json_object_set_new(value, "jitter", json_integer(result.jitter));
+        json_object_set_new(value, "throughput", json_integer(result.throughput));
+        json_object_set_new(value, "failures", json_integer(result.failures));
+        json_object_set_new(value, "time", json_integer(result.time));
+        json_object_set_new(root, key.c_str(), value);
+    }
+
+    std::string path = Settings::instance().working_dir() + LINK_PROBE_FILE;
+    json_dump_file(root, path.c_str(), JSON_INDENT(4));
+    json_decref(root);
+}
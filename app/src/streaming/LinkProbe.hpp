@@ -0,0 +1,57 @@
+#pragma once
+
+#include "GameStreamClient.hpp"
+#include "QualityController.hpp"
+#include "Singleton.hpp"
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+struct LinkProbeResult {
+    uint32_t rtt;        // Median of the serverinfo requests, ms
+    uint32_t jitter;     // Mean deviation from the median, ms
+    uint32_t throughput; // kbps, 0 if there was nothing to measure
+    uint32_t failures;   // Requests that got no answer
+    int64_t time;        // Unix time of the measurement, 0 if none
+};
+
+struct LinkSuggestion {
+    QualityTier tier;
+    VideoCodec codec;
+};
+
+// Measures the link to a host before a stream gets launched: a burst of
+// serverinfo requests for RTT and jitter, then a few boxart downloads over
+// HTTPS for throughput. Results are cached per host and local network in
+// link_probe.json, so only the first launch on a network waits for it.
+class LinkProbe : public Singleton<LinkProbe> {
+  public:
+    // Result from an earlier probe of the host on the current network
+    bool cached(const std::string& address, LinkProbeResult* result);
+
+    // Takes a few seconds at most, call it off the UI thread
+    LinkProbeResult probe(const std::string& address, SERVER_DATA server,
+                          int app_id);
+
+    // The highest quality tier that fits the measured link, and
+    // HEVC instead of H.264 when the link is tight and the host has it
+    static LinkSuggestion suggest(const LinkProbeResult& result,
+                                  const QualityTier& requested,
+                                  VideoCodec codec, int server_codecs);
+
+  private:
+    std::string cache_key(const std::string& address);
+    void load_cache();
+    void save_cache();
+
+    static constexpr int ping_count = 8;
+    static constexpr size_t transfer_size = 512 * 1024;
+    static constexpr size_t min_transfer_size = 32 * 1024;
+    static constexpr int max_transfers = 4;
+    static constexpr int64_t cache_lifetime = 7 * 24 * 60 * 60;
+
+    std::mutex m_mutex;
+    bool m_loaded = false;
+    std::map<std::string, LinkProbeResult> m_cache;
+};
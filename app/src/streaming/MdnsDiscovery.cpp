@@ -0,0 +1,382 @@
+#ifndef MULTICAST_DISABLED
+
+#include "MdnsDiscovery.hpp"
+#include "NetworkInterfaces.hpp"
+#include "http.h"
+#include <Limelight.h>
+#include <algorithm>
+#include <arpa/inet.h>
+#include <borealis.hpp>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+#if defined(PLATFORM_SWITCH)
+#include <switch.h>
+
+// TODO: Remove when presented in LibNX
+struct ipv6_mreq {
+	struct in6_addr ipv6mr_multiaddr;
+	unsigned int    ipv6mr_interface;
+};
+#endif
+
+extern "C" {
+#include <mdns.h>
+}
+
+using namespace brls::literals;
+
+#define NVSTREAM_SERVICE "_nvstream._tcp.local."
+#define MDNS_BUFFER_SIZE 2048
+
+static bool ends_with(const std::string& string, const std::string& suffix) {
+    return string.size() >= suffix.size() &&
+           string.compare(string.size() - suffix.size(), suffix.size(),
+                          suffix) == 0;
+}
+
+// Link local IPv6 addresses come with the index of their interface
+static std::string ip_string(const struct sockaddr* address) {
+    char buffer[INET6_ADDRSTRLEN] = {};
+    if (address->sa_family == AF_INET) {
+        inet_ntop(AF_INET, &((struct sockaddr_in*)address)->sin_addr, buffer,
+                  sizeof(buffer));
+    } else if (address->sa_family == AF_INET6) {
+        auto ipv6 = (struct sockaddr_in6*)address;
+        inet_ntop(AF_INET6, &ipv6->sin6_addr, buffer, sizeof(buffer));
+        if (IN6_IS_ADDR_LINKLOCAL(&ipv6->sin6_addr) && ipv6->sin6_scope_id)
+            return std::string(buffer) + "%" +
+                   std::to_string(ipv6->sin6_scope_id);
+    }
+    return buffer;
+}
+
+static int mdns_record_callback(int sock, const struct sockaddr* from,
+                                size_t addrlen, mdns_entry_type_t entry,
+                                uint16_t query_id, uint16_t type,
+                                uint16_t rclass, uint32_t ttl,
+                                const void* data, size_t size,
+                                size_t name_offset, size_t name_length,
+                                size_t record_offset, size_t record_length,
+                                void* user_data) {
+    if (entry == MDNS_ENTRYTYPE_QUESTION)
+        return 0;
+
+    ((MdnsDiscovery*)user_data)
+        ->on_record(from, type, ttl, data, size, name_offset, record_offset,
+                    record_length);
+    return 0;
+}
+
+static std::vector<int> open_sockets() {
+    std::vector<int> sockets;
+
+    for (const auto& interface : network_interfaces()) {
+        if (interface.address != 0) {
+            struct sockaddr_in address = {};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = interface.address;
+
+            int sock = mdns_socket_open_ipv4(&address);
+            if (sock >= 0)
+                sockets.push_back(sock);
+        }
+
+        if (!interface.link_local.empty()) {
+            struct sockaddr_in6 address = {};
+            address.sin6_family = AF_INET6;
+            address.sin6_scope_id = interface.index;
+            if (inet_pton(AF_INET6, interface.link_local.c_str(),
+                          &address.sin6_addr) != 1)
+                continue;
+
+            int sock = mdns_socket_open_ipv6(&address);
+            if (sock < 0)
+                continue;
+
+            // Link-local multicast needs to know which link
+            unsigned int index = interface.index;
+            setsockopt(sock, IPPROTO_IPV6, IPV6_MULTICAST_IF, &index,
+                       sizeof(index));
+            sockets.push_back(sock);
+        }
+    }
+
+    // Let the system pick when the interfaces can't be listed
+    if (sockets.empty()) {
+        int sock = mdns_socket_open_ipv4(nullptr);
+        if (sock >= 0)
+            sockets.push_back(sock);
+    }
+    return sockets;
+}
+
+MdnsDiscovery::~MdnsDiscovery() { stop(); }
+
+void MdnsDiscovery::start(ServerCallback<std::vector<Host>>& callback) {
+    m_callback = callback;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        expire();
+    }
+    announce();
+
+    if (m_running)
+        return;
+
+    // A worker that gave up on its own is still to be joined
+    if (m_worker.joinable())
+        m_worker.join();
+
+    brls::Logger::info("MdnsDiscovery: Started");
+    m_running = true;
+    m_worker = std::thread([this] { run(); });
+}
+
+// The worker notices within poll_interval_ms. Verifications still running
+// finish into the cache.
+void MdnsDiscovery::stop() {
+    m_callback = nullptr;
+    m_running = false;
+    if (m_worker.joinable()) {
+        m_worker.join();
+        brls::Logger::info("MdnsDiscovery: Stopped");
+    }
+}
+
+void MdnsDiscovery::run() {
+    auto sockets = open_sockets();
+    if (sockets.empty()) {
+        brls::Logger::error("MdnsDiscovery: Failed to open a socket");
+        m_running = false;
+        brls::sync([this] {
+            if (m_callback)
+                m_callback(GSResult<std::vector<Host>>::failure(
+                    "error/unknown_error"_i18n));
+        });
+        return;
+    }
+
+    std::vector<struct pollfd> fds;
+    for (int sock : sockets)
+        fds.push_back({sock, POLLIN, 0});
+
+    std::vector<char> buffer(MDNS_BUFFER_SIZE);
+    uint64_t interval = first_query_interval_ms;
+    uint64_t next_query = 0;
+
+    while (m_running) {
+        uint64_t now = LiGetMillis();
+        if (now >= next_query) {
+            send_queries(sockets);
+            next_query = now + interval;
+            interval = std::min(interval * 2, max_query_interval_ms);
+        }
+
+        int timeout = (int)std::min<uint64_t>(next_query - now,
+                                              poll_interval_ms);
+        if (poll(fds.data(), fds.size(), timeout) > 0) {
+            for (auto& fd : fds) {
+                if (fd.revents & POLLIN)
+                    mdns_query_recv(fd.fd, buffer.data(), buffer.size(),
+                                    mdns_record_callback, this, 0);
+            }
+        }
+
+        bool removed;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            removed = expire();
+            verify_resolved();
+        }
+
+        if (removed)
+            brls::sync([this] { announce(); });
+    }
+
+    for (int sock : sockets)
+        mdns_socket_close(sock);
+}
+
+void MdnsDiscovery::send_queries(const std::vector<int>& sockets) {
+    char buffer[MDNS_BUFFER_SIZE];
+    for (int sock : sockets) {
+        if (mdns_query_send(sock, MDNS_RECORDTYPE_PTR,
+                            MDNS_STRING_CONST(NVSTREAM_SERVICE), buffer,
+                            sizeof(buffer), 0) < 0) {
+            brls::Logger::error("MdnsDiscovery: Failed to send a query");
+        }
+    }
+}
+
+void MdnsDiscovery::on_record(const struct sockaddr* from, uint16_t type,
+                              uint32_t ttl, const void* data, size_t size,
+                              size_t name_offset, size_t record_offset,
+                              size_t record_length) {
+    char name_buffer[256];
+    size_t offset = name_offset;
+    mdns_string_t name_string = mdns_string_extract(
+        data, size, &offset, name_buffer, sizeof(name_buffer));
+    std::string name(name_string.str, name_string.length);
+
+    // A TTL of 0 says goodbye
+    uint64_t expires_at = LiGetMillis() + (uint64_t)ttl * 1000;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (type == MDNS_RECORDTYPE_PTR && name == NVSTREAM_SERVICE) {
+        char buffer[256];
+        mdns_string_t ptr = mdns_record_parse_ptr(
+            data, size, record_offset, record_length, buffer, sizeof(buffer));
+        auto& instance = m_instances[std::string(ptr.str, ptr.length)];
+        instance.from = ip_string(from);
+        instance.expires_at = expires_at;
+    } else if (type == MDNS_RECORDTYPE_SRV &&
+               ends_with(name, "." NVSTREAM_SERVICE)) {
+        char buffer[256];
+        mdns_record_srv_t srv = mdns_record_parse_srv(
+            data, size, record_offset, record_length, buffer, sizeof(buffer));
+        auto& instance = m_instances[name];
+        instance.target = std::string(srv.name.str, srv.name.length);
+        instance.port = srv.port;
+        if (instance.from.empty())
+            instance.from = ip_string(from);
+        instance.expires_at = std::max(instance.expires_at, expires_at);
+    } else if (type == MDNS_RECORDTYPE_A) {
+        struct sockaddr_in address = {};
+        if (!mdns_record_parse_a(data, size, record_offset, record_length,
+                                 &address))
+            return;
+        auto& entry = m_addresses[name];
+        entry.ipv4 = ip_string((struct sockaddr*)&address);
+        entry.expires_at = expires_at;
+    } else if (type == MDNS_RECORDTYPE_AAAA) {
+        struct sockaddr_in6 address = {};
+        if (!mdns_record_parse_aaaa(data, size, record_offset, record_length,
+                                    &address))
+            return;
+        // Has no interface to go with it, the address it came from has
+        if (IN6_IS_ADDR_LINKLOCAL(&address.sin6_addr))
+            return;
+        auto& entry = m_addresses[name];
+        entry.ipv6 = ip_string((struct sockaddr*)&address);
+        entry.expires_at = std::max(entry.expires_at, expires_at);
+    }
+}
+
+// Callers hold m_mutex. True if a verified host went away.
+bool MdnsDiscovery::expire() {
+    uint64_t now = LiGetMillis();
+    bool removed = false;
+
+    for (auto it = m_instances.begin(); it != m_instances.end();) {
+        if (it->second.expires_at > now) {
+            ++it;
+            continue;
+        }
+
+        if (!it->second.host.address.empty()) {
+            brls::Logger::info("MdnsDiscovery: {} is gone", it->first);
+            removed = true;
+        }
+        it = m_instances.erase(it);
+    }
+
+    for (auto it = m_addresses.begin(); it != m_addresses.end();) {
+        if (it->second.expires_at <= now) {
+            it = m_addresses.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return removed;
+}
+
+// Callers hold m_mutex
+void MdnsDiscovery::verify_resolved() {
+    uint64_t now = LiGetMillis();
+    for (auto& [name, instance] : m_instances) {
+        if (instance.verifying || !instance.host.address.empty() ||
+            instance.next_verify > now)
+            continue;
+
+        // The SRV target's A record before its AAAA one, or whoever
+        // answered the query
+        std::string ip;
+        auto address = m_addresses.find(instance.target);
+        if (address != m_addresses.end()) {
+            ip = !address->second.ipv4.empty() ? address->second.ipv4
+                                               : address->second.ipv6;
+        }
+        if (ip.empty())
+            ip = instance.from;
+        if (ip.empty())
+            continue;
+
+        std::string host_address =
+            http_format_address(ip, instance.port, 47989);
+
+        brls::Logger::info("MdnsDiscovery: Verifying {} at {}", name,
+                           host_address);
+        instance.verifying = true;
+
+        std::string instance_name = name;
+        GameStreamClient::instance().connect(
+            host_address,
+            [this, instance_name, host_address](GSResult<SERVER_DATA> result) {
+                finish_verify(instance_name, host_address, result);
+            },
+            false);
+    }
+}
+
+// Runs on the UI thread
+void MdnsDiscovery::finish_verify(const std::string& instance,
+                                  const std::string& address,
+                                  const GSResult<SERVER_DATA>& result) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_instances.find(instance);
+        if (it == m_instances.end())
+            return;
+
+        it->second.verifying = false;
+        if (!result.isSuccess()) {
+            it->second.next_verify = LiGetMillis() + verify_retry_ms;
+            brls::Logger::error("MdnsDiscovery: {} at {}: {}", instance,
+                                address, result.error());
+            return;
+        }
+
+        it->second.host.address = address;
+        it->second.host.hostname = result.value().hostname;
+        it->second.host.mac = result.value().mac;
+    }
+
+    announce();
+}
+
+// Runs on the UI thread
+void MdnsDiscovery::announce() {
+    if (!m_callback)
+        return;
+
+    std::vector<Host> hosts;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& [name, instance] : m_instances) {
+            const Host& host = instance.host;
+            bool listed = std::any_of(hosts.begin(), hosts.end(),
+                                      [&host](const Host& other) {
+                                          return other.address == host.address;
+                                      });
+            if (!host.address.empty() && !listed)
+                hosts.push_back(host);
+        }
+    }
+
+    m_callback(GSResult<std::vector<Host>>::success(hosts));
+}
+
+#endif
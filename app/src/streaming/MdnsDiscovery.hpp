@@ -0,0 +1,73 @@
+#pragma once
+
+#include "GameStreamClient.hpp"
+#include "Settings.hpp"
+#include "Singleton.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Finds GameStream hosts with mDNS. A worker queries _nvstream._tcp on
+// every interface, IPv4 and IPv6 link-local, each time waiting longer up
+// to max_query_interval_ms. It waits for answers with poll() in between.
+// PTR answers give the service instances, SRV gives their port, and A or
+// AAAA their address. Instances live as long as their record TTL says.
+// Each one gets verified with a serverinfo request once and is announced
+// once. The callback gets every verified host, on the UI thread.
+class MdnsDiscovery : public Singleton<MdnsDiscovery> {
+  public:
+    ~MdnsDiscovery();
+
+    // Hosts still in the cache from an earlier search come right away
+    void start(ServerCallback<std::vector<Host>>& callback);
+    void stop();
+
+    // Called by the mDNS parser on the worker
+    void on_record(const struct sockaddr* from, uint16_t type, uint32_t ttl,
+                   const void* data, size_t size, size_t name_offset,
+                   size_t record_offset, size_t record_length);
+
+  private:
+    struct Instance {
+        std::string target;  // SRV target host name
+        uint16_t port = 47989;
+        std::string from;    // Responder, for answers without an A record
+        uint64_t expires_at = 0;
+        uint64_t next_verify = 0;
+        bool verifying = false;
+        Host host;           // Filled in once verified
+    };
+
+    struct Address {
+        std::string ipv4;
+        std::string ipv6;
+        uint64_t expires_at = 0;
+    };
+
+    void run();
+    void send_queries(const std::vector<int>& sockets);
+    bool expire();
+    void verify_resolved();
+    void finish_verify(const std::string& instance,
+                       const std::string& address,
+                       const GSResult<SERVER_DATA>& result);
+    void announce();
+
+    static constexpr uint64_t first_query_interval_ms = 1000;
+    static constexpr uint64_t max_query_interval_ms = 20'000;
+    static constexpr uint64_t verify_retry_ms = 5000;
+    static constexpr int poll_interval_ms = 100;
+
+    std::thread m_worker;
+    std::atomic<bool> m_running = false;
+    std::function<void(GSResult<std::vector<Host>>)> m_callback;
+
+    std::mutex m_mutex;
+    std::map<std::string, Instance> m_instances;
+    std::map<std::string, Address> m_addresses;
+};
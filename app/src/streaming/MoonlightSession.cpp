@@ -1,9 +1,12 @@
 #include "MoonlightSession.hpp"
 #include "AVFrameHolder.hpp"
+#include "AVSyncMonitor.hpp"
 #include "GameStreamClient.hpp"
 #include "InputManager.hpp"
+#include "RequestExecutor.hpp"
 #include "Settings.hpp"
 #include "borealis.hpp"
+#include "http.h"
 #include <string.h>
 #include <SDL.h>
 
@@ -33,6 +36,14 @@ MoonlightSession::MoonlightSession(const std::string& address, int app_id) {
 }
 
 MoonlightSession::~MoonlightSession() {
+    wait_for_prewarm();
+    wait_for_reconnect_stop();
+
+    if (m_replayer) {
+        delete m_replayer;
+    }
+    release_video_decoder();
+
     if (m_video_decoder) {
         delete m_video_decoder;
     }
@@ -69,15 +80,94 @@ void MoonlightSession::connection_stage_starting(int stage) {
 
 void MoonlightSession::connection_stage_complete(int stage) {
     brls::Logger::info("MoonlightSession: Complete: {}", stages[stage]);
+
+    if (m_active_session)
+        m_active_session->m_startup_timeline.mark(stages[stage]);
 }
 
 void MoonlightSession::connection_stage_failed(int stage, int error_code) {
     brls::Logger::error("MoonlightSession: Failed: {} with error code: {}", stages[stage], error_code);
 }
 
+static std::string video_format_name(int video_format) {
+    std::string name;
+    if (video_format & VIDEO_FORMAT_MASK_H264)
+        name = "H264";
+    else if (video_format & VIDEO_FORMAT_MASK_H265)
+        name = "HEVC";
+    else if (video_format & VIDEO_FORMAT_MASK_AV1)
+        name = "AV1";
+    else
+        name = fmt::format("0x{:x}", video_format);
+
+    if (video_format & VIDEO_FORMAT_MASK_10BIT)
+        name += " 10-bit";
+    return name;
+}
+
+static const char* video_codec_name(VideoCodec codec) {
+    switch (codec) {
+    case H265:
+        return "HEVC";
+    case AV1:
+        return "AV1";
+    default:
+        return "H264";
+    }
+}
+
 void MoonlightSession::connection_started() {
     brls::Logger::info("MoonlightSession: Connection started");
         m_active_session->m_is_active = true;
+        m_active_session->m_startup_timeline.mark("Connection started");
+
+    auto session = m_active_session;
+    if (session->m_telemetry.is_active()) {
+        session->m_telemetry.event("connection_started");
+    } else if (!session->m_is_reconnecting) {
+        session->m_telemetry.begin(
+            Settings::instance().log_dir(), Settings::instance().telemetry(),
+            {session->m_address, session->m_app_id,
+             video_format_name(m_video_format), session->m_config.width,
+             session->m_config.height, session->m_config.fps,
+             session->m_config.bitrate});
+
+        if (session->m_has_link_probe) {
+            const auto& probe = session->m_session_stats.link_probe;
+            const auto& suggestion = session->m_session_stats.link_suggestion;
+            auto details = fmt::format(
+                "rtt_ms={} jitter_ms={} throughput_kbps={} failures={} "
+                "width={} height={} fps={} bitrate={} codec={} applied={}",
+                probe.rtt, probe.jitter, probe.throughput, probe.failures,
+                suggestion.tier.width, suggestion.tier.height,
+                suggestion.tier.fps, suggestion.tier.bitrate,
+                video_codec_name(suggestion.codec),
+                Settings::instance().link_probe() == LINK_PROBE_APPLY);
+
+            brls::Logger::info("MoonlightSession: Link probe: {}", details);
+            session->m_telemetry.event("link_probe", details);
+        }
+
+        // How the requests leading up to the stream went
+        HTTPHostStats http;
+        if (http_host_stats(session->m_address, &http)) {
+            session->m_telemetry.event(
+                "http", fmt::format("rtt_ms={} rtt_variance_ms={} requests={} "
+                                    "timeouts={} retries={}",
+                                    http.rtt, http.rtt_variance, http.requests,
+                                    http.timeouts, http.retries));
+        }
+
+        auto requests = RequestExecutor::instance().stats(REQUEST_PRIORITY_SESSION);
+        session->m_telemetry.event(
+            "requests", fmt::format("session={} cancelled={} avg_wait_ms={} "
+                                    "max_wait_ms={}",
+                                    requests.requests, requests.cancelled,
+                                    requests.requests
+                                        ? requests.total_wait_ms / requests.requests
+                                        : 0,
+                                    requests.max_wait_ms));
+    }
 }
 
 void MoonlightSession::connection_terminated(int error_code) {
@@ -85,21 +175,12 @@ void MoonlightSession::connection_terminated(int error_code) {
 
     if (error_code != 0) {
         if (!m_active_session) return;
-        brls::Logger::info("MoonlightSession: Reconnection attempt");
 
-        m_active_session->stop(false);
-
-        m_active_session->start([](const GSResult<bool>& result) {
-            if (result.isSuccess()) {
-                brls::Logger::info("MoonlightSession: Reconnected");
-            } else {
-                brls::Logger::info("MoonlightSession: Reconnection failed");
-                if (m_active_session) {
-                    m_active_session->m_is_active = false;
-                    m_active_session->m_is_terminated = true;
-                }
-            }
-        }, m_active_session->m_is_sunshine);
+        auto session = m_active_session;
+        brls::sync([session] {
+            if (m_active_session == session)
+                session->begin_reconnect();
+        });
         return;
     }
 
@@ -139,6 +220,9 @@ void MoonlightSession::connection_status_update(int connection_status) {
     if (m_active_session) {
         m_active_session->m_connection_status_is_poor =
             connection_status == CONN_STATUS_POOR;
+        m_active_session->m_telemetry.event(
+            "connection_status",
+            connection_status == CONN_STATUS_POOR ? "poor" : "okay");
     }
 }
 
@@ -155,8 +239,26 @@ int MoonlightSession::video_decoder_setup(int video_format, int width,
                                           void* context, int dr_flags) {
     m_video_format = video_format;
     if (m_active_session && m_active_session->m_video_decoder) {
-        return m_active_session->m_video_decoder->setup(
+        auto session = m_active_session;
+        session->m_recorder.video_setup(video_format, width, height,
+                                        redraw_rate);
+
+        VideoSetup setup = {video_format, width, height, redraw_rate};
+
+        // Reconnecting with the same stream, skip codec and frame pool setup
+        if (session->m_video_decoder_ready && session->m_video_setup == setup &&
+            session->m_video_decoder->reset()) {
+            return DR_OK;
+        }
+
+        session->release_video_decoder();
+
+        int result = session->m_video_decoder->setup(
             video_format, width, height, redraw_rate, context, dr_flags);
+        // A failed setup still has to be cleaned up, but never reused
+        session->m_video_decoder_ready = true;
+        session->m_video_setup = result == DR_OK ? setup : VideoSetup{};
+        return result;
     }
     return DR_OK;
 }
@@ -174,16 +276,26 @@ void MoonlightSession::video_decoder_stop() {
 }
 
 void MoonlightSession::video_decoder_cleanup() {
-    if (m_active_session && m_active_session->m_video_decoder) {
-        m_active_session->m_video_decoder->cleanup();
+    if (m_active_session && !m_active_session->m_is_reconnecting) {
+        m_active_session->release_video_decoder();
     }
 }
 
 int MoonlightSession::video_decoder_submit_decode_unit(
     PDECODE_UNIT decode_unit) {
     if (m_active_session && m_active_session->m_video_decoder) {
-        return m_active_session->m_video_decoder->submit_decode_unit(
+        m_active_session->m_recorder.video_unit(decode_unit);
+
+        int result = m_active_session->m_video_decoder->submit_decode_unit(
             decode_unit);
+
+        auto& timeline = m_active_session->m_startup_timeline;
+        if (!timeline.is_complete() && !m_active_session->m_first_frame_decoded &&
+            AVFrameHolder::instance().getFrameQueueSize() > 0) {
+            m_active_session->m_first_frame_decoded = true;
+            timeline.mark("First frame decoded");
+        }
+        return result;
     }
     return DR_OK;
 }
@@ -193,7 +305,12 @@ int MoonlightSession::video_decoder_submit_decode_unit(
 int MoonlightSession::audio_renderer_init(
     int audio_configuration, const POPUS_MULTISTREAM_CONFIGURATION opus_config,
     void* context, int ar_flags) {
+    AVSyncMonitor::instance().set_audio_format(opus_config->samplesPerFrame,
+                                               opus_config->sampleRate);
+
     if (m_active_session && m_active_session->m_audio_renderer) {
+        m_active_session->m_recorder.audio_setup(audio_configuration,
+                                                 opus_config);
         return m_active_session->m_audio_renderer->init(
             audio_configuration, opus_config, context, ar_flags);
     }
@@ -221,16 +338,24 @@ void MoonlightSession::audio_renderer_cleanup() {
 void MoonlightSession::audio_renderer_decode_and_play_sample(
     char* sample_data, int sample_length) {
     if (m_active_session && m_active_session->m_audio_renderer) {
+        // Recorded as received, before any A/V sync correction
+        m_active_session->m_recorder.audio_packet(sample_data, sample_length);
+
+        if (!AVSyncMonitor::instance().audio_received())
+            return;
+
         m_active_session->m_audio_renderer->decode_and_play_sample(
             sample_data, sample_length);
+
+        AVSyncMonitor::instance().audio_queued(
+            LiGetPendingAudioDuration() +
+            m_active_session->m_audio_renderer->queued_duration());
     }
 }
 
 // MARK: MoonlightSession
 
-void MoonlightSession::start(ServerCallback<bool> callback, bool is_sunshine) {
-    m_is_sunshine = is_sunshine;
-
+void MoonlightSession::configure_stream() {
     LiInitializeStreamConfiguration(&m_config);
 
     int h = Settings::instance().resolution();
@@ -258,7 +383,34 @@ void MoonlightSession::start(ServerCallback<bool> callback, bool is_sunshine) {
     m_config.bitrate = Settings::instance().bitrate();
     m_config.encryptionFlags = m_is_sunshine ? ENCFLG_ALL : ENCFLG_VIDEO;
 
-    switch (Settings::instance().video_codec()) {
+    VideoCodec codec = Settings::instance().video_codec();
+
+    if (m_has_link_probe) {
+        auto server = GameStreamClient::instance().server_data(m_address);
+        auto& suggestion = m_session_stats.link_suggestion;
+        suggestion = LinkProbe::suggest(
+            m_session_stats.link_probe,
+            {m_config.width, m_config.height, m_config.fps, m_config.bitrate},
+            codec, server.serverInfo.serverCodecModeSupport);
+
+        if (Settings::instance().link_probe() == LINK_PROBE_APPLY) {
+            m_config.width = suggestion.tier.width;
+            m_config.height = suggestion.tier.height;
+            m_config.fps = suggestion.tier.fps;
+            m_config.bitrate = suggestion.tier.bitrate;
+            codec = suggestion.codec;
+        }
+    }
+
+    if (m_quality.is_active()) {
+        const auto& tier = m_quality.tier();
+        m_config.width = tier.width;
+        m_config.height = tier.height;
+        m_config.fps = tier.fps;
+        m_config.bitrate = tier.bitrate;
+    }
+
+    switch (codec) {
     case H264:
         m_config.supportedVideoFormats = VIDEO_FORMAT_H264;
         break;
@@ -275,7 +427,59 @@ void MoonlightSession::start(ServerCallback<bool> callback, bool is_sunshine) {
     default:
         break;
     }
+}
+
+void MoonlightSession::prewarm() {
+    if (m_startup_timeline.is_started())
+        return;
+
+    m_startup_timeline.begin();
+
+    // A cached probe already decides what the decoder gets set up for
+    if (Settings::instance().link_probe() != LINK_PROBE_OFF)
+        load_link_probe();
+
+    configure_stream();
+
+    // Guess an 8-bit stream of the requested codec, if the host picks
+    // something else both get set up again once the stream starts
+
+    // Shaders have to be built on the render thread, which is this one
+    if (m_video_renderer) {
+        m_video_renderer->prepare(AV_PIX_FMT_NV12);
+        m_startup_timeline.mark("Renderer prepared");
+    }
+
+    if (!m_video_decoder)
+        return;
+
+    VideoSetup setup = {
+        m_config.supportedVideoFormats &
+            ~(VIDEO_FORMAT_H265_MAIN10 | VIDEO_FORMAT_AV1_MAIN10),
+        m_config.width, m_config.height, m_config.fps};
+
+    m_prewarm = std::async(std::launch::async, [this, setup] {
+        int result = m_video_decoder->setup(setup.video_format, setup.width,
+                                            setup.height, setup.redraw_rate,
+                                            nullptr, 0);
+        m_video_decoder_ready = true;
+        m_video_setup = result == DR_OK ? setup : VideoSetup{};
+        m_startup_timeline.mark(result == DR_OK ? "Decoder prepared"
+                                                : "Decoder prepare failed");
+    });
+}
+
+void MoonlightSession::wait_for_prewarm() {
+    if (m_prewarm.valid())
+        m_prewarm.wait();
+}
 
+void MoonlightSession::wait_for_reconnect_stop() {
+    if (m_reconnect_stop.valid())
+        m_reconnect_stop.wait();
+}
+
+void MoonlightSession::configure_callbacks() {
     LiInitializeConnectionCallbacks(&m_connection_callbacks);
     m_connection_callbacks.stageStarting = connection_stage_starting;
     m_connection_callbacks.stageComplete = connection_stage_complete;
@@ -310,20 +514,96 @@ void MoonlightSession::start(ServerCallback<bool> callback, bool is_sunshine) {
     if (m_audio_renderer) {
         m_audio_callbacks.capabilities = m_audio_renderer->capabilities();
     }
+}
+
+bool MoonlightSession::load_link_probe() {
+    m_link_probed = true;
+    m_has_link_probe =
+        LinkProbe::instance().cached(m_address, &m_session_stats.link_probe);
+    if (m_has_link_probe)
+        m_startup_timeline.mark("Link probe cached");
+    return m_has_link_probe;
+}
+
+void MoonlightSession::probe_link(const std::function<void()>& done) {
+    if (load_link_probe()) {
+        done();
+        return;
+    }
+
+    auto address = m_address;
+    auto server = GameStreamClient::instance().server_data(m_address);
+    int app_id = m_app_id;
+
+    brls::async([this, address, server, app_id, done] {
+        auto result = LinkProbe::instance().probe(address, server, app_id);
+
+        brls::sync([this, result, done] {
+            if (m_active_session != this)
+                return;
+
+            m_session_stats.link_probe = result;
+            m_has_link_probe = result.time != 0;
+            m_startup_timeline.mark("Link probed");
+            done();
+        });
+    });
+}
+
+void MoonlightSession::start(ServerCallback<bool> callback, bool is_sunshine) {
+    m_is_sunshine = is_sunshine;
+
+    // Only before the first launch, reconnects keep what was picked
+    if (Settings::instance().link_probe() != LINK_PROBE_OFF && !m_link_probed &&
+        !m_is_reconnecting) {
+        probe_link([this, callback, is_sunshine] {
+            start(callback, is_sunshine);
+        });
+        return;
+    }
+
+    configure_stream();
+    configure_callbacks();
+
+    AVSyncMonitor::instance().prepare();
 
     GameStreamClient::instance().start(
         m_address, m_config, m_app_id, [this, callback](auto result) {
             if (result.isSuccess()) {
                 m_config = result.value();
+                m_startup_timeline.mark("App launched");
+
+                if (m_stop_requested) {
+                    callback(
+                        GSResult<bool>::failure("error/stream_start"_i18n));
+                    return;
+                }
+
+                wait_for_prewarm();
+
+                if (Settings::instance().adaptive_quality() &&
+                    !m_quality.is_active()) {
+                    m_quality.begin({m_config.width, m_config.height,
+                                     m_config.fps, m_config.bitrate},
+                                    LiGetMillis());
+                }
+
+                if (Settings::instance().record_session() &&
+                    !m_recorder.is_active()) {
+                    m_recorder.begin(Settings::instance().capture_dir());
+                }
 
                 auto m_data =
                     GameStreamClient::instance().server_data(m_address);
+                wait_for_reconnect_stop();
+                m_connection_stopped = false;
                 int result = LiStartConnection(
                     &m_data.serverInfo, &m_config, &m_connection_callbacks,
                     &m_video_callbacks, &m_audio_callbacks, NULL, 0, NULL, 0);
 
                 if (result != 0) {
                     LiStopConnection();
+                    m_connection_stopped = true;
                     callback(
                         GSResult<bool>::failure("error/stream_start"_i18n));
                 } else {
@@ -338,24 +618,277 @@ void MoonlightSession::start(ServerCallback<bool> callback, bool is_sunshine) {
         });
 }
 
+bool MoonlightSession::start_replay(const std::string& path, bool fast) {
+    configure_stream();
+    configure_callbacks();
+
+    AVSyncMonitor::instance().prepare();
+    wait_for_prewarm();
+
+    m_replayer = new SessionReplayer(path, fast);
+    if (!m_replayer->start(&m_connection_callbacks, &m_video_callbacks,
+                           &m_audio_callbacks)) {
+        delete m_replayer;
+        m_replayer = nullptr;
+        return false;
+    }
+    return true;
+}
+
 void MoonlightSession::stop(int terminate_app) {
-    if (terminate_app) {
-        GameStreamClient::instance().quit(m_address, [](auto _) {});
+    m_stop_requested = true;
+    m_is_reconnecting = false;
+    if (m_reconnect_delay != (size_t)-1) {
+        brls::cancelDelay(m_reconnect_delay);
+        m_reconnect_delay = -1;
+    }
+    wait_for_prewarm();
+    wait_for_reconnect_stop();
+
+    if (m_replayer) {
+        m_replayer->stop();
+        log_replay_stats();
+    } else {
+        if (terminate_app) {
+            GameStreamClient::instance().quit(m_address, [](auto _) {});
+        }
+
+        // moonlight-common-c's teardown isn't reentrant
+        if (!m_connection_stopped)
+            LiStopConnection();
+        m_connection_stopped = true;
+    }
+
+    release_video_decoder();
+    m_recorder.finish();
+
+    auto steps = m_startup_timeline.steps();
+    m_telemetry.finish(
+        m_startup_timeline.is_complete() ? steps.back().time : 0,
+        m_session_stats.reconnect_stats.reconnects);
+}
+
+// MARK: Reconnection
+
+void MoonlightSession::begin_reconnect(bool quality_restart) {
+    if (m_is_reconnecting || m_stop_requested)
+        return;
+
+    m_is_reconnecting = true;
+    m_is_quality_restart = quality_restart;
+    m_reconnect_start = LiGetMillis();
+
+    if (quality_restart) {
+        brls::Logger::info("MoonlightSession: Restarting with new quality");
+    } else {
+        brls::Logger::info("MoonlightSession: Reconnection attempt");
+        m_telemetry.event("reconnect_started");
     }
 
-    LiStopConnection();
+    // Stopping joins the connection threads, so it can't run in the
+    // termination callback or on the UI thread. It gets a thread of its
+    // own rather than holding up the shared async one.
+    wait_for_reconnect_stop();
+    m_connection_stopped = true;
+    m_reconnect_stop = std::async(std::launch::async, [this] {
+        LiStopConnection();
+
+        brls::sync([this] {
+            if (m_active_session == this && m_is_reconnecting)
+                reconnect(0);
+        });
+    });
+}
+
+void MoonlightSession::reconnect(int attempt) {
+    int delay = attempt == 0 ? 0
+                             : std::min(reconnect_base_delay_ms << (attempt - 1),
+                                        reconnect_max_delay_ms);
+
+    auto attempt_start = [this, attempt] {
+        m_reconnect_delay = -1;
+        if (m_active_session != this || !m_is_reconnecting)
+            return;
+
+        // Host data from the initial connect() is reused as is,
+        // only the launch session gets resumed
+        start([this, attempt](const GSResult<bool>& result) {
+            if (m_active_session != this || !m_is_reconnecting)
+                return;
+
+            if (result.isSuccess()) {
+                finish_reconnect(true);
+            } else if (attempt + 1 < reconnect_attempts) {
+                m_session_stats.reconnect_stats.failed_attempts++;
+                brls::Logger::info(
+                    "MoonlightSession: Reconnection attempt {} failed: {}",
+                    attempt + 1, result.error());
+                reconnect(attempt + 1);
+            } else {
+                m_session_stats.reconnect_stats.failed_attempts++;
+                finish_reconnect(false);
+            }
+        }, m_is_sunshine);
+    };
+
+    // Backs off on the UI thread's timers, stop() cancels the wait
+    if (delay > 0)
+        m_reconnect_delay = brls::delay(delay, attempt_start);
+    else
+        attempt_start();
+}
+
+void MoonlightSession::finish_reconnect(bool success) {
+    auto& stats = m_session_stats.reconnect_stats;
+    uint32_t duration = (uint32_t)(LiGetMillis() - m_reconnect_start);
+    bool quality_restart = m_is_quality_restart;
+    m_is_reconnecting = false;
+    m_is_quality_restart = false;
+
+    if (success)
+        m_quality.restarted(LiGetMillis());
+
+    if (success && quality_restart) {
+        brls::Logger::info("MoonlightSession: Quality changed in {} ms",
+                           duration);
+        m_telemetry.event("quality_restarted",
+                          fmt::format("duration_ms={}", duration));
+        return;
+    }
+
+    if (success) {
+        stats.reconnects++;
+        stats.last_reconnect_time = duration;
+        stats.total_reconnect_time += duration;
+        brls::Logger::info("MoonlightSession: Reconnected in {} ms", duration);
+        m_telemetry.event("reconnected", fmt::format("duration_ms={}", duration));
+        return;
+    }
+
+    brls::Logger::info("MoonlightSession: Reconnection failed after {} ms",
+                       duration);
+    m_telemetry.event("reconnect_failed", fmt::format("duration_ms={}", duration));
+    release_video_decoder();
+    m_is_active = false;
+    m_is_terminated = true;
+}
+
+void MoonlightSession::log_replay_stats() {
+    if (!m_video_decoder || !m_video_renderer)
+        return;
+
+    const auto& decode = *m_video_decoder->video_decode_stats();
+    const auto& render = *m_video_renderer->video_render_stats();
+    auto& frames = AVFrameHolder::instance();
+
+    brls::Logger::info(
+        "MoonlightSession: Replay of {} finished\n"
+        "  Decoded frames: {}, network dropped: {}\n"
+        "  Decoded fps: {:.2f}, rendered fps: {:.2f}\n"
+        "  Receive time: {:.2f} ms, decode time: {:.2f} ms, render time: "
+        "{:.2f} ms\n"
+        "  Frame queue reuses: {}, drops: {}\n"
+        "  A/V offset: {:.1f} ms",
+        m_replayer->path(),
+        decode.total_decoded_frames + decode.current_decoded_frames,
+        decode.network_dropped_frames, decode.current_decoded_fps,
+        render.rendered_fps, decode.session_receive_time,
+        decode.session_decoding_time, render.rendering_time,
+        frames.getFakeFrameStat(), frames.getFrameDropStat(),
+        AVSyncMonitor::instance().stats().av_offset);
+}
+
+void MoonlightSession::release_video_decoder() {
+    if (m_video_decoder && m_video_decoder_ready) {
+        m_video_decoder->cleanup();
+        m_video_decoder_ready = false;
+    }
 }
 
 void MoonlightSession::draw(NVGcontext* vg, int width, int height) {
     if (m_video_decoder && m_video_renderer) {
         AVFrameHolder::instance().get(
-            [this, vg, width, height](AVFrame* frame) {
+            [this, vg, width, height](AVFrame* frame,
+                                      const AVFrameTiming& timing,
+                                      bool is_new) {
                 m_video_renderer->draw(vg, width, height, frame, m_video_format);
+
+                if (is_new) {
+                    AVSyncMonitor::instance().video_presented(timing);
+
+                    if (!m_startup_timeline.is_complete())
+                        m_startup_timeline.complete("First frame presented");
+                }
             });
 
         m_session_stats.video_decode_stats =
             *m_video_decoder->video_decode_stats();
         m_session_stats.video_render_stats =
             *m_video_renderer->video_render_stats();
+        m_session_stats.av_sync_stats = AVSyncMonitor::instance().stats();
+
+        if (m_telemetry.should_sample(LiGetMillis()))
+            sample_telemetry();
+
+        if (m_is_active && !m_is_reconnecting &&
+            m_quality.should_sample(LiGetMillis()))
+            adapt_quality();
     }
 }
+
+void MoonlightSession::adapt_quality() {
+    const auto& decode = m_session_stats.video_decode_stats;
+
+    QualitySample sample = {};
+    sample.decoded_frames =
+        decode.total_decoded_frames + decode.current_decoded_frames;
+    sample.network_dropped_frames = decode.network_dropped_frames;
+    sample.queue_drops = AVFrameHolder::instance().getFrameDropStat();
+    sample.connection_poor = m_connection_status_is_poor;
+
+    QualityDecision decision = m_quality.sample(sample, LiGetMillis());
+    m_session_stats.quality_stats = m_quality.stats();
+    if (decision == QUALITY_KEEP)
+        return;
+
+    const auto& tier = m_quality.tier();
+    m_telemetry.event(
+        decision == QUALITY_DOWNGRADE ? "quality_down" : "quality_up",
+        fmt::format("width={} height={} fps={} bitrate={} reason={}",
+                    tier.width, tier.height, tier.fps, tier.bitrate,
+                    m_quality.reason()));
+
+    // The status is reported again by the new connection
+    m_connection_status_is_poor = false;
+    begin_reconnect(true);
+}
+
+void MoonlightSession::sample_telemetry() {
+    const auto& decode = m_session_stats.video_decode_stats;
+    const auto& render = m_session_stats.video_render_stats;
+    auto& frames = AVFrameHolder::instance();
+
+    TelemetrySample sample = {};
+    sample.host_fps = decode.current_host_fps;
+    sample.received_fps = decode.current_received_fps;
+    sample.decoded_fps = decode.current_decoded_fps;
+    sample.rendered_fps = render.rendered_fps;
+    sample.receive_time = decode.current_receive_time;
+    sample.decode_time = decode.current_decoding_time;
+    sample.render_time = render.rendering_time;
+    sample.decoded_frames =
+        decode.total_decoded_frames + decode.current_decoded_frames;
+    sample.network_dropped_frames = decode.network_dropped_frames;
+    sample.queue_reuses = frames.getFakeFrameStat();
+    sample.queue_drops = frames.getFrameDropStat();
+    sample.queue_size = frames.getFrameQueueSize();
+    sample.av_offset = m_session_stats.av_sync_stats.av_offset;
+    sample.connection_poor = m_connection_status_is_poor;
+
+    if (!LiGetEstimatedRttInfo(&sample.rtt, &sample.rtt_variance)) {
+        sample.rtt = 0;
+        sample.rtt_variance = 0;
+    }
+
+    m_telemetry.sample(sample);
+}
@@ -1,12 +1,36 @@
 #pragma once
 
+#include "AVSyncMonitor.hpp"
 #include "GameStreamClient.hpp"
+#include "LinkProbe.hpp"
 #include "MoonlightSessionDecoderAndRenderProvider.hpp"
+#include "QualityController.hpp"
+#include "SessionRecorder.hpp"
+#include "SessionReplayer.hpp"
+#include "SessionTelemetry.hpp"
+#include "StartupTimeline.hpp"
+#include <future>
 #include <nanovg.h>
 
+struct ReconnectStats {
+    uint32_t reconnects;
+    uint32_t failed_attempts;
+
+    // From connection loss to the restarted stream, ms
+    uint32_t last_reconnect_time;
+    uint32_t total_reconnect_time;
+};
+
 struct SessionStats {
     VideoDecodeStats video_decode_stats;
     VideoRenderStats video_render_stats;
+    AVSyncStats av_sync_stats;
+    ReconnectStats reconnect_stats;
+    QualityStats quality_stats;
+
+    // Only set when a link probe ran or came from the cache
+    LinkProbeResult link_probe;
+    LinkSuggestion link_suggestion;
 };
 
 class MoonlightSession {
@@ -17,13 +41,26 @@ class MoonlightSession {
     MoonlightSession(const std::string& address, int app_id);
     ~MoonlightSession();
 
+    // Sets up the decoder and renderer resources for the expected stream
+    // while the host requests are still in flight
+    void prewarm();
+
     void start(ServerCallback<bool> callback, bool is_sunshine);
+
+    // Feeds a session recording to the decoder and renderers
+    // instead of connecting to the host
+    bool start_replay(const std::string& path, bool fast);
     void stop(int terminate_app);
 
     void draw(NVGcontext* vg, int width, int height);
 
     bool is_active() const { return m_is_active; }
     bool is_terminated() const { return m_is_terminated; }
+    bool is_reconnecting() const { return m_is_reconnecting; }
+    bool is_changing_quality() const {
+        return m_is_reconnecting && m_is_quality_restart;
+    }
+    bool is_replay() const { return m_replayer != nullptr; }
 
     bool connection_status_is_poor() const {
         return m_connection_status_is_poor;
@@ -33,6 +70,8 @@ class MoonlightSession {
         return m_use_hdr;
     }
 
+    StartupTimeline& startup_timeline() { return m_startup_timeline; }
+
     SessionStats* session_stats() const {
         return (SessionStats*)&m_session_stats;
     }
@@ -64,6 +103,38 @@ class MoonlightSession {
     static void audio_renderer_cleanup();
     static void audio_renderer_decode_and_play_sample(char*, int);
 
+    void configure_stream();
+    bool load_link_probe();
+    void probe_link(const std::function<void()>& done);
+    void configure_callbacks();
+    void log_replay_stats();
+    void sample_telemetry();
+    void adapt_quality();
+    void wait_for_prewarm();
+    void wait_for_reconnect_stop();
+
+    void begin_reconnect(bool quality_restart = false);
+    void reconnect(int attempt);
+    void finish_reconnect(bool success);
+    void release_video_decoder();
+
+    static constexpr int reconnect_attempts = 5;
+    static constexpr int reconnect_base_delay_ms = 500;
+    static constexpr int reconnect_max_delay_ms = 8000;
+
+    struct VideoSetup {
+        int video_format;
+        int width;
+        int height;
+        int redraw_rate;
+
+        bool operator==(const VideoSetup& other) const {
+            return video_format == other.video_format &&
+                   width == other.width && height == other.height &&
+                   redraw_rate == other.redraw_rate;
+        }
+    };
+
     std::string m_address;
     int m_app_id;
     bool m_is_sunshine = false;
@@ -81,5 +152,33 @@ class MoonlightSession {
     bool m_connection_status_is_poor = false;
     bool m_use_hdr = false;
 
+    // While reconnecting, the decoder is kept alive between connections
+    bool m_is_reconnecting = false;
+    bool m_stop_requested = false;
+    uint64_t m_reconnect_start = 0;
+    // LiStopConnection() of a reconnect runs off the UI thread. stop()
+    // waits for it, and skips its own while no connection started since.
+    std::future<void> m_reconnect_stop;
+    bool m_connection_stopped = false;
+    size_t m_reconnect_delay = -1;
+    bool m_video_decoder_ready = false;
+    VideoSetup m_video_setup = {};
+
+    // Quality changes go through the same restart, without counting
+    // as a reconnect
+    QualityController m_quality;
+    bool m_is_quality_restart = false;
+
+    bool m_link_probed = false;
+    bool m_has_link_probe = false;
+
+    std::future<void> m_prewarm;
+    StartupTimeline m_startup_timeline;
+    bool m_first_frame_decoded = false;
+
+    SessionTelemetry m_telemetry;
+    SessionRecorder m_recorder;
+    SessionReplayer* m_replayer = nullptr;
+
     SessionStats m_session_stats = {};
 };
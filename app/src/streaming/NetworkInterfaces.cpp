@@ -0,0 +1,315 @@
+#include "NetworkInterfaces.hpp"
+#include <Limelight.h>
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fmt/core.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#if defined(PLATFORM_SWITCH)
+#include <switch.h>
+#elif defined(PLATFORM_PSV)
+#include <psp2/net/netctl.h>
+#else
+#include <ifaddrs.h>
+#include <net/if.h>
+#endif
+
+static int prefix_length(uint32_t netmask) {
+    uint32_t mask = ntohl(netmask);
+    int prefix = 0;
+    while (prefix < 32 && (mask & (0x80000000u >> prefix)))
+        prefix++;
+    return prefix;
+}
+
+static std::string ipv4_string(uint32_t address) {
+    char buffer[INET_ADDRSTRLEN] = {};
+    inet_ntop(AF_INET, &address, buffer, sizeof(buffer));
+    return buffer;
+}
+
+// The local address the kernel picks for reaching outside the network.
+// A UDP connect() sends nothing, it only looks up the route.
+static uint32_t default_route_address() {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+        return 0;
+
+    struct sockaddr_in remote = {};
+    remote.sin_family = AF_INET;
+    remote.sin_port = htons(53);
+    inet_pton(AF_INET, "8.8.8.8", &remote.sin_addr);
+
+    struct sockaddr_in local = {};
+    socklen_t length = sizeof(local);
+    uint32_t address = 0;
+    if (connect(fd, (struct sockaddr*)&remote, sizeof(remote)) == 0 &&
+        getsockname(fd, (struct sockaddr*)&local, &length) == 0)
+        address = local.sin_addr.s_addr;
+
+    close(fd);
+    return address;
+}
+
+#if defined(PLATFORM_SWITCH)
+static std::vector<NetworkInterface> list_interfaces() {
+    uint32_t address = 0, netmask = 0;
+    if (R_FAILED(nifmGetCurrentIpConfigInfo(&address, &netmask, nullptr,
+                                            nullptr, nullptr)) ||
+        address == 0)
+        return {};
+
+    return {{"nifm", 0, address, netmask, true, ""}};
+}
+#elif defined(PLATFORM_PSV)
+static std::vector<NetworkInterface> list_interfaces() {
+    SceNetCtlInfo address_info, netmask_info;
+    if (sceNetCtlInetGetInfo(SCE_NETCTL_INFO_GET_IP_ADDRESS,
+                             &address_info) < 0 ||
+        sceNetCtlInetGetInfo(SCE_NETCTL_INFO_GET_NETMASK, &netmask_info) < 0)
+        return {};
+
+    NetworkInterface interface = {"netctl", 0, 0, 0, true, ""};
+    if (inet_pton(AF_INET, address_info.ip_address, &interface.address) != 1 ||
+        inet_pton(AF_INET, netmask_info.netmask, &interface.netmask) != 1 ||
+        interface.address == 0)
+        return {};
+
+    return {interface};
+}
+#else
+static std::vector<NetworkInterface> list_interfaces() {
+    std::vector<NetworkInterface> interfaces;
+
+    struct ifaddrs* addresses = nullptr;
+    if (getifaddrs(&addresses) != 0)
+        return interfaces;
+
+    auto find = [&interfaces](const char* name) {
+        return std::find_if(interfaces.begin(), interfaces.end(),
+                            [name](const NetworkInterface& interface) {
+                                return interface.name == name;
+                            });
+    };
+
+    for (auto* entry = addresses; entry; entry = entry->ifa_next) {
+        if (!entry->ifa_addr || !(entry->ifa_flags & IFF_UP) ||
+            (entry->ifa_flags & IFF_LOOPBACK))
+            continue;
+
+        auto it = find(entry->ifa_name);
+        if (entry->ifa_addr->sa_family == AF_INET) {
+            // Aliases past the first address aren't scanned
+            if (it != interfaces.end() && it->address != 0)
+                continue;
+            if (!entry->ifa_netmask)
+                continue;
+
+            if (it == interfaces.end()) {
+                interfaces.push_back({entry->ifa_name,
+                                      if_nametoindex(entry->ifa_name), 0, 0,
+                                      false, ""});
+                it = interfaces.end() - 1;
+            }
+            it->address =
+                ((struct sockaddr_in*)entry->ifa_addr)->sin_addr.s_addr;
+            it->netmask =
+                ((struct sockaddr_in*)entry->ifa_netmask)->sin_addr.s_addr;
+        } else if (entry->ifa_addr->sa_family == AF_INET6) {
+            auto* address = (struct sockaddr_in6*)entry->ifa_addr;
+            if (!IN6_IS_ADDR_LINKLOCAL(&address->sin6_addr))
+                continue;
+            if (it != interfaces.end() && !it->link_local.empty())
+                continue;
+
+            char buffer[INET6_ADDRSTRLEN] = {};
+            inet_ntop(AF_INET6, &address->sin6_addr, buffer, sizeof(buffer));
+
+            if (it == interfaces.end()) {
+                interfaces.push_back({entry->ifa_name,
+                                      if_nametoindex(entry->ifa_name), 0, 0,
+                                      false, ""});
+                it = interfaces.end() - 1;
+            }
+            it->link_local = buffer;
+        }
+    }
+
+    freeifaddrs(addresses);
+    return interfaces;
+}
+#endif
+
+std::vector<NetworkInterface> network_interfaces() {
+    auto interfaces = list_interfaces();
+
+    uint32_t route = default_route_address();
+    for (auto& interface : interfaces) {
+        if (route != 0 && interface.address == route)
+            interface.default_route = true;
+    }
+
+    // IPv4 ones before the link-local only ones
+    std::stable_sort(interfaces.begin(), interfaces.end(),
+                     [](const NetworkInterface& l, const NetworkInterface& r) {
+                         if (l.default_route != r.default_route)
+                             return l.default_route;
+                         return (l.address != 0) > (r.address != 0);
+                     });
+    return interfaces;
+}
+
+std::string network_cidr(const NetworkInterface& interface) {
+    return fmt::format("{}/{}", ipv4_string(interface.address & interface.netmask),
+                       prefix_length(interface.netmask));
+}
+
+uint32_t network_broadcast(const NetworkInterface& interface) {
+    return interface.address | ~interface.netmask;
+}
+
+bool network_contains(const NetworkInterface& interface, uint32_t address) {
+    return interface.address != 0 &&
+           (address & interface.netmask) ==
+               (interface.address & interface.netmask);
+}
+
+std::vector<std::string> network_hosts(const NetworkInterface& interface,
+                                       size_t max_addresses) {
+    std::vector<std::string> hosts;
+
+    // Point to point links have nobody else to find
+    int prefix = prefix_length(interface.netmask);
+    if (interface.address == 0 || prefix >= 31)
+        return hosts;
+
+    uint32_t mask = ntohl(interface.netmask);
+    uint32_t self = ntohl(interface.address);
+    uint64_t size = 1ull << (32 - prefix);
+    if (size > max_addresses) {
+        // Rounded down to a power of two so the block stays aligned
+        uint64_t block = 1;
+        while (block * 2 <= max_addresses)
+            block *= 2;
+        size = block;
+        mask = ~(uint32_t)(block - 1);
+    }
+
+    uint32_t network = self & mask;
+    uint32_t first = network;
+    uint32_t last = network + (uint32_t)(size - 1);
+
+    // A cut down block has no network or broadcast address of its own,
+    // unless it sits at an end of the real network
+    uint32_t real_network = self & ntohl(interface.netmask);
+    uint32_t real_broadcast = real_network | ~ntohl(interface.netmask);
+    for (uint64_t address = first; address <= last; address++) {
+        if (address == self || address == real_network ||
+            address == real_broadcast)
+            continue;
+        hosts.push_back(ipv4_string(htonl((uint32_t)address)));
+    }
+    return hosts;
+}
+
+// An IPv4 or IPv6 literal, link local IPv6 ones may carry the index of
+// their interface after a '%'
+static bool probe_address(const std::string& address, uint16_t port,
+                          struct sockaddr_storage* addr, socklen_t* length) {
+    auto ipv4 = (struct sockaddr_in*)addr;
+    if (inet_pton(AF_INET, address.c_str(), &ipv4->sin_addr) == 1) {
+        ipv4->sin_family = AF_INET;
+        ipv4->sin_port = htons(port);
+        *length = sizeof(struct sockaddr_in);
+        return true;
+    }
+
+    auto ipv6 = (struct sockaddr_in6*)addr;
+    std::string ip = address.substr(0, address.find('%'));
+    if (inet_pton(AF_INET6, ip.c_str(), &ipv6->sin6_addr) != 1)
+        return false;
+    ipv6->sin6_family = AF_INET6;
+    ipv6->sin6_port = htons(port);
+    if (ip.size() < address.size())
+        ipv6->sin6_scope_id = (uint32_t)atoi(address.c_str() + ip.size() + 1);
+    *length = sizeof(struct sockaddr_in6);
+    return true;
+}
+
+std::vector<std::string>
+network_probe(const std::vector<std::string>& addresses, uint16_t port,
+              int timeout_ms) {
+    std::vector<std::string> responsive;
+    std::vector<struct pollfd> fds;
+    std::vector<const std::string*> pending;
+
+    for (const std::string& address : addresses) {
+        struct sockaddr_storage addr = {};
+        socklen_t addr_length;
+        if (!probe_address(address, port, &addr, &addr_length))
+            continue;
+
+        int fd = socket(addr.ss_family, SOCK_STREAM, 0);
+        if (fd < 0)
+            continue;
+
+        int flags = fcntl(fd, F_GETFL, 0);
+        if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+            close(fd);
+            continue;
+        }
+
+        if (connect(fd, (struct sockaddr*)&addr, addr_length) == 0) {
+            responsive.push_back(address);
+            close(fd);
+        } else if (errno == EINPROGRESS) {
+            fds.push_back({fd, POLLOUT, 0});
+            pending.push_back(&address);
+        } else {
+            close(fd);
+        }
+    }
+
+    uint64_t deadline = LiGetMillis() + timeout_ms;
+    size_t left = fds.size();
+    while (left > 0) {
+        uint64_t now = LiGetMillis();
+        if (now >= deadline)
+            break;
+
+        int ready = poll(fds.data(), fds.size(), (int)(deadline - now));
+        if (ready < 0 && errno != EINTR)
+            break;
+
+        for (size_t i = 0; i < fds.size() && ready > 0; i++) {
+            if (fds[i].fd < 0 || fds[i].revents == 0)
+                continue;
+
+            int error = 0;
+            socklen_t length = sizeof(error);
+            if (getsockopt(fds[i].fd, SOL_SOCKET, SO_ERROR, &error,
+                           &length) == 0 &&
+                error == 0)
+                responsive.push_back(*pending[i]);
+
+            // Negative descriptors are skipped by poll()
+            close(fds[i].fd);
+            fds[i].fd = -1;
+            left--;
+            ready--;
+        }
+    }
+
+    for (auto& fd : fds) {
+        if (fd.fd >= 0)
+            close(fd.fd);
+    }
+    return responsive;
+}
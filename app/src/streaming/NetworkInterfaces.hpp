@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct NetworkInterface {
+    std::string name;
+    uint32_t index;     // 0 where the platform has no interface indices
+    uint32_t address;   // IPv4, network byte order
+    uint32_t netmask;   // Network byte order
+    bool default_route; // Carries the route to the internet
+    std::string link_local; // IPv6 fe80:: address, empty if there is none
+};
+
+// Every IPv4 interface that is up, loopback ones aside. The one holding
+// the default route comes first, it's where a host is most likely to be.
+// Interfaces without IPv4 that have an IPv6 link-local address are listed
+// too, with a zero address.
+std::vector<NetworkInterface> network_interfaces();
+
+// "a.b.c.d/prefix" of the interface's network
+std::string network_cidr(const NetworkInterface& interface);
+
+// Directed broadcast address of the interface, network byte order
+uint32_t network_broadcast(const NetworkInterface& interface);
+
+// Whether the IPv4 address, network byte order, is on the interface's
+// network
+bool network_contains(const NetworkInterface& interface, uint32_t address);
+
+// The interface's own network without the interface itself, network and
+// broadcast addresses. Networks wider than max_addresses get cut down to
+// the block of that size around the interface's address.
+std::vector<std::string> network_hosts(const NetworkInterface& interface,
+                                       size_t max_addresses);
+
+// Connects to every IPv4 or IPv6 address at once with non-blocking sockets and
+// returns the ones that accepted within timeout_ms. Refused or
+// unreachable addresses drop out as soon as their error comes back.
+std::vector<std::string> network_probe(const std::vector<std::string>& addresses,
+                                       uint16_t port, int timeout_ms);
@@ -0,0 +1,207 @@
+#include "QualityController.hpp"
+#include <algorithm>
+#include <borealis.hpp>
+
+static std::string tier_name(const QualityTier& tier) {
+    return fmt::format("{}x{}@{} {} kbps", tier.width, tier.height, tier.fps,
+                       tier.bitrate);
+}
+
+static int64_t pixel_rate(const QualityTier& tier) {
+    return (int64_t)tier.width * tier.height * tier.fps;
+}
+
+void QualityController::begin(const QualityTier& requested, uint64_t now) {
+    m_tiers = ladder(requested);
+    m_tier = 0;
+    m_reason.clear();
+    m_last_upgrade = 0;
+    m_upgrade_delay = upgrade_delay_ms;
+    m_downgrades = 0;
+    m_upgrades = 0;
+    restarted(now);
+
+    std::string names;
+    for (auto& tier : m_tiers)
+        names += "\n  " + tier_name(tier);
+    brls::Logger::info("QualityController: {} tiers:{}", m_tiers.size(),
+                       names);
+}
+
+std::vector<QualityTier>
+QualityController::ladder(const QualityTier& requested) {
+    std::vector<QualityTier> tiers = {requested};
+
+    auto add = [&tiers](const QualityTier& tier) {
+        auto& last = tiers.back();
+        if (tier.width != last.width || tier.height != last.height ||
+            tier.fps != last.fps || tier.bitrate != last.bitrate)
+            tiers.push_back(tier);
+    };
+
+    // Same picture with less bandwidth
+    for (float scale : {0.7f, 0.5f}) {
+        int bitrate = (int)(requested.bitrate * scale);
+        if (bitrate < min_bitrate)
+            break;
+        add({requested.width, requested.height, requested.fps, bitrate});
+    }
+
+    // Smaller pictures, keeping the aspect ratio and bits per pixel
+    for (int height : {1080, 720, 480, 360}) {
+        if (height >= requested.height)
+            continue;
+
+        auto previous = tiers.back();
+        int width = (height * requested.width / requested.height + 1) & ~1;
+        double pixels = (double)width * height /
+                        ((double)previous.width * previous.height);
+        int bitrate = std::max((int)(previous.bitrate * pixels), min_bitrate);
+        add({width, height, requested.fps,
+             std::min(bitrate, previous.bitrate)});
+    }
+
+    // Half the frame rate as the last resort
+    if (requested.fps > 30) {
+        auto previous = tiers.back();
+        int bitrate =
+            std::max(previous.bitrate * 30 / previous.fps, min_bitrate);
+        add({previous.width, previous.height, 30,
+             std::min(bitrate, previous.bitrate)});
+    }
+    return tiers;
+}
+
+int QualityController::next_lower_pixel_rate() const {
+    for (int i = m_tier + 1; i < (int)m_tiers.size(); i++) {
+        if (pixel_rate(m_tiers[i]) < pixel_rate(m_tiers[m_tier]))
+            return i;
+    }
+    return -1;
+}
+
+QualityStats QualityController::stats() const {
+    QualityStats stats = {};
+    if (is_active()) {
+        stats.tier = m_tier;
+        stats.tiers = (int)m_tiers.size();
+        stats.current = tier();
+    }
+    stats.downgrades = m_downgrades;
+    stats.upgrades = m_upgrades;
+    return stats;
+}
+
+bool QualityController::should_sample(uint64_t now) {
+    if (!is_active() || now - m_last_sample < sample_interval_ms)
+        return false;
+
+    m_last_sample = now;
+    return true;
+}
+
+void QualityController::restarted(uint64_t now) {
+    m_window.clear();
+    m_window_pos = 0;
+    m_has_baseline = false;
+    m_last_sample = now;
+    m_settle_until = now + settle_time_ms;
+    m_clean_since = 0;
+}
+
+QualityDecision QualityController::sample(const QualitySample& sample,
+                                          uint64_t now) {
+    // Decoder counters restart with the connection, take a new baseline
+    if (!m_has_baseline || sample.decoded_frames < m_last.decoded_frames ||
+        sample.network_dropped_frames < m_last.network_dropped_frames ||
+        sample.queue_drops < m_last.queue_drops) {
+        m_last = sample;
+        m_has_baseline = true;
+        return QUALITY_KEEP;
+    }
+
+    Window second = {
+        sample.decoded_frames - m_last.decoded_frames,
+        sample.network_dropped_frames - m_last.network_dropped_frames,
+        (uint32_t)(sample.queue_drops - m_last.queue_drops),
+        sample.connection_poor};
+    m_last = sample;
+
+    // Skip the first seconds of a new connection, they always look bad
+    if (now < m_settle_until)
+        return QUALITY_KEEP;
+
+    if (m_window.size() < window_size) {
+        m_window.push_back(second);
+    } else {
+        m_window[m_window_pos] = second;
+    }
+    m_window_pos = (m_window_pos + 1) % window_size;
+
+    if (m_window.size() < window_size)
+        return QUALITY_KEEP;
+
+    uint32_t frames = 0, dropped = 0, queue_drops = 0;
+    size_t poor = 0;
+    for (auto& entry : m_window) {
+        frames += entry.frames;
+        dropped += entry.dropped;
+        queue_drops += entry.queue_drops;
+        if (entry.poor)
+            poor++;
+    }
+
+    float drop_ratio =
+        frames + dropped > 0 ? (float)dropped / (frames + dropped) : 0;
+    float backlog_ratio = frames > 0 ? (float)queue_drops / frames : 0;
+
+    int target = -1;
+    if (backlog_ratio >= backlog_ratio_down) {
+        target = next_lower_pixel_rate();
+        m_reason = fmt::format("render backlog {:.1f}%", backlog_ratio * 100);
+    }
+
+    if (target < 0 && m_tier + 1 < (int)m_tiers.size()) {
+        if (drop_ratio >= drop_ratio_down) {
+            target = m_tier + 1;
+            m_reason = fmt::format("network drops {:.1f}%", drop_ratio * 100);
+        } else if (poor >= poor_seconds) {
+            target = m_tier + 1;
+            m_reason = fmt::format("poor connection {}/{} s", poor, window_size);
+        }
+    }
+
+    if (target >= 0) {
+        // Taking back a recent upgrade, be slower with the next one
+        if (m_last_upgrade != 0 && now - m_last_upgrade < probation_time_ms)
+            m_upgrade_delay = std::min(m_upgrade_delay * 2, max_upgrade_delay_ms);
+
+        m_tier = target;
+        m_downgrades++;
+        m_clean_since = 0;
+        brls::Logger::info("QualityController: Down to {} ({})",
+                           tier_name(tier()), m_reason);
+        return QUALITY_DOWNGRADE;
+    }
+
+    bool clean = poor == 0 && drop_ratio <= drop_ratio_up &&
+                 backlog_ratio <= backlog_ratio_up;
+    if (!clean) {
+        m_clean_since = 0;
+        return QUALITY_KEEP;
+    }
+
+    if (m_clean_since == 0)
+        m_clean_since = now;
+
+    if (m_tier > 0 && now - m_clean_since >= m_upgrade_delay) {
+        m_reason = fmt::format("clean for {} s", (now - m_clean_since) / 1000);
+        m_tier--;
+        m_upgrades++;
+        m_last_upgrade = now;
+        brls::Logger::info("QualityController: Up to {} ({})",
+                           tier_name(tier()), m_reason);
+        return QUALITY_UPGRADE;
+    }
+    return QUALITY_KEEP;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct QualityTier {
+    int width;
+    int height;
+    int fps;
+    int bitrate;
+};
+
+// Session totals, as shown in the stats overlay
+struct QualitySample {
+    uint32_t decoded_frames;
+    uint32_t network_dropped_frames;
+    size_t queue_drops;
+    bool connection_poor;
+};
+
+enum QualityDecision { QUALITY_KEEP, QUALITY_DOWNGRADE, QUALITY_UPGRADE };
+
+struct QualityStats {
+    int tier;  // 0 is the requested quality
+    int tiers; // 0 while adaptive quality is off
+    QualityTier current;
+    uint32_t downgrades;
+    uint32_t upgrades;
+};
+
+// Picks the stream quality from how the connection behaved over the last
+// few seconds. Starting from the requested settings it builds a ladder of
+// tiers: lower bitrates first, then lower resolutions, then a lower frame
+// rate. Packet loss or a poor connection status steps one tier down, frames
+// piling up in front of the renderer skip straight to a tier with fewer
+// pixels per second, since a lower bitrate won't help the decoder.
+// Stepping up again needs a clean window for upgrade_delay, which doubles
+// every time an upgrade has to be taken back shortly after.
+class QualityController {
+  public:
+    // Tiers from the requested quality down to the lowest one
+    static std::vector<QualityTier> ladder(const QualityTier& requested);
+
+    void begin(const QualityTier& requested, uint64_t now);
+
+    [[nodiscard]] bool is_active() const { return !m_tiers.empty(); }
+    [[nodiscard]] const QualityTier& tier() const { return m_tiers[m_tier]; }
+    [[nodiscard]] const std::string& reason() const { return m_reason; }
+    [[nodiscard]] QualityStats stats() const;
+
+    // Called every frame, returns true once per sample interval
+    bool should_sample(uint64_t now);
+
+    // Moves to another tier when the decision isn't QUALITY_KEEP,
+    // the caller has to restart the stream with tier()
+    QualityDecision sample(const QualitySample& sample, uint64_t now);
+
+    // The new tier is streaming, start a fresh window
+    void restarted(uint64_t now);
+
+  private:
+    struct Window {
+        uint32_t frames;
+        uint32_t dropped;
+        uint32_t queue_drops;
+        bool poor;
+    };
+
+    int next_lower_pixel_rate() const;
+
+    static constexpr int sample_interval_ms = 1000;
+    static constexpr size_t window_size = 10;
+
+    // Thresholds over the whole window
+    static constexpr size_t poor_seconds = 4;
+    static constexpr float drop_ratio_down = 0.05f;
+    static constexpr float backlog_ratio_down = 0.10f;
+    static constexpr float drop_ratio_up = 0.005f;
+    static constexpr float backlog_ratio_up = 0.01f;
+
+    static constexpr int min_bitrate = 1500;
+    static constexpr uint64_t settle_time_ms = 5000;
+    static constexpr uint64_t upgrade_delay_ms = 30000;
+    static constexpr uint64_t max_upgrade_delay_ms = 8 * 60000;
+    static constexpr uint64_t probation_time_ms = 60000;
+
+    std::vector<QualityTier> m_tiers;
+    int m_tier = 0;
+    std::string m_reason;
+
+    std::vector<Window> m_window;
+    size_t m_window_pos = 0;
+    bool m_has_baseline = false;
+    QualitySample m_last = {};
+
+    uint64_t m_last_sample = 0;
+    uint64_t m_settle_until = 0;
+    uint64_t m_clean_since = 0;
+    uint64_t m_last_upgrade = 0;
+    uint64_t m_upgrade_delay = upgrade_delay_ms;
+
+    uint32_t m_downgrades = 0;
+    uint32_t m_upgrades = 0;
+};
@@ -0,0 +1,117 @@
+#include "SessionRecorder.hpp"
+#include <borealis.hpp>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+bool SessionRecorder::begin(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto now = std::chrono::system_clock::now();
+    auto time_t = std::chrono::system_clock::to_time_t(now);
+    auto tm = *std::localtime(&time_t);
+
+    std::ostringstream oss;
+    oss << directory << "/session_" << std::put_time(&tm, "%Y-%m-%d_%H-%M-%S")
+        << ".mlsr";
+
+    if (!m_writer.open(oss.str()))
+        return false;
+
+    uint32_t version = SESSION_RECORDING_VERSION;
+    m_writer.write(SESSION_RECORDING_MAGIC, 4);
+    m_writer.write(&version, sizeof(version));
+
+    m_start = LiGetMillis();
+    m_video_units = 0;
+    m_audio_packets = 0;
+
+    brls::Logger::info("SessionRecorder: Recording to {}", m_writer.path());
+    return true;
+}
+
+void SessionRecorder::finish() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_writer.is_open())
+        return;
+
+    m_writer.close();
+    brls::Logger::info(
+        "SessionRecorder: Recorded {} video units, {} audio packets, "
+        "{} bytes dropped",
+        m_video_units, m_audio_packets, m_writer.dropped_bytes());
+}
+
+void SessionRecorder::video_setup(int video_format, int width, int height,
+                                  int redraw_rate) {
+    SessionRecordVideoSetup setup = {video_format, width, height, redraw_rate};
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    write_record(RECORD_VIDEO_SETUP, &setup, sizeof(setup));
+}
+
+void SessionRecorder::video_unit(PDECODE_UNIT decode_unit) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_writer.is_open())
+        return;
+
+    uint64_t now = LiGetMillis();
+    SessionRecordVideoUnit unit = {
+        decode_unit->frameNumber, decode_unit->frameType,
+        decode_unit->presentationTimeMs,
+        (uint32_t)(now - decode_unit->receiveTimeMs)};
+
+    // Written as one record, entry by entry, the buffer list is never
+    // flattened here
+    SessionRecordHeader header = {};
+    header.type = RECORD_VIDEO_UNIT;
+    header.time = (uint32_t)(decode_unit->receiveTimeMs - m_start);
+    header.size = (uint32_t)(sizeof(unit) + decode_unit->fullLength);
+
+    m_chunks.clear();
+    m_chunks.push_back({&header, sizeof(header)});
+    m_chunks.push_back({&unit, sizeof(unit)});
+    for (PLENTRY entry = decode_unit->bufferList; entry != nullptr;
+         entry = entry->next) {
+        m_chunks.push_back({entry->data, (size_t)entry->length});
+    }
+    m_writer.write(m_chunks.data(), m_chunks.size());
+    m_video_units++;
+}
+
+void SessionRecorder::audio_setup(
+    int audio_configuration, const POPUS_MULTISTREAM_CONFIGURATION opus_config) {
+    SessionRecordAudioSetup setup = {
+        audio_configuration,         opus_config->sampleRate,
+        opus_config->channelCount,   opus_config->streams,
+        opus_config->coupledStreams, opus_config->samplesPerFrame};
+    memcpy(setup.mapping, opus_config->mapping, sizeof(setup.mapping));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    write_record(RECORD_AUDIO_SETUP, &setup, sizeof(setup));
+}
+
+void SessionRecorder::audio_packet(const char* data, int length) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    write_record(RECORD_AUDIO_PACKET, nullptr, 0, data, length);
+    m_audio_packets++;
+}
+
+void SessionRecorder::write_record(SessionRecordType type, const void* header,
+                                   size_t header_size, const void* payload,
+                                   size_t payload_size) {
+    if (!m_writer.is_open())
+        return;
+
+    SessionRecordHeader record = {};
+    record.type = type;
+    record.time = (uint32_t)(LiGetMillis() - m_start);
+    record.size = (uint32_t)(header_size + payload_size);
+
+    m_writer.write({{&record, sizeof(record)},
+                    {header, header_size},
+                    {payload, payload_size}});
+}
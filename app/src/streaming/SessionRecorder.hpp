@@ -0,0 +1,86 @@
+#pragma once
+
+#include "BufferedFileWriter.hpp"
+#include <Limelight.h>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Session recordings (.mlsr) hold everything the host sent to the decoder
+// and audio renderer, so a stream can be replayed offline.
+//
+// File layout, little endian:
+//   "MLSR" u32 version
+//   records: u8 type, u8[3] reserved, u32 time (ms since start),
+//            u32 payload size, payload
+#define SESSION_RECORDING_MAGIC "MLSR"
+#define SESSION_RECORDING_VERSION 1
+
+enum SessionRecordType : uint8_t {
+    RECORD_VIDEO_SETUP = 1,
+    RECORD_VIDEO_UNIT = 2,
+    RECORD_AUDIO_SETUP = 3,
+    RECORD_AUDIO_PACKET = 4,
+};
+
+struct SessionRecordHeader {
+    uint8_t type;
+    uint8_t reserved[3];
+    uint32_t time;
+    uint32_t size;
+};
+
+struct SessionRecordVideoSetup {
+    int32_t video_format;
+    int32_t width;
+    int32_t height;
+    int32_t redraw_rate;
+};
+
+// Followed by the Annex-B frame data
+struct SessionRecordVideoUnit {
+    int32_t frame_number;
+    int32_t frame_type;
+    uint32_t presentation_time;
+    uint32_t receive_delay; // From receiving the frame to its submission
+};
+
+struct SessionRecordAudioSetup {
+    int32_t audio_configuration;
+    int32_t sample_rate;
+    int32_t channel_count;
+    int32_t streams;
+    int32_t coupled_streams;
+    int32_t samples_per_frame;
+    uint8_t mapping[8];
+};
+
+// Writes the decoder and audio renderer input of a live session
+// into a session recording, from the Limelight threads.
+class SessionRecorder {
+  public:
+    bool begin(const std::string& directory);
+    void finish();
+
+    [[nodiscard]] bool is_active() const { return m_writer.is_open(); }
+
+    void video_setup(int video_format, int width, int height, int redraw_rate);
+    void video_unit(PDECODE_UNIT decode_unit);
+    void audio_setup(int audio_configuration,
+                     const POPUS_MULTISTREAM_CONFIGURATION opus_config);
+    void audio_packet(const char* data, int length);
+
+  private:
+    void write_record(SessionRecordType type, const void* header,
+                      size_t header_size, const void* payload = nullptr,
+                      size_t payload_size = 0);
+
+    std::mutex m_mutex;
+    BufferedFileWriter m_writer;
+    // Chunks of the video unit being written, kept to reuse their memory
+    std::vector<BufferedFileWriter::Chunk> m_chunks;
+    uint64_t m_start = 0;
+    uint32_t m_video_units = 0;
+    uint32_t m_audio_packets = 0;
+};
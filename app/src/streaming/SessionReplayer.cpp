@@ -0,0 +1,224 @@
+#include "SessionReplayer.hpp"
+#include <algorithm>
+#include <borealis.hpp>
+#include <cstring>
+#include <libretro-common/retro_timers.h>
+
+// Longest single sleep, so stop() never waits on a long gap in the recording
+#define REPLAY_MAX_SLEEP_MS 50
+
+SessionReplayer::SessionReplayer(const std::string& path, bool fast)
+    : m_path(path), m_fast(fast) {}
+
+SessionReplayer::~SessionReplayer() { stop(); }
+
+bool SessionReplayer::start(PCONNECTION_LISTENER_CALLBACKS connection_callbacks,
+                            PDECODER_RENDERER_CALLBACKS video_callbacks,
+                            PAUDIO_RENDERER_CALLBACKS audio_callbacks) {
+    m_file = fopen(m_path.c_str(), "rb");
+    if (m_file == nullptr) {
+        brls::Logger::error("SessionReplayer: Failed to open {}", m_path);
+        return false;
+    }
+
+    char magic[4];
+    uint32_t version = 0;
+    if (fread(magic, 1, sizeof(magic), m_file) != sizeof(magic) ||
+        memcmp(magic, SESSION_RECORDING_MAGIC, sizeof(magic)) != 0 ||
+        fread(&version, sizeof(version), 1, m_file) != 1 ||
+        version != SESSION_RECORDING_VERSION) {
+        brls::Logger::error("SessionReplayer: {} is not a session recording",
+                            m_path);
+        fclose(m_file);
+        m_file = nullptr;
+        return false;
+    }
+
+    m_connection_callbacks = *connection_callbacks;
+    m_video_callbacks = *video_callbacks;
+    m_audio_callbacks = *audio_callbacks;
+    m_stop_requested = false;
+
+    brls::Logger::info("SessionReplayer: Replaying {}{}", m_path,
+                       m_fast ? " as fast as possible" : "");
+    m_thread = std::thread(&SessionReplayer::loop, this);
+    return true;
+}
+
+void SessionReplayer::stop() {
+    m_stop_requested = true;
+
+    if (m_thread.joinable())
+        m_thread.join();
+
+    if (m_file) {
+        fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+bool SessionReplayer::read_record(SessionRecordHeader* header) {
+    if (fread(header, sizeof(*header), 1, m_file) != 1)
+        return false;
+
+    m_payload.resize(header->size);
+    return header->size == 0 ||
+           fread(m_payload.data(), 1, header->size, m_file) == header->size;
+}
+
+void SessionReplayer::wait_until(uint64_t time) {
+    if (m_fast)
+        return;
+
+    uint64_t now;
+    while (!m_stop_requested && (now = LiGetMillis()) < time) {
+        retro_sleep((int)std::min<uint64_t>(time - now, REPLAY_MAX_SLEEP_MS));
+    }
+}
+
+void SessionReplayer::loop() {
+    SessionRecordHeader header;
+    bool connection_started = false;
+
+    m_start = LiGetMillis();
+    m_video_units = 0;
+    m_audio_packets = 0;
+
+    while (!m_stop_requested && read_record(&header)) {
+        switch (header.type) {
+        case RECORD_VIDEO_SETUP: {
+            if (header.size < sizeof(SessionRecordVideoSetup))
+                break;
+
+            SessionRecordVideoSetup setup;
+            memcpy(&setup, m_payload.data(), sizeof(setup));
+
+            if (m_video_started) {
+                m_video_callbacks.stop();
+                m_video_callbacks.cleanup();
+                m_video_started = false;
+            }
+
+            if (m_video_callbacks.setup(setup.video_format, setup.width,
+                                        setup.height, setup.redraw_rate,
+                                        nullptr, 0) != DR_OK) {
+                brls::Logger::error("SessionReplayer: Video setup failed");
+                m_video_callbacks.cleanup();
+                m_stop_requested = true;
+                break;
+            }
+            m_video_callbacks.start();
+            m_video_started = true;
+            break;
+        }
+        case RECORD_AUDIO_SETUP: {
+            if (header.size < sizeof(SessionRecordAudioSetup))
+                break;
+
+            SessionRecordAudioSetup setup;
+            memcpy(&setup, m_payload.data(), sizeof(setup));
+
+            OPUS_MULTISTREAM_CONFIGURATION opus_config = {};
+            opus_config.sampleRate = setup.sample_rate;
+            opus_config.channelCount = setup.channel_count;
+            opus_config.streams = setup.streams;
+            opus_config.coupledStreams = setup.coupled_streams;
+            opus_config.samplesPerFrame = setup.samples_per_frame;
+            memcpy(opus_config.mapping, setup.mapping,
+                   sizeof(opus_config.mapping));
+
+            if (m_audio_started) {
+                m_audio_callbacks.stop();
+                m_audio_callbacks.cleanup();
+                m_audio_started = false;
+            }
+
+            if (m_audio_callbacks.init(setup.audio_configuration, &opus_config,
+                                       nullptr, 0) == DR_OK) {
+                m_audio_callbacks.start();
+                m_audio_started = true;
+            } else {
+                // Video alone is still worth replaying
+                brls::Logger::error("SessionReplayer: Audio init failed");
+                m_audio_callbacks.cleanup();
+            }
+            break;
+        }
+        case RECORD_VIDEO_UNIT:
+            if (!m_video_started ||
+                header.size < sizeof(SessionRecordVideoUnit))
+                break;
+
+            if (!connection_started) {
+                connection_started = true;
+                m_connection_callbacks.connectionStarted();
+            }
+            submit_video_unit(header);
+            break;
+        case RECORD_AUDIO_PACKET:
+            if (!m_audio_started)
+                break;
+
+            wait_until(m_start + header.time);
+            m_audio_callbacks.decodeAndPlaySample(m_payload.data(),
+                                                  (int)header.size);
+            m_audio_packets++;
+            break;
+        default:
+            break;
+        }
+    }
+
+    uint32_t duration = (uint32_t)(LiGetMillis() - m_start);
+    brls::Logger::info(
+        "SessionReplayer: Replayed {} video units, {} audio packets in {} ms "
+        "({:.1f} fps)",
+        m_video_units, m_audio_packets, duration,
+        duration > 0 ? m_video_units * 1000.0f / duration : 0);
+
+    bool finished = !m_stop_requested;
+    stop_callbacks();
+
+    // Reaching the end closes the session like the host ending the stream
+    if (finished)
+        m_connection_callbacks.connectionTerminated(0);
+}
+
+void SessionReplayer::submit_video_unit(const SessionRecordHeader& header) {
+    SessionRecordVideoUnit unit;
+    memcpy(&unit, m_payload.data(), sizeof(unit));
+
+    wait_until(m_start + header.time + unit.receive_delay);
+
+    LENTRY entry = {};
+    entry.data = m_payload.data() + sizeof(unit);
+    entry.length = (int)(header.size - sizeof(unit));
+    entry.bufferType = BUFFER_TYPE_PICDATA;
+
+    uint64_t now = LiGetMillis();
+    DECODE_UNIT decode_unit = {};
+    decode_unit.frameNumber = unit.frame_number;
+    decode_unit.frameType = unit.frame_type;
+    decode_unit.receiveTimeMs = now - unit.receive_delay;
+    decode_unit.enqueueTimeMs = now;
+    decode_unit.presentationTimeMs = unit.presentation_time;
+    decode_unit.fullLength = entry.length;
+    decode_unit.bufferList = &entry;
+
+    m_video_callbacks.submitDecodeUnit(&decode_unit);
+    m_video_units++;
+}
+
+void SessionReplayer::stop_callbacks() {
+    if (m_video_started) {
+        m_video_callbacks.stop();
+        m_video_callbacks.cleanup();
+        m_video_started = false;
+    }
+
+    if (m_audio_started) {
+        m_audio_callbacks.stop();
+        m_audio_callbacks.cleanup();
+        m_audio_started = false;
+    }
+}
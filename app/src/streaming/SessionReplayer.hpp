@@ -0,0 +1,52 @@
+#pragma once
+
+#include "SessionRecorder.hpp"
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Plays a session recording back through the same callbacks Limelight
+// would drive, so the decoder, renderers and stats overlay run on a
+// deterministic input without a host.
+// Records are fed at their recorded pace, or as fast as the decoder
+// takes them when fast is set.
+class SessionReplayer {
+  public:
+    SessionReplayer(const std::string& path, bool fast);
+    ~SessionReplayer();
+
+    // Checks the file and starts the replay thread
+    bool start(PCONNECTION_LISTENER_CALLBACKS connection_callbacks,
+               PDECODER_RENDERER_CALLBACKS video_callbacks,
+               PAUDIO_RENDERER_CALLBACKS audio_callbacks);
+    void stop();
+
+    [[nodiscard]] const std::string& path() const { return m_path; }
+    [[nodiscard]] bool is_fast() const { return m_fast; }
+
+  private:
+    void loop();
+    bool read_record(SessionRecordHeader* header);
+    void wait_until(uint64_t time);
+    void submit_video_unit(const SessionRecordHeader& header);
+    void stop_callbacks();
+
+    std::string m_path;
+    bool m_fast;
+    FILE* m_file = nullptr;
+    std::thread m_thread;
+    std::atomic<bool> m_stop_requested = {false};
+
+    CONNECTION_LISTENER_CALLBACKS m_connection_callbacks = {};
+    DECODER_RENDERER_CALLBACKS m_video_callbacks = {};
+    AUDIO_RENDERER_CALLBACKS m_audio_callbacks = {};
+
+    std::vector<char> m_payload;
+    uint64_t m_start = 0;
+    bool m_video_started = false;
+    bool m_audio_started = false;
+    uint32_t m_video_units = 0;
+    uint32_t m_audio_packets = 0;
+};
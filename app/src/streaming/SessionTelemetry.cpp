@@ -0,0 +1,290 @@
+#include "SessionTelemetry.hpp"
+#include <Limelight.h>
+#include <algorithm>
+#include <borealis.hpp>
+#include <chrono>
+#include <dirent.h>
+#include <iomanip>
+#include <sstream>
+#include <sys/stat.h>
+#include <vector>
+
+#define TELEMETRY_FILE_PREFIX "telemetry_"
+
+static const char* csv_columns =
+    "time_ms,host_fps,received_fps,decoded_fps,rendered_fps,receive_ms,"
+    "decode_ms,render_ms,decoded_frames,network_dropped_frames,queue_size,"
+    "queue_reuses,queue_drops,rtt_ms,rtt_variance_ms,av_offset_ms,"
+    "connection_poor";
+
+static std::string json_escape(const std::string& value) {
+    std::string result;
+    result.reserve(value.size());
+    for (char c : value) {
+        if (c == '"' || c == '\\')
+            result += '\\';
+        if ((unsigned char)c >= 0x20)
+            result += c;
+    }
+    return result;
+}
+
+bool SessionTelemetry::begin(const std::string& directory,
+                             TelemetryFormat format,
+                             const TelemetryStream& stream) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (format == TELEMETRY_OFF)
+        return false;
+
+    auto now = std::chrono::system_clock::now();
+    auto time_t = std::chrono::system_clock::to_time_t(now);
+    auto tm = *std::localtime(&time_t);
+
+    std::ostringstream oss;
+    oss << directory << "/" TELEMETRY_FILE_PREFIX
+        << std::put_time(&tm, "%Y-%m-%d_%H-%M-%S");
+
+    m_writer.close();
+    m_format = format;
+    m_directory = directory;
+    m_file_prefix = oss.str();
+    m_stream = stream;
+    m_part = 0;
+    m_start = LiGetMillis();
+    m_last_sample = m_start;
+
+    m_samples = 0;
+    m_decoded_fps_sum = 0;
+    m_rendered_fps_sum = 0;
+    m_rtt_samples = 0;
+    m_rtt_sum = 0;
+    m_rtt_min = UINT32_MAX;
+    m_rtt_max = 0;
+    m_poor_samples = 0;
+    m_last = {};
+
+    if (!open_file()) {
+        m_format = TELEMETRY_OFF;
+        return false;
+    }
+
+    cleanup_old_files();
+    brls::Logger::info("SessionTelemetry: Writing to {}", m_writer.path());
+    return true;
+}
+
+bool SessionTelemetry::open_file() {
+    std::string path = m_file_prefix;
+    if (m_part > 0)
+        path += fmt::format("_{}", m_part);
+    path += m_format == TELEMETRY_CSV ? ".csv" : ".jsonl";
+
+    if (!m_writer.open(path))
+        return false;
+
+    m_written = 0;
+
+    // Every part starts with the stream description, so it can be
+    // analyzed on its own
+    if (m_format == TELEMETRY_CSV) {
+        write_line(fmt::format(
+            "# host={} app_id={} codec={} resolution={}x{} fps={} "
+            "bitrate_kbps={} part={}",
+            m_stream.address, m_stream.app_id, m_stream.codec, m_stream.width,
+            m_stream.height, m_stream.fps, m_stream.bitrate, m_part));
+        write_line(csv_columns);
+    } else {
+        write_line(fmt::format(
+            "{{\"type\":\"session\",\"host\":\"{}\",\"app_id\":{},"
+            "\"codec\":\"{}\",\"width\":{},\"height\":{},\"fps\":{},"
+            "\"bitrate_kbps\":{},\"part\":{}}}",
+            json_escape(m_stream.address), m_stream.app_id,
+            json_escape(m_stream.codec), m_stream.width, m_stream.height,
+            m_stream.fps, m_stream.bitrate, m_part));
+    }
+    return true;
+}
+
+bool SessionTelemetry::is_active() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_format != TELEMETRY_OFF;
+}
+
+void SessionTelemetry::write_line(const std::string& line) {
+    m_writer.write({{line.data(), line.size()}, {"\n", 1}});
+    m_written += line.size() + 1;
+}
+
+bool SessionTelemetry::should_sample(uint64_t now) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_format == TELEMETRY_OFF || now - m_last_sample < sample_interval_ms)
+        return false;
+
+    m_last_sample = now;
+    return true;
+}
+
+void SessionTelemetry::sample(const TelemetrySample& sample) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_format == TELEMETRY_OFF)
+        return;
+
+    if (m_written >= max_file_size) {
+        m_part++;
+        if (!open_file()) {
+            m_format = TELEMETRY_OFF;
+            return;
+        }
+    }
+
+    uint32_t time = (uint32_t)(LiGetMillis() - m_start);
+
+    if (m_format == TELEMETRY_CSV) {
+        write_line(fmt::format(
+            "{},{:.2f},{:.2f},{:.2f},{:.2f},{:.2f},{:.2f},{:.2f},{},{},{},{},{},"
+            "{},{},{:.1f},{}",
+            time, sample.host_fps, sample.received_fps, sample.decoded_fps,
+            sample.rendered_fps, sample.receive_time, sample.decode_time,
+            sample.render_time, sample.decoded_frames,
+            sample.network_dropped_frames, sample.queue_size,
+            sample.queue_reuses, sample.queue_drops, sample.rtt,
+            sample.rtt_variance, sample.av_offset, sample.connection_poor ? 1 : 0));
+    } else {
+        write_line(fmt::format(
+            "{{\"type\":\"sample\",\"time_ms\":{},\"host_fps\":{:.2f},"
+            "\"received_fps\":{:.2f},\"decoded_fps\":{:.2f},"
+            "\"rendered_fps\":{:.2f},\"receive_ms\":{:.2f},"
+            "\"decode_ms\":{:.2f},\"render_ms\":{:.2f},\"decoded_frames\":{},"
+            "\"network_dropped_frames\":{},\"queue_size\":{},"
+            "\"queue_reuses\":{},\"queue_drops\":{},\"rtt_ms\":{},"
+            "\"rtt_variance_ms\":{},\"av_offset_ms\":{:.1f},"
+            "\"connection_poor\":{}}}",
+            time, sample.host_fps, sample.received_fps, sample.decoded_fps,
+            sample.rendered_fps, sample.receive_time, sample.decode_time,
+            sample.render_time, sample.decoded_frames,
+            sample.network_dropped_frames, sample.queue_size,
+            sample.queue_reuses, sample.queue_drops, sample.rtt,
+            sample.rtt_variance, sample.av_offset,
+            sample.connection_poor ? "true" : "false"));
+    }
+
+    m_samples++;
+    m_decoded_fps_sum += sample.decoded_fps;
+    m_rendered_fps_sum += sample.rendered_fps;
+    if (sample.connection_poor)
+        m_poor_samples++;
+
+    if (sample.rtt > 0) {
+        m_rtt_samples++;
+        m_rtt_sum += sample.rtt;
+        m_rtt_min = std::min(m_rtt_min, sample.rtt);
+        m_rtt_max = std::max(m_rtt_max, sample.rtt);
+    }
+
+    m_last = sample;
+}
+
+void SessionTelemetry::event(const std::string& name,
+                             const std::string& details) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_format == TELEMETRY_OFF)
+        return;
+
+    uint32_t time = (uint32_t)(LiGetMillis() - m_start);
+
+    if (m_format == TELEMETRY_CSV) {
+        write_line(fmt::format("# event time_ms={} name={} {}", time, name,
+                               details));
+    } else {
+        write_line(fmt::format(
+            "{{\"type\":\"event\",\"time_ms\":{},\"name\":\"{}\","
+            "\"details\":\"{}\"}}",
+            time, json_escape(name), json_escape(details)));
+    }
+}
+
+void SessionTelemetry::finish(uint32_t time_to_first_frame,
+                              uint32_t reconnects) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_format == TELEMETRY_OFF)
+        return;
+
+    uint32_t duration = (uint32_t)(LiGetMillis() - m_start);
+    float decoded_fps = m_samples ? (float)(m_decoded_fps_sum / m_samples) : 0;
+    float rendered_fps = m_samples ? (float)(m_rendered_fps_sum / m_samples) : 0;
+    uint32_t rtt_avg = m_rtt_samples ? (uint32_t)(m_rtt_sum / m_rtt_samples) : 0;
+    uint32_t rtt_min = m_rtt_samples ? m_rtt_min : 0;
+
+    if (m_format == TELEMETRY_CSV) {
+        write_line(fmt::format(
+            "# summary duration_ms={} time_to_first_frame_ms={} samples={} "
+            "avg_decoded_fps={:.2f} avg_rendered_fps={:.2f} decoded_frames={} "
+            "network_dropped_frames={} queue_reuses={} queue_drops={} "
+            "rtt_min_ms={} rtt_avg_ms={} rtt_max_ms={} poor_connection_s={} "
+            "reconnects={}",
+            duration, time_to_first_frame, m_samples, decoded_fps,
+            rendered_fps, m_last.decoded_frames,
+            m_last.network_dropped_frames, m_last.queue_reuses,
+            m_last.queue_drops, rtt_min, rtt_avg, m_rtt_max, m_poor_samples,
+            reconnects));
+    } else {
+        write_line(fmt::format(
+            "{{\"type\":\"summary\",\"duration_ms\":{},"
+            "\"time_to_first_frame_ms\":{},\"samples\":{},"
+            "\"avg_decoded_fps\":{:.2f},\"avg_rendered_fps\":{:.2f},"
+            "\"decoded_frames\":{},\"network_dropped_frames\":{},"
+            "\"queue_reuses\":{},\"queue_drops\":{},\"rtt_min_ms\":{},"
+            "\"rtt_avg_ms\":{},\"rtt_max_ms\":{},\"poor_connection_s\":{},"
+            "\"reconnects\":{}}}",
+            duration, time_to_first_frame, m_samples, decoded_fps,
+            rendered_fps, m_last.decoded_frames,
+            m_last.network_dropped_frames, m_last.queue_reuses,
+            m_last.queue_drops, rtt_min, rtt_avg, m_rtt_max, m_poor_samples,
+            reconnects));
+    }
+
+    m_writer.close();
+    m_format = TELEMETRY_OFF;
+}
+
+void SessionTelemetry::cleanup_old_files() {
+    struct TelemetryFileInfo {
+        std::string path;
+        time_t mtime;
+    };
+
+    std::vector<TelemetryFileInfo> files;
+
+    DIR* dir = opendir(m_directory.c_str());
+    if (dir == nullptr)
+        return;
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        std::string filename(entry->d_name);
+        if (filename.rfind(TELEMETRY_FILE_PREFIX, 0) != 0)
+            continue;
+
+        std::string path = m_directory + "/" + filename;
+        struct stat file_stat;
+        if (stat(path.c_str(), &file_stat) == 0)
+            files.push_back({path, file_stat.st_mtime});
+    }
+    closedir(dir);
+
+    std::sort(files.begin(), files.end(),
+              [](const TelemetryFileInfo& a, const TelemetryFileInfo& b) {
+                  return a.mtime > b.mtime;
+              });
+
+    for (size_t i = max_files; i < files.size(); i++) {
+        if (remove(files[i].path.c_str()) == 0) {
+            brls::Logger::debug("SessionTelemetry: Removed {}", files[i].path);
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "BufferedFileWriter.hpp"
+#include "Settings.hpp"
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+struct TelemetryStream {
+    std::string address;
+    int app_id;
+    std::string codec;
+    int width;
+    int height;
+    int fps;
+    int bitrate;
+};
+
+struct TelemetrySample {
+    float host_fps;
+    float received_fps;
+    float decoded_fps;
+    float rendered_fps;
+
+    float receive_time;
+    float decode_time;
+    float render_time;
+
+    // Session totals
+    uint32_t decoded_frames;
+    uint32_t network_dropped_frames;
+    size_t queue_reuses;
+    size_t queue_drops;
+
+    size_t queue_size;
+    uint32_t rtt;          // 0 if not known yet
+    uint32_t rtt_variance;
+    float av_offset;
+    bool connection_poor;
+};
+
+// Writes one sample per second of streaming, plus events and a closing
+// summary, into a telemetry_*.csv / .jsonl file next to the logs.
+// CSV files keep events and the summary on '#' comment lines.
+// Files roll over at max_file_size, only the newest max_files are kept.
+class SessionTelemetry {
+  public:
+    bool begin(const std::string& directory, TelemetryFormat format,
+               const TelemetryStream& stream);
+    void finish(uint32_t time_to_first_frame, uint32_t reconnects);
+
+    [[nodiscard]] bool is_active() const;
+
+    // Called every frame, returns true once per sample interval
+    bool should_sample(uint64_t now);
+    void sample(const TelemetrySample& sample);
+
+    void event(const std::string& name, const std::string& details = "");
+
+  private:
+    bool open_file();
+    void write_line(const std::string& line);
+    void cleanup_old_files();
+
+    static constexpr int sample_interval_ms = 1000;
+    static constexpr size_t max_file_size = 16 * 1024 * 1024;
+    static constexpr size_t max_files = 10;
+
+    mutable std::mutex m_mutex;
+    BufferedFileWriter m_writer;
+    TelemetryFormat m_format = TELEMETRY_OFF;
+    std::string m_directory;
+    std::string m_file_prefix;
+    TelemetryStream m_stream;
+    int m_part = 0;
+    size_t m_written = 0;
+
+    uint64_t m_start = 0;
+    uint64_t m_last_sample = 0;
+
+    // For the summary
+    uint32_t m_samples = 0;
+    double m_decoded_fps_sum = 0;
+    double m_rendered_fps_sum = 0;
+    uint32_t m_rtt_samples = 0;
+    uint64_t m_rtt_sum = 0;
+    uint32_t m_rtt_min = UINT32_MAX;
+    uint32_t m_rtt_max = 0;
+    uint32_t m_poor_samples = 0;
+    TelemetrySample m_last = {};
+};
@@ -0,0 +1,64 @@
+#include "StartupTimeline.hpp"
+#include <Limelight.h>
+#include <borealis.hpp>
+
+void StartupTimeline::begin() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_steps.clear();
+    m_start = LiGetMillis();
+    m_is_complete = false;
+}
+
+void StartupTimeline::mark(const std::string& name) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_start == 0 || m_is_complete)
+        return;
+
+    uint32_t time = (uint32_t)(LiGetMillis() - m_start);
+    m_steps.push_back({name, time});
+    brls::Logger::info("Startup: +{} ms {}", time, name);
+}
+
+void StartupTimeline::complete(const std::string& name) {
+    mark(name);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_start == 0 || m_is_complete)
+        return;
+
+    m_is_complete = true;
+
+    std::string summary;
+    uint32_t previous = 0;
+    for (const auto& step : m_steps) {
+        summary += fmt::format("\n  {:>6} ms (+{:>5}) {}", step.time,
+                               step.time - previous, step.name);
+        previous = step.time;
+    }
+    brls::Logger::info("Startup: Time to first frame {} ms{}", previous,
+                       summary);
+}
+
+bool StartupTimeline::is_started() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_start != 0;
+}
+
+bool StartupTimeline::is_complete() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_is_complete;
+}
+
+std::vector<StartupTimeline::Step> StartupTimeline::steps() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_steps;
+}
+
+std::string StartupTimeline::status() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_steps.empty())
+        return "";
+
+    const auto& step = m_steps.back();
+    return fmt::format("{} ({} ms)", step.name, step.time);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Timestamps of every step between opening a stream and its first
+// presented frame. Steps are marked from the UI, Limelight and decoder
+// threads, each one is logged with its offset from begin().
+class StartupTimeline {
+  public:
+    struct Step {
+        std::string name;
+        uint32_t time; // ms since begin()
+    };
+
+    void begin();
+    void mark(const std::string& name);
+
+    // Marks the final step and logs the whole timeline
+    void complete(const std::string& name);
+
+    [[nodiscard]] bool is_started() const;
+    [[nodiscard]] bool is_complete() const;
+    [[nodiscard]] std::vector<Step> steps() const;
+
+    // Last step with its time, for the loading overlay
+    [[nodiscard]] std::string status() const;
+
+  private:
+    mutable std::mutex m_mutex;
+    std::vector<Step> m_steps;
+    uint64_t m_start = 0;
+    bool m_is_complete = false;
+};
@@ -1,10 +1,20 @@
 #include "WakeOnLanManager.hpp"
 #include "Data.hpp"
 #include "Settings.hpp"
+#include "http.h"
+#include <Limelight.h>
 #include <borealis.hpp>
 #include <cerrno>
 #include <cstring>
 
+#define WOL_PAYLOAD_SIZE 102
+#define WOL_BURST_COUNT 3
+#define WOL_BURST_INTERVAL_MS 100
+#define WOL_RESEND_INTERVAL_MS 5000
+#define WOL_PROBE_TIMEOUT_MS 300
+#define WOL_PROBE_INTERVAL_MS 500
+#define WOL_READY_TIMEOUT_MS 30000
+
 #if defined(__linux) || defined(__APPLE__) || defined(PLATFORM_SWITCH) || defined(__vita__)
 #define UNIX_SOCKS
 #include <arpa/inet.h>
@@ -12,6 +22,9 @@
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <unistd.h>
+#include <vector>
+#include "NetworkInterfaces.hpp"
 
 #elif defined(_WIN32)
 #define WIN32_SOCKS
@@ -40,93 +53,180 @@ static Data mac_string_to_bytes(std::string mac) {
     return Data((unsigned char*)str.c_str(), str.length()).hex_to_bytes();
 }
 
+// 6 bytes of FF, then 16 repetitions of the MAC address. Empty if the
+// host has no usable MAC address.
 static Data create_payload(const Host& host) {
-    Data payload;
+    Data mac_address = mac_string_to_bytes(host.mac);
+    if (mac_address.size() != 6)
+        return Data();
+
+    unsigned char payload[WOL_PAYLOAD_SIZE];
+    memset(payload, 0xFF, 6);
+    for (int i = 0; i < 16; i++)
+        memcpy(payload + 6 + i * 6, mac_address.bytes(), 6);
+    return Data(payload, sizeof(payload));
+}
+#endif
+
+#if defined(UNIX_SOCKS)
+// The IP or host name of the host, the port defaults to the GameStream
+// HTTP one
+static std::string host_ip(const Host& host, uint16_t* port) {
+    std::string ip;
+    *port = 47989;
+    if (!http_parse_address(host.address, &ip, port))
+        return host.address;
+    return ip;
+}
+
+struct PacketTarget {
+    uint32_t source; // Local address to send from, network byte order
+    std::vector<uint32_t> destinations;
+};
+
+// Every interface sends the limited broadcast and the directed broadcast
+// of its network. The host also gets the packets at its last known
+// address, in case a router in between forwards no broadcasts.
+static std::vector<PacketTarget> packet_targets(const Host& host) {
+    std::vector<PacketTarget> targets;
+
+    uint16_t port;
+    struct in_addr address = {};
+    bool valid =
+        inet_pton(AF_INET, host_ip(host, &port).c_str(), &address) == 1;
+    bool unicast_sent = false;
 
-    // 6 bytes of FF
-    uint8_t header = 0xFF;
-    for (int i = 0; i < 6; i++) {
-        payload = payload.append(Data(&header, 1));
+    for (const auto& interface : network_interfaces()) {
+        if (interface.address == 0)
+            continue;
+
+        PacketTarget target = {interface.address,
+                               {INADDR_BROADCAST, network_broadcast(interface)}};
+        if (valid && network_contains(interface, address.s_addr)) {
+            target.destinations.push_back(address.s_addr);
+            unicast_sent = true;
+        }
+        targets.push_back(target);
     }
 
-    // 16 repitiions of MAC address
-    Data mac_address = mac_string_to_bytes(host.mac);
-    for (int i = 0; i < 16; i++) {
-        payload = payload.append(mac_address);
+    // Routed hosts, or no interface could be listed
+    if (targets.empty() || (valid && !unicast_sent)) {
+        PacketTarget target = {INADDR_ANY, {}};
+        if (targets.empty())
+            target.destinations.push_back(INADDR_BROADCAST);
+        if (valid)
+            target.destinations.push_back(address.s_addr);
+        targets.push_back(target);
     }
-    return payload;
+    return targets;
 }
-#endif
 
-#if defined(UNIX_SOCKS)
-GSResult<bool> send_packet_unix(const Host& host, const Data& payload) {
-    struct sockaddr_in udpClient{}, udpServer{};
-    int broadcast = 1;
+static std::vector<uint16_t> packet_ports() {
+    std::vector<uint16_t> ports = {7, 9};
+    for (uint16_t port = 47998; port <= 48010; port++)
+        ports.push_back(port);
+    return ports;
+}
 
+static int open_broadcast_socket(uint32_t source, std::string* error) {
     int udpSocket = socket(AF_INET, SOCK_DGRAM, 0);
     if (udpSocket == -1) {
-        brls::Logger::error(
-            "WakeOnLanManager: An error was encountered creating "
-            "the UDP socket: '{}'",
-            strerror(errno));
-        return GSResult<bool>::failure(
-            "An error was encountered creating the UDP socket: " +
-            std::string(strerror(errno)));
+        *error = "An error was encountered creating the UDP socket: " +
+                 std::string(strerror(errno));
+        brls::Logger::error("WakeOnLanManager: {}", *error);
+        return -1;
     }
 
-    int setsock_result = setsockopt(udpSocket, SOL_SOCKET, SO_BROADCAST,
-                                    &broadcast, sizeof broadcast);
-    if (setsock_result == -1) {
-        brls::Logger::error(
-            "WakeOnLanManager: Failed to set socket options: '{}'",
-            strerror(errno));
-        return GSResult<bool>::failure("Failed to set socket options: " +
-                                       std::string(strerror(errno)));
+    int broadcast = 1;
+    if (setsockopt(udpSocket, SOL_SOCKET, SO_BROADCAST, &broadcast,
+                   sizeof broadcast) == -1) {
+        *error = "Failed to set socket options: " + std::string(strerror(errno));
+        brls::Logger::error("WakeOnLanManager: {}", *error);
+        close(udpSocket);
+        return -1;
     }
 
-    // Set parameters
+    // Bound to the interface's address, so its packets leave through it
+    struct sockaddr_in udpClient{};
     udpClient.sin_family = AF_INET;
-    udpClient.sin_addr.s_addr = INADDR_ANY;
+    udpClient.sin_addr.s_addr = source;
     udpClient.sin_port = 0;
-    // Bind socket
-    int bind_result =
-        bind(udpSocket, (struct sockaddr*)&udpClient, sizeof(udpClient));
-    if (bind_result == -1) {
-        brls::Logger::error("WakeOnLanManager: Failed to bind socket: '{}'",
-                            strerror(errno));
-        return GSResult<bool>::failure("Failed to bind socket: " +
-                                       std::string(strerror(errno)));
+    if (bind(udpSocket, (struct sockaddr*)&udpClient, sizeof(udpClient)) ==
+        -1) {
+        *error = "Failed to bind socket: " + std::string(strerror(errno));
+        brls::Logger::error("WakeOnLanManager: {}", *error);
+        close(udpSocket);
+        return -1;
     }
+    return udpSocket;
+}
 
-    // Set server end point (the broadcast addres)
-    udpServer.sin_family = AF_INET;
-#if defined(PLATFORM_SWITCH)
-    uint32_t ip, subnet_mask;
-    // Get the current IP address and subnet mask to calculate subnet broadcast address
-    nifmGetCurrentIpConfigInfo(&ip, &subnet_mask, nullptr, nullptr, nullptr);
-    udpServer.sin_addr.s_addr = ip | ~subnet_mask;
-#else
-    udpServer.sin_addr.s_addr = inet_addr(host.address.c_str());
-#endif
-    udpServer.sin_port = htons(9);
+// WOL_BURST_COUNT rounds of packets to every target and port, as one lost
+// datagram shouldn't leave the host asleep
+GSResult<bool> send_packet_unix(const Host& host, const Data& payload) {
+    auto targets = packet_targets(host);
+    auto ports = packet_ports();
 
-    brls::Logger::info("WakeOnLanManager: Sending magic packet to: '{}'",
-                    inet_ntoa(udpServer.sin_addr));
+    std::vector<std::pair<int, const PacketTarget*>> sockets;
+    std::string error;
+    for (const auto& target : targets) {
+        int udpSocket = open_broadcast_socket(target.source, &error);
+        if (udpSocket == -1)
+            continue;
+        sockets.push_back({udpSocket, &target});
 
-    // Send the packet
-    ssize_t result =
-        sendto(udpSocket, payload.bytes(), sizeof(unsigned char) * 102, 0,
-               (struct sockaddr*)&udpServer, sizeof(udpServer));
-    if (result == -1) {
-        brls::Logger::error(
-            "WakeOnLanManager: Failed to send magic packet to socket: '{}'",
-            strerror(errno));
-        return GSResult<bool>::failure(
-            "Failed to send magic packet to socket: " +
-            std::string(strerror(errno)));
+        std::string destinations;
+        for (uint32_t destination : target.destinations) {
+            struct in_addr address = {destination};
+            destinations += (destinations.empty() ? "" : ", ") +
+                            std::string(inet_ntoa(address));
+        }
+        brls::Logger::info("WakeOnLanManager: Sending magic packets to: '{}'",
+                           destinations);
+    }
+
+    int sent = 0;
+    for (int round = 0; round < WOL_BURST_COUNT; round++) {
+        if (round > 0)
+            usleep(WOL_BURST_INTERVAL_MS * 1000);
+
+        for (auto& [udpSocket, target] : sockets) {
+            for (uint32_t destination : target->destinations) {
+                struct sockaddr_in udpServer{};
+                udpServer.sin_family = AF_INET;
+                udpServer.sin_addr.s_addr = destination;
+
+                for (uint16_t port : ports) {
+                    udpServer.sin_port = htons(port);
+                    if (sendto(udpSocket, payload.bytes(), payload.size(), 0,
+                               (struct sockaddr*)&udpServer,
+                               sizeof(udpServer)) == -1) {
+                        error = "Failed to send magic packet to socket: " +
+                                std::string(strerror(errno));
+                    } else {
+                        sent++;
+                    }
+                }
+            }
+        }
+    }
+
+    for (auto& [udpSocket, target] : sockets)
+        close(udpSocket);
+
+    if (sent == 0) {
+        brls::Logger::error("WakeOnLanManager: {}", error);
+        return GSResult<bool>::failure(error);
     }
     return GSResult<bool>::success(true);
 }
+
+// Host names get probed at the IP they were last connected at
+static bool host_ready(const Host& host) {
+    uint16_t port;
+    std::string ip = http_connected_address(host_ip(host, &port));
+    return !network_probe({ip}, port, WOL_PROBE_TIMEOUT_MS).empty();
+}
 #elif defined(_WIN32)
 GSResult<bool> send_packet_win32(const Host& host, const Data& payload) {
     struct sockaddr_in udpClient, udpServer;
@@ -181,13 +281,51 @@ bool WakeOnLanManager::can_wake_up_host(const Host& host) {
 #endif
 }
 
+// Sends a burst, then waits for the host to accept connections on its
+// GameStream port. Another burst goes out every WOL_RESEND_INTERVAL_MS
+// in case the first ones got lost.
 GSResult<bool> WakeOnLanManager::wake_up_host(const Host& host) {
     Data payload = create_payload(host);
+    if (payload.size() != WOL_PAYLOAD_SIZE)
+        return GSResult<bool>::failure("Host has no MAC address");
 
 #if defined(UNIX_SOCKS)
-    return send_packet_unix(host, payload);
+    if (host_ready(host)) {
+        brls::Logger::info("WakeOnLanManager: {} is up already", host.address);
+        return GSResult<bool>::success(true);
+    }
+
+    uint64_t start = LiGetMillis();
+    uint64_t last_sent = 0;
+    while (LiGetMillis() - start < WOL_READY_TIMEOUT_MS) {
+        if (last_sent == 0 ||
+            LiGetMillis() - last_sent >= WOL_RESEND_INTERVAL_MS) {
+            auto result = send_packet_unix(host, payload);
+            if (!result.isSuccess())
+                return result;
+            last_sent = LiGetMillis();
+        }
+
+        uint64_t probe_start = LiGetMillis();
+        if (host_ready(host)) {
+            brls::Logger::info("WakeOnLanManager: {} ready after {} ms",
+                               host.address, LiGetMillis() - start);
+            return GSResult<bool>::success(true);
+        }
+
+        uint64_t probe_time = LiGetMillis() - probe_start;
+        if (probe_time < WOL_PROBE_INTERVAL_MS)
+            usleep((WOL_PROBE_INTERVAL_MS - probe_time) * 1000);
+    }
+
+    brls::Logger::error("WakeOnLanManager: {} not ready after {} ms",
+                        host.address, LiGetMillis() - start);
+    return GSResult<bool>::failure("Host didn't wake up");
 #elif defined(_WIN32)
-    return send_packet_win32(host, payload);
+    auto result = send_packet_win32(host, payload);
+    if (result.isSuccess())
+        Sleep(5000);
+    return result;
 #endif
 
     return GSResult<bool>::failure("Wake up host not supported...");
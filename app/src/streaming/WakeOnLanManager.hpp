@@ -7,6 +7,8 @@ struct Host;
 class WakeOnLanManager : public Singleton<WakeOnLanManager> {
   private:
     static bool can_wake_up_host(const Host& host);
+
+    // Blocks until the host accepts connections, half a minute at most
     static GSResult<bool> wake_up_host(const Host& host);
 
     friend class GameStreamClient;
@@ -160,6 +160,15 @@ void AudrenAudioRenderer::decode_and_play_sample(char* data, int length) {
 
 int AudrenAudioRenderer::capabilities() { return CAPABILITY_DIRECT_SUBMIT; }
 
+int AudrenAudioRenderer::queued_duration() {
+    if (!m_inited_driver || m_sample_rate == 0)
+        return 0;
+
+    size_t queued_samples = m_total_queued_samples -
+        audrvVoiceGetPlayedSampleCount(&m_driver, 0);
+    return (int)(queued_samples * 1000 / m_sample_rate);
+}
+
 ssize_t AudrenAudioRenderer::free_wavebuf_index() {
     for (int i = 0; i < BUFFER_COUNT; i++) {
         if (m_wavebufs[i].state == AudioDriverWaveBufState_Free ||
@@ -18,6 +18,7 @@ class AudrenAudioRenderer : public IAudioRenderer {
     void cleanup() override;
     void decode_and_play_sample(char* sample_data, int sample_length) override;
     int capabilities() override;
+    int queued_duration() override;
 
   private:
     ssize_t free_wavebuf_index();
@@ -0,0 +1,173 @@
+#include "CaptureAudioRenderer.hpp"
+#include <borealis.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+#define WAV_HEADER_SIZE 44
+
+static std::string capture_file_path(const std::string& directory,
+                                     const std::string& extension) {
+    auto now = std::chrono::system_clock::now();
+    auto time_t = std::chrono::system_clock::to_time_t(now);
+    auto tm = *std::localtime(&time_t);
+
+    std::ostringstream oss;
+    oss << directory << "/audio_" << std::put_time(&tm, "%Y-%m-%d_%H-%M-%S")
+        << extension;
+    return oss.str();
+}
+
+CaptureAudioRenderer::CaptureAudioRenderer(IAudioRenderer* renderer,
+                                           const std::string& directory,
+                                           bool capture_pcm)
+    : m_renderer(renderer), m_directory(directory),
+      m_capture_pcm(capture_pcm) {}
+
+CaptureAudioRenderer::~CaptureAudioRenderer() {
+    cleanup();
+    delete m_renderer;
+}
+
+int CaptureAudioRenderer::init(
+    int audio_configuration, const POPUS_MULTISTREAM_CONFIGURATION opus_config,
+    void* context, int ar_flags) {
+    m_channel_count = opus_config->channelCount;
+    m_sample_rate = opus_config->sampleRate;
+    m_samples_per_frame = opus_config->samplesPerFrame;
+    m_pcm_size = 0;
+    m_start_timestamp = LiGetMillis();
+    m_is_initialized = true;
+
+    if (m_opus_writer.open(capture_file_path(m_directory, ".opuscap"))) {
+        int32_t header[] = {
+            CAPTURE_OPUS_VERSION,       opus_config->sampleRate,
+            opus_config->channelCount,  opus_config->streams,
+            opus_config->coupledStreams, opus_config->samplesPerFrame};
+        m_opus_writer.write({{CAPTURE_OPUS_MAGIC, 4},
+                             {header, sizeof(header)},
+                             {opus_config->mapping,
+                              sizeof(opus_config->mapping)}});
+        brls::Logger::info("CaptureAudioRenderer: Recording opus to {}",
+                           m_opus_writer.path());
+    }
+
+    if (m_capture_pcm) {
+        int error = 0;
+        m_decoder = opus_multistream_decoder_create(
+            opus_config->sampleRate, opus_config->channelCount,
+            opus_config->streams, opus_config->coupledStreams,
+            opus_config->mapping, &error);
+        m_buffer = (short*)malloc(m_samples_per_frame * m_channel_count *
+                                  sizeof(short));
+
+        if (m_decoder && m_buffer &&
+            m_wav_writer.open(capture_file_path(m_directory, ".wav"))) {
+            // Sizes are unknown until cleanup(), the header is patched then
+            unsigned char placeholder[WAV_HEADER_SIZE] = {};
+            m_wav_writer.write(placeholder, sizeof(placeholder));
+            brls::Logger::info("CaptureAudioRenderer: Recording pcm to {}",
+                               m_wav_writer.path());
+        } else {
+            brls::Logger::error(
+                "CaptureAudioRenderer: Failed to setup pcm capture: {}", error);
+        }
+    }
+
+    return m_renderer ? m_renderer->init(audio_configuration, opus_config,
+                                         context, ar_flags)
+                      : DR_OK;
+}
+
+void CaptureAudioRenderer::start() {
+    if (m_renderer)
+        m_renderer->start();
+}
+
+void CaptureAudioRenderer::stop() {
+    if (m_renderer)
+        m_renderer->stop();
+}
+
+void CaptureAudioRenderer::cleanup() {
+    // Also called from the destructor, the wrapped renderer
+    // must only see one cleanup() per init()
+    if (m_renderer && m_is_initialized)
+        m_renderer->cleanup();
+    m_is_initialized = false;
+
+    m_opus_writer.close();
+    m_wav_writer.close(
+        [this](FILE* file) { write_wav_header(file, m_pcm_size); });
+
+    if (m_decoder) {
+        opus_multistream_decoder_destroy(m_decoder);
+        m_decoder = nullptr;
+    }
+
+    if (m_buffer) {
+        free(m_buffer);
+        m_buffer = nullptr;
+    }
+}
+
+void CaptureAudioRenderer::decode_and_play_sample(char* sample_data,
+                                                  int sample_length) {
+    if (m_opus_writer.is_open() && sample_length > 0) {
+        uint32_t record[] = {(uint32_t)(LiGetMillis() - m_start_timestamp),
+                             (uint32_t)sample_length};
+        // Dropped as a whole when the disk falls behind, a record without
+        // its packet would throw off every one after it
+        m_opus_writer.write(
+            {{record, sizeof(record)}, {sample_data, (size_t)sample_length}});
+    }
+
+    if (m_decoder && m_wav_writer.is_open()) {
+        int decode_len = opus_multistream_decode(
+            m_decoder, (const unsigned char*)sample_data, sample_length,
+            m_buffer, m_samples_per_frame, 0);
+        if (decode_len > 0) {
+            uint32_t size = decode_len * m_channel_count * sizeof(short);
+            m_wav_writer.write(m_buffer, size);
+            m_pcm_size += size;
+        }
+    }
+
+    if (m_renderer)
+        m_renderer->decode_and_play_sample(sample_data, sample_length);
+}
+
+int CaptureAudioRenderer::capabilities() {
+    return m_renderer ? m_renderer->capabilities() : CAPABILITY_DIRECT_SUBMIT;
+}
+
+int CaptureAudioRenderer::queued_duration() {
+    return m_renderer ? m_renderer->queued_duration() : 0;
+}
+
+void CaptureAudioRenderer::write_wav_header(FILE* file, uint32_t data_size) {
+    uint16_t block_align = m_channel_count * sizeof(short);
+    uint32_t byte_rate = m_sample_rate * block_align;
+    uint32_t riff_size = data_size + WAV_HEADER_SIZE - 8;
+    uint32_t fmt_size = 16;
+    uint16_t format = 1; // PCM
+    uint16_t channels = m_channel_count;
+    uint32_t sample_rate = m_sample_rate;
+    uint16_t bits_per_sample = 16;
+
+    fseek(file, 0, SEEK_SET);
+    fwrite("RIFF", 1, 4, file);
+    fwrite(&riff_size, 4, 1, file);
+    fwrite("WAVEfmt ", 1, 8, file);
+    fwrite(&fmt_size, 4, 1, file);
+    fwrite(&format, 2, 1, file);
+    fwrite(&channels, 2, 1, file);
+    fwrite(&sample_rate, 4, 1, file);
+    fwrite(&byte_rate, 4, 1, file);
+    fwrite(&block_align, 2, 1, file);
+    fwrite(&bits_per_sample, 2, 1, file);
+    fwrite("data", 1, 4, file);
+    fwrite(&data_size, 4, 1, file);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "BufferedFileWriter.hpp"
+#include "IAudioRenderer.hpp"
+#include <opus/opus_multistream.h>
+#include <string>
+
+#define CAPTURE_OPUS_MAGIC "MLAC"
+#define CAPTURE_OPUS_VERSION 1
+
+// Wraps the real audio renderer and records everything that goes through it,
+// so audio issues can be reproduced offline.
+//
+// Opus capture (.opuscap) layout, native byte order:
+//   header: char magic[4], uint32 version, int32 sampleRate, channelCount,
+//           streams, coupledStreams, samplesPerFrame, uint8 mapping[8]
+//   record: uint32 timestamp_ms (since init), uint32 length, length bytes
+//
+// If capture_pcm is set, packets are also decoded into a 16-bit PCM .wav
+class CaptureAudioRenderer : public IAudioRenderer {
+  public:
+    CaptureAudioRenderer(IAudioRenderer* renderer, const std::string& directory,
+                         bool capture_pcm);
+    ~CaptureAudioRenderer() override;
+
+    int init(int audio_configuration,
+             const POPUS_MULTISTREAM_CONFIGURATION opus_config, void* context,
+             int ar_flags) override;
+    void start() override;
+    void stop() override;
+    void cleanup() override;
+    void decode_and_play_sample(char* sample_data, int sample_length) override;
+    int capabilities() override;
+    int queued_duration() override;
+
+  private:
+    void write_wav_header(FILE* file, uint32_t data_size);
+
+    IAudioRenderer* m_renderer = nullptr;
+    std::string m_directory;
+    bool m_capture_pcm = false;
+    bool m_is_initialized = false;
+
+    BufferedFileWriter m_opus_writer;
+    BufferedFileWriter m_wav_writer;
+
+    OpusMSDecoder* m_decoder = nullptr;
+    short* m_buffer = nullptr;
+    int m_channel_count = 0;
+    int m_sample_rate = 0;
+    int m_samples_per_frame = 0;
+    uint32_t m_pcm_size = 0;
+    uint64_t m_start_timestamp = 0;
+};
@@ -13,4 +13,7 @@ class IAudioRenderer {
     virtual void decode_and_play_sample(char* sample_data,
                                         int sample_length) = 0;
     virtual int capabilities() = 0;
+
+    // Milliseconds of decoded audio handed to the output but not played yet
+    virtual int queued_duration() { return 0; }
 };
@@ -36,6 +36,7 @@ int SDLAudioRenderer::init(int audio_configuration,
         &rc);
 
     channelCount = opus_config->channelCount;
+    sampleRate = opus_config->sampleRate;
 
     SDL_InitSubSystem(SDL_INIT_AUDIO);
 
@@ -109,3 +110,11 @@ void SDLAudioRenderer::decode_and_play_sample(char* sample_data,
 }
 
 int SDLAudioRenderer::capabilities() { return CAPABILITY_DIRECT_SUBMIT; }
+
+int SDLAudioRenderer::queued_duration() {
+    Uint32 bytes_per_second = sampleRate * channelCount * sizeof(short);
+    if (bytes_per_second == 0)
+        return 0;
+
+    return (int)((uint64_t)SDL_GetQueuedAudioSize(dev) * 1000 / bytes_per_second);
+}
@@ -21,10 +21,12 @@ class SDLAudioRenderer : public IAudioRenderer {
     void cleanup() override;
     void decode_and_play_sample(char* sample_data, int sample_length) override;
     int capabilities() override;
+    int queued_duration() override;
 
   private:
     OpusMSDecoder* decoder;
     short pcmBuffer[FRAME_SIZE * MAX_CHANNEL_COUNT];
     SDL_AudioDeviceID dev;
     int channelCount;
+    int sampleRate;
 };
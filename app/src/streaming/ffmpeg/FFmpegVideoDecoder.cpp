@@ -244,6 +244,26 @@ void FFmpegVideoDecoder::cleanup() {
     brls::Logger::info("FFmpeg: Cleanup done!");
 }
 
+bool FFmpegVideoDecoder::reset() {
+    if (m_decoder_context == nullptr)
+        return false;
+
+    brls::Logger::info("FFmpeg: Reusing decoder for the new connection");
+    avcodec_flush_buffers(m_decoder_context);
+
+    // Frame numbers start over with every connection
+    m_last_frame = 0;
+    m_frames_in = 0;
+    m_frames_out = 0;
+    timeCount = 0;
+    m_video_decode_stats_progress = {};
+
+    // Stale frames are dropped, the last shown one stays on screen. They
+    // aren't drops of the stream, so they stay out of the drop stat.
+    AVFrameHolder::instance().clear();
+    return true;
+}
+
 int FFmpegVideoDecoder::submit_decode_unit(PDECODE_UNIT decode_unit) {
     if (decode_unit->fullLength < DECODER_BUFFER_SIZE) {
         PLENTRY entry = decode_unit->bufferList;
@@ -343,8 +363,11 @@ int FFmpegVideoDecoder::submit_decode_unit(PDECODE_UNIT decode_unit) {
             }
 
             m_frame = get_frame(true);
-            if (m_frame != nullptr)
-                AVFrameHolder::instance().push(m_frame);
+            if (m_frame != nullptr) {
+                AVFrameHolder::instance().push(
+                    m_frame, {decode_unit->presentationTimeMs,
+                              decode_unit->receiveTimeMs});
+            }
         }
     } else {
         brls::Logger::error("FFmpeg: Big buffer to decode... 2");
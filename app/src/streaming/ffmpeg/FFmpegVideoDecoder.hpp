@@ -10,6 +10,7 @@ class FFmpegVideoDecoder : public IFFmpegVideoDecoder {
     int setup(int video_format, int width, int height, int redraw_rate,
               void* context, int dr_flags) override;
     void cleanup() override;
+    bool reset() override;
     int submit_decode_unit(PDECODE_UNIT decode_unit) override;
     int capabilities() const override;
     VideoDecodeStats* video_decode_stats() override;
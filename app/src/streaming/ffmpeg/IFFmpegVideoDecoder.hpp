@@ -40,6 +40,11 @@ class IFFmpegVideoDecoder {
     virtual void start(){};
     virtual void stop(){};
     virtual void cleanup() = 0;
+
+    // Prepares an already set up decoder for a new connection with the same
+    // stream parameters, returns false if it has to be set up from scratch
+    virtual bool reset() { return false; }
+
     virtual int submit_decode_unit(PDECODE_UNIT decode_unit) = 0;
     virtual int capabilities() const = 0;
     virtual VideoDecodeStats* video_decode_stats() = 0;
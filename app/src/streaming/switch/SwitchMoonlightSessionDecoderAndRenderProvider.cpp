@@ -2,6 +2,7 @@
 #include "FFmpegVideoDecoder.hpp"
 #include "Settings.hpp"
 #include "SDLAudiorenderer.hpp"
+#include "CaptureAudioRenderer.hpp"
 
 #ifdef PLATFORM_SWITCH
 #include "AudrenAudioRenderer.hpp"
@@ -33,8 +34,7 @@ SwitchMoonlightSessionDecoderAndRenderProvider::video_renderer() {
 #endif
 }
 
-IAudioRenderer*
-SwitchMoonlightSessionDecoderAndRenderProvider::audio_renderer() {
+static IAudioRenderer* make_audio_renderer() {
 #ifdef PLATFORM_SWITCH
     if (Settings::instance().audio_backend() == SDL) {
         return new SDLAudioRenderer();
@@ -45,3 +45,14 @@ SwitchMoonlightSessionDecoderAndRenderProvider::audio_renderer() {
     return new SDLAudioRenderer();
 #endif
 }
+
+IAudioRenderer*
+SwitchMoonlightSessionDecoderAndRenderProvider::audio_renderer() {
+    auto capture = Settings::instance().audio_capture();
+    if (capture != CAPTURE_OFF) {
+        return new CaptureAudioRenderer(make_audio_renderer(),
+                                        Settings::instance().capture_dir(),
+                                        capture == CAPTURE_OPUS_AND_WAV);
+    }
+    return make_audio_renderer();
+}
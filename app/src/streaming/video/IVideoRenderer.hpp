@@ -26,6 +26,10 @@ class IVideoRenderer {
                       AVFrame* frame, int imageFormat) = 0;
     virtual VideoRenderStats* video_render_stats() = 0;
 
+    // Builds GPU resources for the given AVPixelFormat ahead of the first
+    // frame, called on the render thread
+    virtual void prepare(int pixel_format) {}
+
     // Default implementations
     virtual int getDecoderColorspace() {
         // Rec 601 is default
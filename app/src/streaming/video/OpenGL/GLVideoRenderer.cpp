@@ -105,30 +105,45 @@ GLVideoRenderer::~GLVideoRenderer() {
     brls::Logger::info("GL: Cleanup...");
 #endif
 
+    release();
+
+#ifndef _WIN32
+    brls::Logger::info("GL: Cleanup done!");
+#endif
+}
+
+void GLVideoRenderer::release() {
     if (m_shader_program) {
         glDeleteProgram(m_shader_program);
+        m_shader_program = 0;
     }
 
     if (m_vbo) {
         glDeleteBuffers(1, &m_vbo);
+        m_vbo = 0;
     }
 
     if (m_vao) {
         glDeleteVertexArrays(1, &m_vao);
+        m_vao = 0;
     }
 
     for (int i = 0; i < currentFrameTypePlanesNum; i++) {
         if (m_texture_id[i]) {
             glDeleteTextures(1, &m_texture_id[i]);
+            m_texture_id[i] = 0;
         }
     }
 
-#ifndef _WIN32
-    brls::Logger::info("GL: Cleanup done!");
-#endif
+    // Forces textures and scale to be set up again
+    m_frame_width = 0;
+    m_frame_height = 0;
+    m_is_initialized = false;
+    m_pixel_format = -1;
 }
 
-void GLVideoRenderer::initialize(AVFrame* frame) {
+void GLVideoRenderer::initialize(int pixel_format) {
+    m_pixel_format = pixel_format;
     m_shader_program = glCreateProgram();
     GLuint vert = glCreateShader(GL_VERTEX_SHADER);
     GLuint frag = glCreateShader(GL_FRAGMENT_SHADER);
@@ -142,7 +157,7 @@ void GLVideoRenderer::initialize(AVFrame* frame) {
     glCompileShader(vert);
     check_shader(vert);
 
-    switch (frame->format) {
+    switch (pixel_format) {
         case AV_PIX_FMT_YUV420P:
             currentFrameTypePlanesNum = 3;
             currentPlanes = yuv420Planes;
@@ -171,7 +186,7 @@ void GLVideoRenderer::initialize(AVFrame* frame) {
                                : &fragment_two_planes_shader_string, nullptr);
             break;
         default:
-            brls::Logger::info("GL: Unknown frame format! - {}", frame->format);
+            brls::Logger::info("GL: Unknown frame format! - {}", pixel_format);
             m_is_initialized = false;
             return;
     }
@@ -215,8 +230,24 @@ void GLVideoRenderer::bindTexture(int id) {
     glUniform1i(m_texture_uniform[id], id);
 }
 
+void GLVideoRenderer::prepare(int pixel_format) {
+    if (m_is_initialized)
+        return;
+
+#ifndef _WIN32
+    brls::Logger::info("GL: Prepare for format: {}", pixel_format);
+#endif
+
+    m_is_initialized = true;
+    initialize(pixel_format);
+}
+
 void GLVideoRenderer::checkAndInitialize(int width, int height,
                                          AVFrame* frame) {
+    // Prepared for another format than the stream delivers
+    if (m_is_initialized && m_pixel_format != frame->format)
+        release();
+
     if (!m_is_initialized) {
 #ifndef _WIN32
 //        brls::Logger::info("GL: GL: {}, GLSL: {}", glGetString(GL_VERSION),
@@ -226,7 +257,7 @@ void GLVideoRenderer::checkAndInitialize(int width, int height,
 #endif
 
         m_is_initialized = true;
-        initialize(frame);
+        initialize(frame->format);
 
 #ifndef _WIN32
         brls::Logger::info("GL: Init done");
@@ -27,18 +27,21 @@ class GLVideoRenderer : public IVideoRenderer {
     void draw(NVGcontext* vg, int width, int height, AVFrame* frame, int imageFormat) override;
 
     VideoRenderStats* video_render_stats() override;
+    void prepare(int pixel_format) override;
 
   private:
     void bindTexture(int id);
-    void initialize(AVFrame* frame);
+    void initialize(int pixel_format);
+    void release();
     void checkAndInitialize(int width, int height, AVFrame* frame);
     void checkAndUpdateScale(int width, int height, AVFrame* frame);
 
     bool m_is_initialized = false;
+    int m_pixel_format = -1;
     GLuint m_texture_id[PLANES_NUM_MAX] = {0, 0, 0};
     GLint m_texture_uniform[PLANES_NUM_MAX];
-    GLuint m_shader_program;
-    GLuint m_vbo, m_vao;
+    GLuint m_shader_program = 0;
+    GLuint m_vbo = 0, m_vao = 0;
     int m_frame_width = 0;
     int m_frame_height = 0;
     int m_screen_width = 0;
@@ -11,6 +11,7 @@
 
 #include "streaming_view.hpp"
 #include "AVFrameHolder.hpp"
+#include "HostMonitor.hpp"
 #include "InputManager.hpp"
 #include "click_gesture_recognizer.hpp"
 #include "helper.hpp"
@@ -66,8 +67,23 @@ void overrideButtonsIfNeeded(bool value) {
 }
 
 StreamingView::StreamingView(const Host& host, const AppInfo& app) : host(host), app(app) {
+    setup();
+    startStream();
+}
+
+StreamingView::StreamingView(const std::string& replayFile, bool replayFast)
+    : host({"replay", replayFile}), app({replayFile, 0}),
+      replayFile(replayFile), replayFast(replayFast) {
+    setup();
+    startReplay();
+}
+
+void StreamingView::setup() {
     Application::getPlatform()->disableScreenDimming(true);
 
+    // Host polls would only compete with the stream
+    HostMonitor::instance().stop();
+
     setFocusable(true);
     setHideHighlight(true);
     loader = new LoadingOverlay(this);
@@ -79,31 +95,12 @@ StreamingView::StreamingView(const Host& host, const AppInfo& app) : host(host),
     addView(keyboardHolder);
 
     session = new MoonlightSession(host.address, app.app_id);
+    session->prewarm();
 
 #ifdef PLATFORM_TVOS
         updatePreferredDisplayMode(true);
 #endif
 
-    ASYNC_RETAIN
-    GameStreamClient::instance().connect(
-        host.address, [ASYNC_TOKEN](GSResult<SERVER_DATA> result) {
-            ASYNC_RELEASE
-            if (!result.isSuccess()) {
-                showError(result.error(), [this]() { terminate(false); });
-                return;
-            }
-
-            ASYNC_RETAIN
-            session->start([ASYNC_TOKEN](GSResult<bool> result) {
-                ASYNC_RELEASE
-
-                loader->setHidden(true);
-                if (!result.isSuccess()) {
-                    showError(result.error(), [this]() { terminate(false); });
-                }
-            }, result.value().isSunshine());
-        });
-
     MoonlightInputManager::instance().reloadButtonMappingLayout();
 
     static bool lMouseKeyGate = false;
@@ -233,6 +230,44 @@ StreamingView::StreamingView(const Host& host, const AppInfo& app) : host(host),
             });
 }
 
+void StreamingView::startStream() {
+    ASYNC_RETAIN
+    GameStreamClient::instance().connect(
+        host.address, [ASYNC_TOKEN](GSResult<SERVER_DATA> result) {
+            ASYNC_RELEASE
+            if (!result.isSuccess()) {
+                showError(result.error(), [this]() { terminate(false); });
+                return;
+            }
+
+            session->startup_timeline().mark("Host info received");
+
+            ASYNC_RETAIN
+            session->start([ASYNC_TOKEN](GSResult<bool> result) {
+                ASYNC_RELEASE
+
+                // On success the loader stays until the first frame is shown
+                if (!result.isSuccess()) {
+                    loader->setHidden(true);
+                    showError(result.error(), [this]() { terminate(false); });
+                }
+            }, result.value().isSunshine());
+        },
+        true, &requestToken);
+}
+
+void StreamingView::startReplay() {
+    if (session->start_replay(replayFile, replayFast))
+        return;
+
+    ASYNC_RETAIN
+    brls::sync([ASYNC_TOKEN] {
+        ASYNC_RELEASE
+        loader->setHidden(true);
+        showError("error/stream_start"_i18n, [this]() { terminate(false); });
+    });
+}
+
 void StreamingView::onFocusGained() {
     Box::onFocusGained();
 
@@ -288,24 +323,37 @@ void StreamingView::draw(NVGcontext* vg, float x, float y, float width,
 
     session->draw(vg, (int) width, (int) height);
 
+    if (!loader->isHidden()) {
+        if (session->startup_timeline().is_complete())
+            loader->setHidden(true);
+        else
+            loader->setStatus(session->startup_timeline().status());
+    }
+
     if (!tempInputLock && session->is_active())
         handleInput();
     handleOverlayCombo();
     handleMouseInputCombo();
 
-    if (session->connection_status_is_poor()) {
+    if (session->is_reconnecting() || session->connection_status_is_poor()) {
+        const char* status = "\uE140 Bad connection...";
+        if (session->is_changing_quality())
+            status = "\uE140 Adjusting quality...";
+        else if (session->is_reconnecting())
+            status = "\uE140 Reconnecting...";
+
         nvgFontSize(vg, 20);
         nvgTextAlign(vg, NVG_ALIGN_LEFT | NVG_ALIGN_MIDDLE);
 
         nvgFontBlur(vg, 3);
         nvgFillColor(vg, nvgRGBA(0, 0, 0, 255));
         nvgFontFaceId(vg, Application::getFont(FONT_REGULAR));
-        nvgText(vg, 50, height - 28, "\uE140 Bad connection...", nullptr);
+        nvgText(vg, 50, height - 28, status, nullptr);
 
         nvgFontBlur(vg, 0);
         nvgFillColor(vg, nvgRGBA(255, 255, 255, 255));
         nvgFontFaceId(vg, Application::getFont(FONT_REGULAR));
-        nvgText(vg, 50, height - 28, "\uE140 Bad connection...", nullptr);
+        nvgText(vg, 50, height - 28, status, nullptr);
     }
 
     if (session->use_hdr() != m_use_hdr) {
@@ -333,7 +381,8 @@ void StreamingView::draw(NVGcontext* vg, float x, float y, float width,
                                   "Average receive time: {:.{}f} | {:.{}f} ms\n"
                                   "Average decoding time: {:.{}f} | {:.{}f} ms\n"
                                   "Frame queue reuses | drops: {} | {}\n"
-                                  "Buffered frames: {}",
+                                  "Buffered frames: {}\n"
+                                  "A/V offset: {:.{}f} ms (video {:.{}f} | audio {:.{}f} ms)",
                                   stats->video_decode_stats.network_dropped_frames,
                                   stats->video_decode_stats.current_receive_time, 2,
                                   stats->video_decode_stats.session_receive_time, 2,
@@ -341,7 +390,46 @@ void StreamingView::draw(NVGcontext* vg, float x, float y, float width,
                                   stats->video_decode_stats.session_decoding_time, 2,
                                   AVFrameHolder::instance().getFakeFrameStat(),
                                   AVFrameHolder::instance().getFrameDropStat(),
-                                  AVFrameHolder::instance().getFrameQueueSize());
+                                  AVFrameHolder::instance().getFrameQueueSize(),
+                                  stats->av_sync_stats.av_offset, 1,
+                                  stats->av_sync_stats.video_latency, 1,
+                                  stats->av_sync_stats.audio_latency, 1);
+
+        if (stats->av_sync_stats.corrections > 0) {
+            statistics += fmt::format(" | corrections: {}",
+                                      stats->av_sync_stats.corrections);
+        }
+
+        if (stats->reconnect_stats.reconnects > 0) {
+            statistics += fmt::format("\nReconnects: {} (last {} ms, failed attempts {})",
+                                      stats->reconnect_stats.reconnects,
+                                      stats->reconnect_stats.last_reconnect_time,
+                                      stats->reconnect_stats.failed_attempts);
+        }
+
+        if (stats->link_probe.time != 0) {
+            statistics += fmt::format("\nLink: RTT {} ms, jitter {} ms, ~{} kbps, suggested {}x{} {} FPS {} kbps {}",
+                                      stats->link_probe.rtt,
+                                      stats->link_probe.jitter,
+                                      stats->link_probe.throughput,
+                                      stats->link_suggestion.tier.width,
+                                      stats->link_suggestion.tier.height,
+                                      stats->link_suggestion.tier.fps,
+                                      stats->link_suggestion.tier.bitrate,
+                                      getVideoCodecName(stats->link_suggestion.codec));
+        }
+
+        if (stats->quality_stats.tiers > 0) {
+            statistics += fmt::format("\nQuality: {}x{} {} FPS {} kbps (tier {}/{}, down {} | up {})",
+                                      stats->quality_stats.current.width,
+                                      stats->quality_stats.current.height,
+                                      stats->quality_stats.current.fps,
+                                      stats->quality_stats.current.bitrate,
+                                      stats->quality_stats.tier + 1,
+                                      stats->quality_stats.tiers,
+                                      stats->quality_stats.downgrades,
+                                      stats->quality_stats.upgrades);
+        }
 
         nvgFontFaceId(vg, Application::getFont(FONT_REGULAR));
         nvgFontSize(vg, 20);
@@ -551,4 +639,6 @@ StreamingView::~StreamingView() {
         ->unsubscribe(keysSubscription);
     session->stop(false);
     delete session;
+
+    HostMonitor::instance().start();
 }
@@ -0,0 +1,266 @@
+#include "BoxArtFetcher.hpp"
+#include "BoxArtManager.hpp"
+#include "RequestExecutor.hpp"
+#include "http.h"
+#include <Limelight.h>
+#include <algorithm>
+#include <borealis.hpp>
+#include <chrono>
+#include <thread>
+
+// Transfers left without waiters get aborted, the loop ends within
+// poll_interval_ms
+BoxArtFetcher::~BoxArtFetcher() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.clear();
+        for (auto& [curl, transfer] : m_transfers)
+            transfer->waiters.clear();
+        m_delivering.clear();
+    }
+
+    if (m_worker.joinable())
+        m_worker.join();
+}
+
+void BoxArtFetcher::fetch(const std::string& address, int app_id,
+                          const void* owner, ServerCallback<bool>& callback) {
+    std::string url =
+        GameStreamClient::instance().app_boxart_url(address, app_id);
+    if (url.empty()) {
+        callback(GSResult<bool>::failure("Firstly call connect() & pair()..."));
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    remove_owner(owner);
+
+    Request request = {owner, app_id, url, false, m_next_id++, callback};
+
+    // The same boxart is on its way already
+    for (auto& [curl, transfer] : m_transfers) {
+        if (transfer->url == url) {
+            transfer->waiters.push_back(request);
+            return;
+        }
+    }
+
+    m_queue.push_back(request);
+    if (!m_running) {
+        // A loop that ran dry doesn't take m_mutex anymore, joining it
+        // here can't deadlock
+        if (m_worker.joinable())
+            m_worker.join();
+
+        // The loop lasts as long as the whole batch, it would hold up
+        // everything else queued on brls::async
+        m_running = true;
+        m_worker = std::thread([this] { run(); });
+    }
+}
+
+void BoxArtFetcher::prioritize(const void* owner) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& request : m_queue) {
+        if (request.owner == owner)
+            request.visible = true;
+    }
+}
+
+void BoxArtFetcher::cancel(const void* owner) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    remove_owner(owner);
+}
+
+// Callers hold m_mutex. A transfer left without waiters gets aborted by
+// the loop.
+void BoxArtFetcher::remove_owner(const void* owner) {
+    auto is_owner = [owner](const Request& request) {
+        return request.owner == owner;
+    };
+
+    m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(), is_owner),
+                  m_queue.end());
+    for (auto& [curl, transfer] : m_transfers) {
+        auto& waiters = transfer->waiters;
+        waiters.erase(std::remove_if(waiters.begin(), waiters.end(), is_owner),
+                      waiters.end());
+    }
+    m_delivering.erase(owner);
+}
+
+void BoxArtFetcher::run() {
+    CURLM* multi = curl_multi_init();
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS,
+                      (long)max_transfers);
+
+    Batch batch = {LiGetMillis(), 0, 0, 0, 0};
+    while (true) {
+        // Pairing, launching and quitting go first, new transfers wait
+        // until the host answered those
+        bool yielding =
+            RequestExecutor::instance().pending(REQUEST_PRIORITY_SESSION) > 0;
+        bool waiting;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            start_transfers(multi, &batch, yielding);
+            if (m_transfers.empty() && (m_queue.empty() || !yielding)) {
+                m_running = false;
+                break;
+            }
+            waiting = m_transfers.empty();
+        }
+
+        if (waiting) {
+            std::this_thread::sleep_for(
+                std::chrono::milliseconds(poll_interval_ms));
+            continue;
+        }
+
+        int running = 0;
+        curl_multi_perform(multi, &running);
+
+        int left;
+        while (CURLMsg* message = curl_multi_info_read(multi, &left)) {
+            if (message->msg == CURLMSG_DONE)
+                finish_transfer(multi, message->easy_handle,
+                                message->data.result, &batch);
+        }
+
+        // Wakes up early for socket activity, the timeout only bounds how
+        // long new and cancelled requests wait
+        if (running > 0)
+            curl_multi_wait(multi, nullptr, 0, poll_interval_ms, nullptr);
+    }
+    curl_multi_cleanup(multi);
+
+    uint64_t elapsed = std::max<uint64_t>(LiGetMillis() - batch.start, 1);
+    brls::Logger::info(
+        "BoxArtFetcher: {} fetched, {} failed, {} cancelled, {} KB in {} ms, "
+        "{} kbps",
+        batch.fetched, batch.failed, batch.cancelled, batch.bytes / 1024,
+        elapsed, batch.bytes * 8 / elapsed);
+}
+
+// Callers hold m_mutex
+void BoxArtFetcher::start_transfers(CURLM* multi, Batch* batch,
+                                    bool yielding) {
+    for (auto it = m_transfers.begin(); it != m_transfers.end();) {
+        if (!it->second->waiters.empty()) {
+            ++it;
+            continue;
+        }
+
+        curl_multi_remove_handle(multi, it->first);
+        http_release_handle(it->second->url, it->first,
+                            CURLE_ABORTED_BY_CALLBACK);
+        batch->cancelled++;
+        it = m_transfers.erase(it);
+    }
+
+    while (!yielding && m_transfers.size() < max_transfers &&
+           !m_queue.empty()) {
+        auto next = std::min_element(
+            m_queue.begin(), m_queue.end(),
+            [](const Request& l, const Request& r) {
+                if (l.visible != r.visible)
+                    return l.visible;
+                return l.id < r.id;
+            });
+
+        auto transfer = std::make_unique<Transfer>();
+        transfer->app_id = next->app_id;
+        transfer->url = next->url;
+
+        // Every queued request for the same boxart shares the transfer
+        auto waiting = std::stable_partition(
+            m_queue.begin(), m_queue.end(),
+            [&transfer](const Request& request) {
+                return request.url != transfer->url;
+            });
+        transfer->waiters.assign(waiting, m_queue.end());
+        m_queue.erase(waiting, m_queue.end());
+
+        CURL* curl = http_acquire_handle(
+            transfer->url, HTTPRequestTimeoutMedium, &transfer->response);
+        if (!curl) {
+            batch->failed++;
+            deliver(std::move(transfer->waiters), transfer->app_id, Data(),
+                    "Failed to create a request");
+            continue;
+        }
+
+        curl_multi_add_handle(multi, curl);
+        m_transfers[curl] = std::move(transfer);
+    }
+}
+
+void BoxArtFetcher::finish_transfer(CURLM* multi, CURL* curl,
+                                    CURLcode result, Batch* batch) {
+    curl_multi_remove_handle(multi, curl);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_transfers.find(curl);
+    if (it == m_transfers.end())
+        return;
+
+    auto transfer = std::move(it->second);
+    m_transfers.erase(it);
+
+    // A handle that failed may hold a broken connection, it doesn't get kept
+    http_release_handle(transfer->url, curl, result);
+
+    std::string error;
+    if (result != CURLE_OK) {
+        error = curl_easy_strerror(result);
+    } else if (transfer->response.empty()) {
+        error = "Empty boxart";
+    }
+
+    if (error.empty()) {
+        batch->fetched++;
+        batch->bytes += transfer->response.size();
+    } else {
+        batch->failed++;
+        brls::Logger::error("BoxArtFetcher: App {}: {}", transfer->app_id,
+                            error);
+    }
+
+    deliver(std::move(transfer->waiters), transfer->app_id,
+            Data((char*)transfer->response.data(), transfer->response.size()),
+            error);
+}
+
+// Callers hold m_mutex
+void BoxArtFetcher::deliver(std::vector<Request> waiters, int app_id,
+                            Data data, const std::string& error) {
+    // Nobody waits anymore, but a finished download is still worth keeping
+    if (waiters.empty() && !error.empty())
+        return;
+
+    for (auto& request : waiters)
+        m_delivering[request.owner] = request.id;
+
+    brls::sync([this, waiters, app_id, data, error] {
+        if (error.empty())
+            BoxArtManager::instance().set_data(data, app_id);
+
+        for (auto& request : waiters) {
+            {
+                // Cancelled while the result was on its way
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto delivering = m_delivering.find(request.owner);
+                if (delivering == m_delivering.end() ||
+                    delivering->second != request.id)
+                    continue;
+                m_delivering.erase(delivering);
+            }
+
+            if (error.empty()) {
+                request.callback(GSResult<bool>::success(true));
+            } else {
+                request.callback(GSResult<bool>::failure(error));
+            }
+        }
+    });
+}
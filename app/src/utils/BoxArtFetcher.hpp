@@ -0,0 +1,81 @@
+#pragma once
+
+#include "GameStreamClient.hpp"
+#include "Singleton.hpp"
+#include <cstdint>
+#include <curl/curl.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Downloads boxart for the app grids. All requests go through a single
+// curl_multi loop on a thread of its own, a few transfers at a time over
+// the kept alive connections, instead of a thread and a handshake per cell.
+// Visible cells jump the queue, requests of cells that go away get
+// cancelled, in flight or not. No transfer starts while the
+// RequestExecutor has session requests, those go first. The loop ends
+// once the queue runs dry and logs the throughput of the batch it fetched.
+class BoxArtFetcher : public Singleton<BoxArtFetcher> {
+  public:
+    ~BoxArtFetcher();
+
+    // The boxart lands in BoxArtManager before the callback runs on the
+    // UI thread. An owner has one request at most, a new one replaces it.
+    void fetch(const std::string& address, int app_id, const void* owner,
+               ServerCallback<bool>& callback);
+
+    // The owner is on screen, serve it before the rest
+    void prioritize(const void* owner);
+
+    // Drops the owner's request, its callback won't be called
+    void cancel(const void* owner);
+
+  private:
+    struct Request {
+        const void* owner;
+        int app_id;
+        std::string url;
+        bool visible;
+        uint64_t id;
+        std::function<void(GSResult<bool>)> callback;
+    };
+
+    struct Transfer {
+        int app_id;
+        std::string url;
+        std::string response;
+        std::vector<Request> waiters;
+    };
+
+    struct Batch {
+        uint64_t start;
+        size_t bytes;
+        int fetched;
+        int failed;
+        int cancelled;
+    };
+
+    void run();
+    void start_transfers(CURLM* multi, Batch* batch, bool yielding);
+    void finish_transfer(CURLM* multi, CURL* curl, CURLcode result,
+                         Batch* batch);
+    void deliver(std::vector<Request> waiters, int app_id, Data data,
+                 const std::string& error);
+    void remove_owner(const void* owner);
+
+    static constexpr size_t max_transfers = 4;
+    static constexpr int poll_interval_ms = 100;
+
+    std::mutex m_mutex;
+    std::thread m_worker;
+    bool m_running = false;
+    uint64_t m_next_id = 0;
+    std::vector<Request> m_queue;
+    std::map<CURL*, std::unique_ptr<Transfer>> m_transfers;
+
+    // Finished requests on their way to the UI thread, by owner
+    std::map<const void*, uint64_t> m_delivering;
+};
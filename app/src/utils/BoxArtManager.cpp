@@ -20,7 +20,7 @@ bool BoxArtManager::has_boxart(int app_id) {
     return m_has_boxart[app_id];
 }
 
-void BoxArtManager::set_data(Data data, int app_id) {
+void BoxArtManager::set_data(const Data& data, int app_id) {
     std::lock_guard<std::mutex> guard(m_mutex);
 
     std::string path = Settings::instance().boxart_dir() + "/" +
@@ -67,7 +67,8 @@ void BoxArtManager::make_texture_from_boxart(NVGcontext* ctx, int app_id) {
         return;
     }
 
-    int handle = nvgCreateImageMem(ctx, 0, data.bytes(), (int)data.size());
+    int handle = nvgCreateImageMem(ctx, 0, (unsigned char*)data.bytes(),
+                                   (int)data.size());
 
     if (handle > 0) {
         m_texture_handle[app_id] = handle;
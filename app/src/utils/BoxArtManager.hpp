@@ -6,13 +6,13 @@
 #pragma once
 
 struct NVGcontext;
-struct Data;
+class Data;
 
 class BoxArtManager : public Singleton<BoxArtManager> {
   public:
     bool has_boxart(int app_id);
 
-    void set_data(Data data, int app_id);
+    void set_data(const Data& data, int app_id);
     static std::string get_texture_path(int app_id);
     void make_texture_from_boxart(NVGcontext* ctx, int app_id);
     int texture_id(int app_id);
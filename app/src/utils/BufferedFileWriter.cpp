@@ -0,0 +1,119 @@
+#include "BufferedFileWriter.hpp"
+#include <borealis.hpp>
+#include <chrono>
+#include <cstring>
+
+BufferedFileWriter::~BufferedFileWriter() { close(); }
+
+bool BufferedFileWriter::open(const std::string& path) {
+    close();
+
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file) {
+        brls::Logger::error("BufferedFileWriter: Failed to open {}", path);
+        return false;
+    }
+
+    m_path = path;
+    m_flushing.reserve(flush_threshold * 2);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_dropped_bytes = 0;
+        m_pending.clear();
+        m_pending.reserve(flush_threshold * 2);
+        m_running = true;
+    }
+    m_thread = std::thread([this] { loop(); });
+    return true;
+}
+
+void BufferedFileWriter::write(const void* bytes, size_t size) {
+    Chunk chunk = {bytes, size};
+    write(&chunk, 1);
+}
+
+void BufferedFileWriter::write(const Chunk* chunks, size_t count) {
+    size_t size = 0;
+    for (size_t i = 0; i < count; i++)
+        size += chunks[i].size;
+
+    if (size == 0)
+        return;
+
+    bool notify;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Writers on other threads may race close(), which clears this
+        // before the file goes away
+        if (!m_running)
+            return;
+
+        // Never let a stalled disk grow memory without a bound,
+        // losing capture data is better than losing the stream
+        if (m_pending.size() + size > max_pending_size) {
+            m_dropped_bytes += size;
+            return;
+        }
+
+        auto offset = m_pending.size();
+        m_pending.resize(offset + size);
+        for (size_t i = 0; i < count; i++) {
+            if (chunks[i].size > 0)
+                memcpy(m_pending.data() + offset, chunks[i].bytes,
+                       chunks[i].size);
+            offset += chunks[i].size;
+        }
+        notify = m_pending.size() >= flush_threshold;
+    }
+
+    if (notify)
+        m_condition.notify_one();
+}
+
+void BufferedFileWriter::loop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_condition.wait_for(
+            lock, std::chrono::milliseconds(flush_interval_ms), [this] {
+                return !m_running || m_pending.size() >= flush_threshold;
+            });
+
+        if (!m_pending.empty()) {
+            m_flushing.swap(m_pending);
+
+            lock.unlock();
+            fwrite(m_flushing.data(), 1, m_flushing.size(), m_file);
+            m_flushing.clear();
+            lock.lock();
+        }
+
+        if (!m_running && m_pending.empty())
+            break;
+    }
+}
+
+void BufferedFileWriter::close(const std::function<void(FILE*)>& finalize) {
+    if (!m_file)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_condition.notify_one();
+
+    if (m_thread.joinable())
+        m_thread.join();
+
+    if (finalize)
+        finalize(m_file);
+
+    if (m_dropped_bytes > 0) {
+        brls::Logger::warning("BufferedFileWriter: {} bytes dropped for {}",
+                              m_dropped_bytes, m_path);
+    }
+
+    std::fclose(m_file);
+    m_file = nullptr;
+}
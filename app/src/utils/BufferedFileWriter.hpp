@@ -0,0 +1,63 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Appends bytes to a file from a background thread, so callers sitting on
+// real-time paths (audio / video callbacks) never wait for the disk.
+// Data is double-buffered: write() only copies into the pending buffer,
+// the worker swaps it out and flushes it when it grows past
+// flush_threshold or every flush_interval_ms.
+class BufferedFileWriter {
+  public:
+    BufferedFileWriter() = default;
+    ~BufferedFileWriter();
+
+    BufferedFileWriter(const BufferedFileWriter&) = delete;
+    BufferedFileWriter& operator=(const BufferedFileWriter&) = delete;
+
+    struct Chunk {
+        const void* bytes;
+        size_t size;
+    };
+
+    bool open(const std::string& path);
+    void write(const void* bytes, size_t size);
+    // Keeps all chunks or, when too much is pending, drops all of them, so
+    // a record made of several never gets torn
+    void write(const Chunk* chunks, size_t count);
+    void write(std::initializer_list<Chunk> chunks) {
+        write(chunks.begin(), chunks.size());
+    }
+
+    // Flushes everything still pending, then lets the caller patch the file
+    // (e.g. a header with final sizes) before it gets closed.
+    void close(const std::function<void(FILE*)>& finalize = nullptr);
+
+    [[nodiscard]] bool is_open() const { return m_file != nullptr; }
+    [[nodiscard]] const std::string& path() const { return m_path; }
+    [[nodiscard]] size_t dropped_bytes() const { return m_dropped_bytes; }
+
+  private:
+    void loop();
+
+    static constexpr size_t flush_threshold = 64 * 1024;
+    static constexpr size_t max_pending_size = 8 * 1024 * 1024;
+    static constexpr int flush_interval_ms = 250;
+
+    std::string m_path;
+    FILE* m_file = nullptr;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::vector<unsigned char> m_pending;
+    std::vector<unsigned char> m_flushing;
+    bool m_running = false;
+    size_t m_dropped_bytes = 0;
+};
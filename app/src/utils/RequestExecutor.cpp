@@ -0,0 +1,131 @@
+#include "RequestExecutor.hpp"
+#include <Limelight.h>
+#include <algorithm>
+
+static const char* priority_name(RequestPriority priority) {
+    switch (priority) {
+    case REQUEST_PRIORITY_SESSION:
+        return "session";
+    case REQUEST_PRIORITY_SERVERINFO:
+        return "serverinfo";
+    case REQUEST_PRIORITY_APPLIST:
+        return "applist";
+    case REQUEST_PRIORITY_BOXART:
+        return "boxart";
+    default:
+        return "discovery";
+    }
+}
+
+RequestExecutor::RequestExecutor() {
+    for (size_t i = 0; i < worker_count; i++)
+        m_workers.emplace_back([this] { worker(); });
+}
+
+// Running requests finish first, none of them waits longer than its
+// HTTP timeouts
+RequestExecutor::~RequestExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        m_queue.clear();
+    }
+    m_condition.notify_all();
+
+    for (auto& worker : m_workers)
+        worker.join();
+}
+
+void RequestExecutor::enqueue(RequestPriority priority, const std::string& host,
+                              std::shared_ptr<std::atomic<bool>> cancelled,
+                              std::function<void()> run) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back({priority, host, cancelled, LiGetMillis(), run});
+    }
+    m_condition.notify_one();
+}
+
+size_t RequestExecutor::pending(RequestPriority priority) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_running[priority] +
+           std::count_if(m_queue.begin(), m_queue.end(),
+                         [priority](const Job& job) {
+                             return job.priority == priority;
+                         });
+}
+
+RequestQueueStats RequestExecutor::stats(RequestPriority priority) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats[priority];
+}
+
+// Callers hold m_mutex. The queue is in submission order, so the first
+// runnable job of the best priority is the oldest one.
+bool RequestExecutor::take_job(Job* job) {
+    m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(),
+                                 [this](const Job& queued) {
+                                     if (!queued.cancelled || !*queued.cancelled)
+                                         return false;
+                                     m_stats[queued.priority].cancelled++;
+                                     return true;
+                                 }),
+                  m_queue.end());
+
+    auto best = m_queue.end();
+    for (auto it = m_queue.begin(); it != m_queue.end(); ++it) {
+        auto running = m_running_per_host.find(it->host);
+        bool host_free = running == m_running_per_host.end() ||
+                         running->second < max_per_host;
+        if (host_free &&
+            (best == m_queue.end() || it->priority < best->priority))
+            best = it;
+    }
+
+    if (best == m_queue.end())
+        return false;
+
+    *job = std::move(*best);
+    m_queue.erase(best);
+    return true;
+}
+
+void RequestExecutor::worker() {
+    while (true) {
+        Job job;
+        uint64_t wait;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock,
+                             [this, &job] { return m_stopping || take_job(&job); });
+            if (m_stopping)
+                return;
+
+            wait = LiGetMillis() - job.enqueued_at;
+            auto& stats = m_stats[job.priority];
+            stats.requests++;
+            stats.total_wait_ms += wait;
+            stats.max_wait_ms = std::max(stats.max_wait_ms, wait);
+
+            m_running[job.priority]++;
+            m_running_per_host[job.host]++;
+        }
+
+        if (wait >= slow_wait_ms) {
+            brls::Logger::info("RequestExecutor: {} request for {} waited {} ms",
+                               priority_name(job.priority), job.host, wait);
+        }
+
+        job.run();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running[job.priority]--;
+            if (--m_running_per_host[job.host] == 0)
+                m_running_per_host.erase(job.host);
+        }
+
+        // A host got a slot back, a job held back for it may run now
+        m_condition.notify_all();
+    }
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "GameStreamClient.hpp"
+#include "Singleton.hpp"
+#include <atomic>
+#include <borealis.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Lower runs first
+enum RequestPriority {
+    REQUEST_PRIORITY_SESSION, // Pairing, launch and quit, the user waits
+    REQUEST_PRIORITY_SERVERINFO,
+    REQUEST_PRIORITY_APPLIST,
+    REQUEST_PRIORITY_BOXART,
+    REQUEST_PRIORITY_DISCOVERY, // Subnet probes, nobody waits for one host
+    REQUEST_PRIORITY_COUNT
+};
+
+// Cancels the requests made with it once it goes away, so views keep one
+// as a member. Queued requests get dropped, running ones don't call back.
+class RequestToken {
+  public:
+    RequestToken() : m_cancelled(std::make_shared<std::atomic<bool>>(false)) {}
+    ~RequestToken() { cancel(); }
+
+    RequestToken(const RequestToken&) = delete;
+    RequestToken& operator=(const RequestToken&) = delete;
+
+    void cancel() { *m_cancelled = true; }
+
+    [[nodiscard]] std::shared_ptr<std::atomic<bool>> state() const {
+        return m_cancelled;
+    }
+
+  private:
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+};
+
+struct RequestQueueStats {
+    uint32_t requests;
+    uint32_t cancelled;
+    uint64_t total_wait_ms;
+    uint64_t max_wait_ms;
+};
+
+// Runs GameStreamClient's requests on a few workers of its own. The most
+// urgent queued request goes first, but no host gets more than
+// max_per_host of them at once, so a slow host can't take all workers.
+// Callbacks run on the UI thread, unless their token got cancelled.
+class RequestExecutor : public Singleton<RequestExecutor> {
+  public:
+    RequestExecutor();
+    ~RequestExecutor();
+
+    static constexpr size_t worker_count = 4;
+
+    template <typename T>
+    void submit(RequestPriority priority, const std::string& host,
+                const RequestToken* token,
+                const std::function<GSResult<T>()>& work,
+                ServerCallback<T>& callback) {
+        auto cancelled = token ? token->state() : nullptr;
+        enqueue(priority, host, cancelled, [work, callback, cancelled] {
+            auto result = work();
+            brls::sync([callback, cancelled, result] {
+                if (!cancelled || !*cancelled)
+                    callback(result);
+            });
+        });
+    }
+
+    // Requests of the priority that are queued or running
+    [[nodiscard]] size_t pending(RequestPriority priority);
+
+    // How long requests of the priority waited for a worker
+    [[nodiscard]] RequestQueueStats stats(RequestPriority priority);
+
+  private:
+    struct Job {
+        RequestPriority priority;
+        std::string host;
+        std::shared_ptr<std::atomic<bool>> cancelled;
+        uint64_t enqueued_at;
+        std::function<void()> run;
+    };
+
+    void enqueue(RequestPriority priority, const std::string& host,
+                 std::shared_ptr<std::atomic<bool>> cancelled,
+                 std::function<void()> run);
+    void worker();
+    bool take_job(Job* job);
+
+    static constexpr int max_per_host = 2;
+    static constexpr uint64_t slow_wait_ms = 500;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::vector<Job> m_queue;
+    std::map<std::string, int> m_running_per_host;
+    size_t m_running[REQUEST_PRIORITY_COUNT] = {};
+    RequestQueueStats m_stats[REQUEST_PRIORITY_COUNT] = {};
+    std::vector<std::thread> m_workers;
+    bool m_stopping = false;
+};
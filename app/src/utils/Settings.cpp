@@ -63,6 +63,7 @@ void Settings::set_working_dir(const std::string& working_dir) {
     m_key_dir = working_dir + "/key";
     m_boxart_dir = working_dir + "/boxart";
     m_log_path = working_dir;
+    m_capture_dir = working_dir + "/capture";
     m_gamepad_mapping_path = working_dir + "/gamepad_mapping_v1.2.0.json";
     
     mkdirtree(m_working_dir.c_str());
@@ -70,6 +71,10 @@ void Settings::set_working_dir(const std::string& working_dir) {
     mkdirtree(m_boxart_dir.c_str());
     
     load();
+
+    if (m_audio_capture != CAPTURE_OFF || m_record_session) {
+        mkdirtree(m_capture_dir.c_str());
+    }
 }
 
 void Settings::add_host(const Host& host) {
@@ -282,7 +287,50 @@ void Settings::load() {
             if (json_t* write_log = json_object_get(settings, "write_log")) {
                 m_write_log = json_typeof(write_log) == JSON_TRUE;
             }
+
+            if (json_t* audio_capture = json_object_get(settings, "audio_capture")) {
+                if (json_typeof(audio_capture) == JSON_INTEGER) {
+                    m_audio_capture = (AudioCaptureMode)json_integer_value(audio_capture);
+                }
+            }
+
+            if (json_t* capture_dir = json_object_get(settings, "capture_dir")) {
+                if (json_typeof(capture_dir) == JSON_STRING) {
+                    m_capture_dir = json_string_value(capture_dir);
+                }
+            }
             
+            if (json_t* telemetry = json_object_get(settings, "telemetry")) {
+                if (json_typeof(telemetry) == JSON_INTEGER) {
+                    m_telemetry = (TelemetryFormat)json_integer_value(telemetry);
+                }
+            }
+
+            if (json_t* record_session = json_object_get(settings, "record_session")) {
+                m_record_session = json_typeof(record_session) == JSON_TRUE;
+            }
+
+            if (json_t* av_sync_correction = json_object_get(settings, "av_sync_correction")) {
+                m_av_sync_correction = json_typeof(av_sync_correction) == JSON_TRUE;
+            }
+
+            if (json_t* av_sync_target = json_object_get(settings, "av_sync_target")) {
+                if (json_typeof(av_sync_target) == JSON_INTEGER) {
+                    m_av_sync_target = (int)json_integer_value(av_sync_target);
+                    if (m_av_sync_target < 1) m_av_sync_target = 1;
+                }
+            }
+
+            if (json_t* adaptive_quality = json_object_get(settings, "adaptive_quality")) {
+                m_adaptive_quality = json_typeof(adaptive_quality) == JSON_TRUE;
+            }
+
+            if (json_t* link_probe = json_object_get(settings, "link_probe")) {
+                if (json_typeof(link_probe) == JSON_INTEGER) {
+                    m_link_probe = (LinkProbeMode)json_integer_value(link_probe);
+                }
+            }
+
             if (json_t* swap_ui_keys = json_object_get(settings, "swap_ui_keys")) {
                 m_swap_ui_keys = json_typeof(swap_ui_keys) == JSON_TRUE;
             }
@@ -494,6 +542,14 @@ void Settings::save() {
             json_object_set_new(settings, "sops", m_sops ? json_true() : json_false());
             json_object_set_new(settings, "play_audio", m_play_audio ? json_true() : json_false());
             json_object_set_new(settings, "write_log", m_write_log ? json_true() : json_false());
+            json_object_set_new(settings, "audio_capture", json_integer(m_audio_capture));
+            json_object_set_new(settings, "capture_dir", json_string(m_capture_dir.c_str()));
+            json_object_set_new(settings, "telemetry", json_integer(m_telemetry));
+            json_object_set_new(settings, "record_session", m_record_session ? json_true() : json_false());
+            json_object_set_new(settings, "av_sync_correction", m_av_sync_correction ? json_true() : json_false());
+            json_object_set_new(settings, "av_sync_target", json_integer(m_av_sync_target));
+            json_object_set_new(settings, "adaptive_quality", m_adaptive_quality ? json_true() : json_false());
+            json_object_set_new(settings, "link_probe", json_integer(m_link_probe));
             json_object_set_new(settings, "swap_ui_keys", m_swap_ui_keys ? json_true() : json_false());
             json_object_set_new(settings, "swap_joycon_stick_to_dpad", m_swap_joycon_stick_to_dpad ? json_true() : json_false());
             json_object_set_new(settings, "touchscreen_mouse_mode", m_touchscreen_mouse_mode ? json_true() : json_false());
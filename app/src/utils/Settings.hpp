@@ -20,6 +20,12 @@ enum AudioBackend : int {
 
 enum KeyboardType : int { COMPACT, FULLSIZED };
 
+enum AudioCaptureMode : int { CAPTURE_OFF, CAPTURE_OPUS, CAPTURE_OPUS_AND_WAV };
+
+enum TelemetryFormat : int { TELEMETRY_OFF, TELEMETRY_CSV, TELEMETRY_JSON };
+
+enum LinkProbeMode : int { LINK_PROBE_OFF, LINK_PROBE_SUGGEST, LINK_PROBE_APPLY };
+
 enum class ButtonOverrideType : int { NONE, SCREENSHOT, HOME };
 
 struct KeyMappingLayout {
@@ -49,12 +55,16 @@ class Settings : public Singleton<Settings> {
   public:
     void set_working_dir(const std::string& working_dir);
 
+    [[nodiscard]] std::string working_dir() const { return m_working_dir; }
+
     [[nodiscard]] std::string key_dir() const { return m_key_dir; }
 
     [[nodiscard]] std::string boxart_dir() const { return m_boxart_dir; }
 
     [[nodiscard]] std::string log_dir() const { return m_log_path; }
 
+    [[nodiscard]] std::string capture_dir() const { return m_capture_dir; }
+
     [[nodiscard]] std::string gamepad_mapping_path() const { return m_gamepad_mapping_path; }
 
     [[nodiscard]] std::vector<Host> hosts() const { return m_hosts; }
@@ -107,6 +117,27 @@ class Settings : public Singleton<Settings> {
     void set_write_log(bool write_log) { m_write_log = write_log; }
     [[nodiscard]] bool write_log() const { return m_write_log; }
 
+    void set_audio_capture(AudioCaptureMode audio_capture) { m_audio_capture = audio_capture; }
+    [[nodiscard]] AudioCaptureMode audio_capture() const { return m_audio_capture; }
+
+    void set_telemetry(TelemetryFormat telemetry) { m_telemetry = telemetry; }
+    [[nodiscard]] TelemetryFormat telemetry() const { return m_telemetry; }
+
+    void set_record_session(bool record_session) { m_record_session = record_session; }
+    [[nodiscard]] bool record_session() const { return m_record_session; }
+
+    void set_av_sync_correction(bool av_sync_correction) { m_av_sync_correction = av_sync_correction; }
+    [[nodiscard]] bool av_sync_correction() const { return m_av_sync_correction; }
+
+    void set_av_sync_target(int av_sync_target) { m_av_sync_target = av_sync_target; }
+    [[nodiscard]] int av_sync_target() const { return m_av_sync_target; }
+
+    void set_adaptive_quality(bool adaptive_quality) { m_adaptive_quality = adaptive_quality; }
+    [[nodiscard]] bool adaptive_quality() const { return m_adaptive_quality; }
+
+    void set_link_probe(LinkProbeMode link_probe) { m_link_probe = link_probe; }
+    [[nodiscard]] LinkProbeMode link_probe() const { return m_link_probe; }
+
     void set_swap_ui_keys(bool swap_ui_keys) { m_swap_ui_keys = swap_ui_keys; }
     [[nodiscard]] bool swap_ui_keys() const { return m_swap_ui_keys; }
 
@@ -178,6 +209,7 @@ class Settings : public Singleton<Settings> {
     std::string m_key_dir;
     std::string m_boxart_dir;
     std::string m_log_path;
+    std::string m_capture_dir;
     std::string m_gamepad_mapping_path;
 
     std::vector<Host> m_hosts;
@@ -192,6 +224,13 @@ class Settings : public Singleton<Settings> {
     bool m_sops = true;
     bool m_play_audio = false;
     bool m_write_log = false;
+    AudioCaptureMode m_audio_capture = CAPTURE_OFF;
+    TelemetryFormat m_telemetry = TELEMETRY_OFF;
+    bool m_record_session = false;
+    bool m_av_sync_correction = false;
+    int m_av_sync_target = 40;
+    bool m_adaptive_quality = false;
+    LinkProbeMode m_link_probe = LINK_PROBE_OFF;
     bool m_swap_ui_keys = false;
     bool m_swap_joycon_stick_to_dpad = false;
     bool m_touchscreen_mouse_mode = false;
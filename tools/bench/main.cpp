@@ -0,0 +1,408 @@
+//
+//  Microbenchmarks for the hot paths of libgamestream, Data and the crypto
+//  managers, built on Google Benchmark.
+//
+//  moonlight_bench [--benchmark_filter=REGEX] [--keys=DIR]
+//    --keys=DIR   Where the client certificates for the crypto benchmarks
+//                 are generated, default bench_keys
+//
+//  Baselines are Google Benchmark JSON files:
+//    moonlight_bench --benchmark_out=before.json --benchmark_out_format=json
+//  and two of them compare with tools/compare.py from Google Benchmark.
+//
+//  The crypto benchmarks run once per backend that got built in, named
+//  after the manager class. Their pair benchmark also counts the
+//  allocations of one pairing.
+//
+
+#include "errors.h"
+#include "payloads.hpp"
+#include "xml.h"
+#include "Settings.hpp"
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#ifdef USE_OPENSSL_CRYPTO
+#include "OpenSSLCryptoManager.hpp"
+#endif
+#ifdef USE_MBEDTLS_CRYPTO
+#include "MbedTLSCryptoManager.hpp"
+#endif
+
+// libgamestream's error reporting lives in client.cpp, which needs far
+// more than the parts benchmarked here
+static std::string last_error;
+void gs_set_error(std::string error) { last_error = error; }
+std::string gs_error() { return last_error; }
+
+// Everything going through operator new counts: Data buffers, strings and
+// the XML fields. The crypto libraries malloc on their own and don't.
+static std::atomic<size_t> allocations(0);
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = malloc(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t) noexcept { free(memory); }
+
+static Data payload(const char* xml) { return Data((char*)xml, strlen(xml)); }
+
+static Data make_applist(int apps) {
+    std::string xml = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+                      "<root status_code=\"200\">";
+    for (int i = 0; i < apps; i++) {
+        xml += "<App><IsHdrSupported>" + std::to_string(i % 3 == 0) +
+               "</IsHdrSupported><AppTitle>Game Title Number " +
+               std::to_string(i) + " &amp; Friends</AppTitle><ID>" +
+               std::to_string(100000 + i) + "</ID></App>";
+    }
+    xml += "</root>";
+    return Data((char*)xml.data(), xml.size());
+}
+
+// XML
+
+static void BM_xml_status(benchmark::State& state) {
+    Data data = payload(gfe_serverinfo);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(xml_status(data));
+}
+BENCHMARK(BM_xml_status);
+
+static void BM_xml_search(benchmark::State& state) {
+    Data data = payload(gfe_serverinfo);
+    std::string value;
+    for (auto _ : state) {
+        xml_search(data, "appversion", &value);
+        benchmark::DoNotOptimize(value);
+    }
+}
+BENCHMARK(BM_xml_search);
+
+static void BM_xml_extract_serverinfo(benchmark::State& state) {
+    Data data = payload(gfe_serverinfo);
+    std::string current_game, paired, version, server_state, gpu, gs_version,
+        hostname, gfe_version, mac;
+    int codecs, https_port;
+    xml_field fields[] = {
+        {"currentgame", XML_FIELD_STRING, &current_game, true},
+        {"PairStatus", XML_FIELD_STRING, &paired, true},
+        {"appversion", XML_FIELD_STRING, &version, true},
+        {"state", XML_FIELD_STRING, &server_state, true},
+        {"ServerCodecModeSupport", XML_FIELD_INT, &codecs, false},
+        {"gputype", XML_FIELD_STRING, &gpu, false},
+        {"GsVersion", XML_FIELD_STRING, &gs_version, false},
+        {"hostname", XML_FIELD_STRING, &hostname, false},
+        {"GfeVersion", XML_FIELD_STRING, &gfe_version, false},
+        {"HttpsPort", XML_FIELD_INT, &https_port, false},
+        {"mac", XML_FIELD_STRING, &mac, false},
+    };
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(
+            xml_extract(data, fields, sizeof(fields) / sizeof(*fields)));
+}
+BENCHMARK(BM_xml_extract_serverinfo);
+
+static void BM_xml_applist_sunshine(benchmark::State& state) {
+    Data data = payload(sunshine_applist);
+    for (auto _ : state) {
+        AppInfoList list;
+        benchmark::DoNotOptimize(xml_applist(data, &list));
+    }
+}
+BENCHMARK(BM_xml_applist_sunshine);
+
+static void BM_xml_applist_gfe(benchmark::State& state) {
+    Data data = payload(gfe_applist);
+    for (auto _ : state) {
+        AppInfoList list;
+        benchmark::DoNotOptimize(xml_applist(data, &list));
+    }
+}
+BENCHMARK(BM_xml_applist_gfe);
+
+static void BM_xml_applist_library(benchmark::State& state) {
+    Data data = make_applist((int)state.range(0));
+    for (auto _ : state) {
+        AppInfoList list;
+        benchmark::DoNotOptimize(xml_applist(data, &list));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_xml_applist_library)->Arg(100)->Arg(1000)->Arg(5000);
+
+// Data, sizes of a pairing salt, an AES block run and a hex certificate
+
+static void BM_Data_hex(benchmark::State& state) {
+    Data data = Data::random_bytes(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(data.hex());
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Data_hex)->Arg(16)->Arg(256)->Arg(1200);
+
+static void BM_Data_hex_to_bytes(benchmark::State& state) {
+    Data hex = Data::random_bytes(state.range(0)).hex();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(hex.hex_to_bytes());
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Data_hex_to_bytes)->Arg(16)->Arg(256)->Arg(1200);
+
+static void BM_Data_append(benchmark::State& state) {
+    Data head = Data::random_bytes(16);
+    Data tail = Data::random_bytes(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(head.append(tail));
+}
+BENCHMARK(BM_Data_append)->Arg(16)->Arg(256)->Arg(1200);
+
+// Crypto, what a pairing runs through
+
+template <class Crypto> static void BM_SHA1(benchmark::State& state) {
+    Data data = Data::random_bytes(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Crypto::SHA1_hash_data(data));
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+template <class Crypto> static void BM_SHA256(benchmark::State& state) {
+    Data data = Data::random_bytes(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Crypto::SHA256_hash_data(data));
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+template <class Crypto> static void BM_aes_key(benchmark::State& state) {
+    Data salted_pin = Data::random_bytes(16).append(Data((char*)"1234", 4));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(
+            Crypto::create_AES_key_from_salt_SHA256(salted_pin));
+}
+
+template <class Crypto> static void BM_aes_encrypt(benchmark::State& state) {
+    Data key = Data::random_bytes(16);
+    Data data = Data::random_bytes(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Crypto::aes_encrypt(data, key));
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+template <class Crypto> static void BM_aes_decrypt(benchmark::State& state) {
+    Data key = Data::random_bytes(16);
+    Data data = Crypto::aes_encrypt(Data::random_bytes(state.range(0)), key);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Crypto::aes_decrypt(data, key));
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+template <class Crypto> static void BM_signature(benchmark::State& state) {
+    Data cert = Crypto::cert_data();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Crypto::signature(cert));
+}
+
+template <class Crypto> static void BM_sign_data(benchmark::State& state) {
+    Data data = Data::random_bytes(16);
+    Data key = Crypto::key_data();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Crypto::sign_data(data, key));
+}
+
+template <class Crypto>
+static void BM_verify_signature(benchmark::State& state) {
+    Data data = Data::random_bytes(16);
+    Data cert = Crypto::cert_data();
+    Data signature = Crypto::sign_data(data, Crypto::key_data());
+    for (auto _ : state)
+        benchmark::DoNotOptimize(
+            Crypto::verify_signature(data, signature, cert));
+}
+
+// Pairing, gs_pair in client.cpp between its requests. The host answers
+// from memory and has our own certificate.
+
+static Data pair_answer(const char* node, const Data& value) {
+    std::string xml = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+                      "<root status_code=\"200\"><paired>1</paired>";
+    if (node) {
+        xml += std::string("<") + node + ">" + (const char*)value.bytes() +
+               "</" + node + ">";
+    }
+    xml += "</root>";
+    return Data(xml.data(), xml.size());
+}
+
+static void pair_validate(const Data& answer, const char* node,
+                          std::string* value) {
+    std::string paired;
+    xml_field fields[] = {
+        {"paired", XML_FIELD_STRING, &paired, false},
+        {node, XML_FIELD_STRING, value, true},
+    };
+    xml_extract(answer, fields, node ? 2 : 1);
+}
+
+template <class Crypto> static void BM_pair(benchmark::State& state) {
+    const char* pin = "1234";
+    const char* unique_id = "0123456789ABCDEF";
+    char url[4096];
+
+    Data server_secret = Data::random_bytes(16);
+    Data plaincert = pair_answer("plaincert", Crypto::cert_data().hex());
+    Data challenge_response =
+        pair_answer("challengeresponse", Data::random_bytes(48).hex());
+    Data pairing_secret = pair_answer(
+        "pairingsecret",
+        server_secret
+            .append(Crypto::sign_data(server_secret, Crypto::key_data()))
+            .hex());
+    Data paired = pair_answer(nullptr, Data());
+
+    size_t before = allocations.load();
+    for (auto _ : state) {
+        std::string value;
+
+        Data salt = Data::random_bytes(16);
+        Data salted_pin = Data::Builder(salt.size() + strlen(pin))
+                              .append(salt)
+                              .append((const unsigned char*)pin, strlen(pin))
+                              .build();
+        snprintf(url, sizeof(url),
+                 "http://192.168.1.10:47989/pair?uniqueid=%s&devicename=roth&"
+                 "updateState=1&phrase=getservercert&salt=%s&clientcert=%s",
+                 unique_id, salt.hex().bytes(),
+                 Crypto::cert_data().hex().bytes());
+        pair_validate(plaincert, "plaincert", &value);
+
+        Data server_cert = Data(value.c_str(), value.size()).hex_to_bytes();
+        Data aes_key = Crypto::create_AES_key_from_salt_SHA256(salted_pin);
+        Data random_challenge = Data::random_bytes(16);
+        Data encrypted_challenge =
+            Crypto::aes_encrypt(random_challenge, aes_key);
+        snprintf(url, sizeof(url),
+                 "http://192.168.1.10:47989/pair?uniqueid=%s&devicename=roth&"
+                 "updateState=1&clientchallenge=%s",
+                 unique_id, encrypted_challenge.hex().bytes());
+        pair_validate(challenge_response, "challengeresponse", &value);
+
+        Data server_challenge_response = Crypto::aes_decrypt(
+            Data(value.c_str(), value.size()).hex_to_bytes(), aes_key);
+        Data server_challenge = server_challenge_response.subdata(32, 16);
+        Data client_secret = Data::random_bytes(16);
+        Data client_signature = Crypto::signature(Crypto::cert_data());
+        Data challenge_hash = Crypto::SHA256_hash_data(
+            Data::Builder(server_challenge.size() + client_signature.size() +
+                          client_secret.size())
+                .append(server_challenge)
+                .append(client_signature)
+                .append(client_secret)
+                .build());
+        snprintf(url, sizeof(url),
+                 "http://192.168.1.10:47989/pair?uniqueid=%s&devicename=roth&"
+                 "updateState=1&serverchallengeresp=%s",
+                 unique_id,
+                 Crypto::aes_encrypt(challenge_hash, aes_key).hex().bytes());
+        pair_validate(pairing_secret, "pairingsecret", &value);
+
+        Data server_secret_response =
+            Data(value.c_str(), value.size()).hex_to_bytes();
+        Data secret = server_secret_response.subdata(0, 16);
+        Data signature = server_secret_response.subdata(16, 256);
+        benchmark::DoNotOptimize(
+            Crypto::verify_signature(secret, signature, server_cert));
+        Data client_pairing_secret = client_secret.append(
+            Crypto::sign_data(client_secret, Crypto::key_data()));
+        snprintf(url, sizeof(url),
+                 "http://192.168.1.10:47989/pair?uniqueid=%s&devicename=roth&"
+                 "updateState=1&clientpairingsecret=%s",
+                 unique_id, client_pairing_secret.hex().bytes());
+        pair_validate(paired, nullptr, &value);
+        benchmark::DoNotOptimize(url);
+    }
+
+    state.counters["allocations"] =
+        benchmark::Counter((double)(allocations.load() - before),
+                           benchmark::Counter::kAvgIterations);
+}
+
+template <class Crypto> static bool register_crypto(const char* name) {
+    if (!Crypto::load_cert_key_pair() &&
+        !Crypto::generate_new_cert_key_pair()) {
+        fprintf(stderr, "%s: failed to create a client certificate in %s\n",
+                name, Settings::instance().key_dir().c_str());
+        return false;
+    }
+
+    std::string prefix = std::string("BM_") + name + "/";
+    benchmark::RegisterBenchmark((prefix + "SHA1").c_str(), BM_SHA1<Crypto>)
+        ->Arg(32)->Arg(1200);
+    benchmark::RegisterBenchmark((prefix + "SHA256").c_str(),
+                                 BM_SHA256<Crypto>)
+        ->Arg(32)->Arg(1200);
+    benchmark::RegisterBenchmark((prefix + "aes_key").c_str(),
+                                 BM_aes_key<Crypto>);
+    benchmark::RegisterBenchmark((prefix + "aes_encrypt").c_str(),
+                                 BM_aes_encrypt<Crypto>)
+        ->Arg(16)->Arg(48);
+    benchmark::RegisterBenchmark((prefix + "aes_decrypt").c_str(),
+                                 BM_aes_decrypt<Crypto>)
+        ->Arg(16)->Arg(48);
+    benchmark::RegisterBenchmark((prefix + "signature").c_str(),
+                                 BM_signature<Crypto>);
+    benchmark::RegisterBenchmark((prefix + "sign_data").c_str(),
+                                 BM_sign_data<Crypto>);
+    benchmark::RegisterBenchmark((prefix + "verify_signature").c_str(),
+                                 BM_verify_signature<Crypto>);
+    benchmark::RegisterBenchmark((prefix + "pair").c_str(), BM_pair<Crypto>);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    // Our own options go before Google Benchmark sees the rest
+    std::string keys = "bench_keys";
+    std::vector<char*> args;
+    for (int i = 0; i < argc; i++) {
+        if (strncmp(argv[i], "--keys=", 7) == 0) {
+            keys = argv[i] + 7;
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+
+    int count = (int)args.size();
+    benchmark::Initialize(&count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(count, args.data()))
+        return 1;
+
+    // Each backend gets its own certificate, they write the same file names
+#ifdef USE_OPENSSL_CRYPTO
+    mkdir(keys.c_str(), 0775);
+    Settings::instance().set_key_dir(keys + "/openssl");
+    mkdir(Settings::instance().key_dir().c_str(), 0775);
+    if (!register_crypto<OpenSSLCryptoManager>("OpenSSLCryptoManager"))
+        return 1;
+#endif
+#ifdef USE_MBEDTLS_CRYPTO
+    mkdir(keys.c_str(), 0775);
+    Settings::instance().set_key_dir(keys + "/mbedtls");
+    mkdir(Settings::instance().key_dir().c_str(), 0775);
+    if (!register_crypto<MbedTLSCryptoManager>("MbedTLSCryptoManager"))
+        return 1;
+#endif
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
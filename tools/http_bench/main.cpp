@@ -0,0 +1,246 @@
+//
+//  Request latency of the libgamestream HTTP client against a host.
+//
+//  moonlight_http_bench [options]
+//    --host=ADDRESS           Host to query, default 127.0.0.1
+//    --http-port=PORT         Default 47989
+//    --https-port=PORT        Default 47984
+//    --keys=DIR               Client certificate directory, a new one is
+//                             generated there if it has none
+//    --requests=N             Requests per run, default 50
+//    --threads=N              Threads for the concurrent run, default 4
+//
+//  Every run fetches serverinfo. Cold runs drop all connections and TLS
+//  sessions before each request, so each one pays the full TCP and TLS
+//  handshake. Warm runs reuse the pooled connections.
+//  Works against tools/mock_host as well as a real host, an unpaired
+//  client still gets serverinfo answered.
+//
+
+#include "errors.h"
+#include "http.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+// libgamestream's error reporting lives in client.cpp, which needs far
+// more than the HTTP layer
+static std::string last_error;
+void gs_set_error(std::string error) { last_error = error; }
+std::string gs_error() { return last_error; }
+
+static bool has_prefix(const std::string& arg, const char* prefix,
+                       std::string* value) {
+    size_t length = strlen(prefix);
+    if (arg.compare(0, length, prefix) != 0)
+        return false;
+    *value = arg.substr(length);
+    return true;
+}
+
+static bool file_exists(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0;
+}
+
+static bool generate_keys(const std::string& directory) {
+    EVP_PKEY* key = nullptr;
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, nullptr);
+    if (!ctx || EVP_PKEY_keygen_init(ctx) <= 0 ||
+        EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, 2048) <= 0 ||
+        EVP_PKEY_keygen(ctx, &key) <= 0) {
+        EVP_PKEY_CTX_free(ctx);
+        return false;
+    }
+    EVP_PKEY_CTX_free(ctx);
+
+    X509* cert = X509_new();
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 20L * 365 * 24 * 3600);
+    X509_set_pubkey(cert, key);
+
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                               (const unsigned char*)"NVIDIA GameStream Client",
+                               -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+
+    bool result = X509_sign(cert, key, EVP_sha256()) != 0;
+    mkdir(directory.c_str(), 0775);
+
+    FILE* cert_file = fopen((directory + "/client.pem").c_str(), "w");
+    FILE* key_file = fopen((directory + "/key.pem").c_str(), "w");
+    result = result && cert_file && key_file &&
+             PEM_write_X509(cert_file, cert) &&
+             PEM_write_PrivateKey(key_file, key, nullptr, nullptr, 0, nullptr,
+                                  nullptr);
+
+    if (cert_file)
+        fclose(cert_file);
+    if (key_file)
+        fclose(key_file);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return result;
+}
+
+static double now_ms() {
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static void print_times(const char* name, std::vector<double> times,
+                        int failures) {
+    if (times.empty()) {
+        printf("%-20s all %d requests failed: %s\n", name, failures,
+               gs_error().c_str());
+        return;
+    }
+
+    std::sort(times.begin(), times.end());
+    double sum = 0;
+    for (double time : times)
+        sum += time;
+
+    printf("%-20s %5zu ok %3d failed   min %7.2f  median %7.2f  p95 %7.2f  "
+           "mean %7.2f ms\n",
+           name, times.size(), failures, times.front(),
+           times[times.size() / 2],
+           times[std::min(times.size() - 1, times.size() * 95 / 100)],
+           sum / times.size());
+}
+
+static void run(const char* name, const std::string& url, int requests,
+                bool cold) {
+    std::vector<double> times;
+    int failures = 0;
+
+    // One request up front so warm runs start with an open connection
+    Data data;
+    http_request(url, &data, HTTPRequestTimeoutMedium);
+
+    for (int i = 0; i < requests; i++) {
+        if (cold)
+            http_close_connections();
+
+        double start = now_ms();
+        if (http_request(url, &data, HTTPRequestTimeoutMedium) == GS_OK) {
+            times.push_back(now_ms() - start);
+        } else {
+            failures++;
+        }
+    }
+    print_times(name, times, failures);
+}
+
+static void run_concurrent(const char* name, const std::string& url,
+                           int requests, int thread_count) {
+    std::vector<std::vector<double>> times(thread_count);
+    std::vector<int> failures(thread_count, 0);
+    std::vector<std::thread> threads;
+
+    double start = now_ms();
+    for (int t = 0; t < thread_count; t++) {
+        threads.emplace_back([&, t] {
+            Data data;
+            for (int i = 0; i < requests; i++) {
+                double request_start = now_ms();
+                if (http_request(url, &data, HTTPRequestTimeoutMedium) ==
+                    GS_OK) {
+                    times[t].push_back(now_ms() - request_start);
+                } else {
+                    failures[t]++;
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+    double elapsed = now_ms() - start;
+
+    std::vector<double> all;
+    int failed = 0;
+    for (int t = 0; t < thread_count; t++) {
+        all.insert(all.end(), times[t].begin(), times[t].end());
+        failed += failures[t];
+    }
+    print_times(name, all, failed);
+    printf("%-20s %.0f requests/s\n", "", all.size() * 1000.0 / elapsed);
+}
+
+int main(int argc, char** argv) {
+    std::string host = "127.0.0.1";
+    std::string keys = "bench_keys";
+    int http_port = 47989;
+    int https_port = 47984;
+    int requests = 50;
+    int threads = 4;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string value;
+
+        if (has_prefix(arg, "--host=", &value)) {
+            host = value;
+        } else if (has_prefix(arg, "--http-port=", &value)) {
+            http_port = atoi(value.c_str());
+        } else if (has_prefix(arg, "--https-port=", &value)) {
+            https_port = atoi(value.c_str());
+        } else if (has_prefix(arg, "--keys=", &value)) {
+            keys = value;
+        } else if (has_prefix(arg, "--requests=", &value)) {
+            requests = std::max(1, atoi(value.c_str()));
+        } else if (has_prefix(arg, "--threads=", &value)) {
+            threads = std::max(1, atoi(value.c_str()));
+        } else {
+            printf("Usage: moonlight_http_bench [--host=ADDRESS] "
+                   "[--http-port=PORT] [--https-port=PORT]\n"
+                   "  [--keys=DIR] [--requests=N] [--threads=N]\n");
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    if (!file_exists(keys + "/client.pem") && !generate_keys(keys)) {
+        fprintf(stderr, "Failed to create a client certificate in %s\n",
+                keys.c_str());
+        return 1;
+    }
+
+    http_init(keys);
+
+    std::string query = "/serverinfo?uniqueid=0123456789ABCDEF";
+    std::string http_url =
+        "http://" + host + ":" + std::to_string(http_port) + query;
+    std::string https_url =
+        "https://" + host + ":" + std::to_string(https_port) + query;
+
+    run("http cold", http_url, requests, true);
+    run("http warm", http_url, requests, false);
+    run("https cold", https_url, requests, true);
+    run("https warm", https_url, requests, false);
+    run_concurrent("https concurrent", https_url, requests, threads);
+
+    HTTPHostStats stats;
+    if (http_host_stats(host, &stats)) {
+        printf("%-20s rtt %u ms, variance %u ms, %u requests, %u timeouts, "
+               "%u retries\n",
+               "host", stats.rtt, stats.rtt_variance, stats.requests,
+               stats.timeouts, stats.retries);
+    }
+
+    http_cleanup();
+    return 0;
+}
@@ -0,0 +1,296 @@
+#include "HttpServer.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define POLL_INTERVAL_MS 250
+#define MAX_HEADER_SIZE (64 * 1024)
+
+static std::string url_decode(const std::string& value) {
+    std::string result;
+    result.reserve(value.size());
+
+    for (size_t i = 0; i < value.size(); i++) {
+        if (value[i] == '%' && i + 2 < value.size()) {
+            result += (char)strtol(value.substr(i + 1, 2).c_str(), nullptr, 16);
+            i += 2;
+        } else if (value[i] == '+') {
+            result += ' ';
+        } else {
+            result += value[i];
+        }
+    }
+    return result;
+}
+
+static void parse_target(const std::string& target, HttpRequest* request) {
+    size_t question = target.find('?');
+    request->path = target.substr(0, question);
+    if (question == std::string::npos)
+        return;
+
+    size_t start = question + 1;
+    while (start < target.size()) {
+        size_t end = target.find('&', start);
+        if (end == std::string::npos)
+            end = target.size();
+
+        std::string pair = target.substr(start, end - start);
+        size_t equals = pair.find('=');
+        if (equals == std::string::npos) {
+            request->query[url_decode(pair)] = "";
+        } else {
+            request->query[url_decode(pair.substr(0, equals))] =
+                url_decode(pair.substr(equals + 1));
+        }
+        start = end + 1;
+    }
+}
+
+static const char* status_text(int status) {
+    switch (status) {
+    case 200:
+        return "OK";
+    case 400:
+        return "Bad Request";
+    case 401:
+        return "Unauthorized";
+    case 404:
+        return "Not Found";
+    case 503:
+        return "Service Unavailable";
+    default:
+        return "Error";
+    }
+}
+
+HttpServer::HttpServer(HttpHandler handler) : m_handler(std::move(handler)) {}
+
+HttpServer::~HttpServer() {
+    stop();
+
+    // Connection threads notice m_running within one poll interval
+    while (m_active > 0)
+        usleep(POLL_INTERVAL_MS * 1000);
+
+    for (auto& listener : m_listeners)
+        close(listener.fd);
+}
+
+bool HttpServer::listen(int port, SSL_CTX* tls) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return false;
+
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+
+    if (bind(fd, (sockaddr*)&address, sizeof(address)) != 0 ||
+        ::listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return false;
+    }
+
+    m_listeners.push_back({fd, tls});
+    return true;
+}
+
+void HttpServer::run() {
+    m_running = true;
+
+    std::vector<pollfd> fds;
+    for (auto& listener : m_listeners)
+        fds.push_back({listener.fd, POLLIN, 0});
+
+    while (m_running) {
+        if (poll(fds.data(), fds.size(), POLL_INTERVAL_MS) <= 0)
+            continue;
+
+        for (size_t i = 0; i < fds.size(); i++) {
+            if (!(fds[i].revents & POLLIN))
+                continue;
+
+            int client = accept(fds[i].fd, nullptr, nullptr);
+            if (client < 0)
+                continue;
+
+            int no_delay = 1;
+            setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &no_delay,
+                       sizeof(no_delay));
+
+            int active = ++m_active;
+            int peak = m_peak;
+            while (active > peak && !m_peak.compare_exchange_weak(peak, active))
+                ;
+
+            std::thread(&HttpServer::serve, this, client, m_listeners[i].tls)
+                .detach();
+        }
+    }
+}
+
+void HttpServer::stop() { m_running = false; }
+
+void HttpServer::serve(int fd, SSL_CTX* tls) {
+    SSL* ssl = nullptr;
+    HttpRequest base_request;
+
+    // Returns false once the connection is gone or the server stops
+    auto wait_readable = [&]() {
+        while (m_running) {
+            if (ssl && SSL_pending(ssl) > 0)
+                return true;
+
+            pollfd pfd = {fd, POLLIN, 0};
+            int result = poll(&pfd, 1, POLL_INTERVAL_MS);
+            if (result > 0)
+                return true;
+            if (result < 0)
+                return false;
+        }
+        return false;
+    };
+
+    auto read_some = [&](char* buffer, int size) -> int {
+        return ssl ? SSL_read(ssl, buffer, size)
+                   : (int)recv(fd, buffer, size, 0);
+    };
+
+    auto write_all = [&](const std::string& data) {
+        size_t written = 0;
+        while (written < data.size()) {
+            int result =
+                ssl ? SSL_write(ssl, data.data() + written,
+                                (int)(data.size() - written))
+                    : (int)send(fd, data.data() + written,
+                                data.size() - written, MSG_NOSIGNAL);
+            if (result <= 0)
+                return false;
+            written += result;
+        }
+        return true;
+    };
+
+    {
+        sockaddr_in local = {};
+        socklen_t length = sizeof(local);
+        char address[INET_ADDRSTRLEN] = {};
+        if (getsockname(fd, (sockaddr*)&local, &length) == 0 &&
+            inet_ntop(AF_INET, &local.sin_addr, address, sizeof(address)))
+            base_request.local_address = address;
+    }
+
+    if (tls) {
+        ssl = SSL_new(tls);
+        SSL_set_fd(ssl, fd);
+        if (SSL_accept(ssl) <= 0)
+            goto cleanup;
+
+        if (X509* cert = SSL_get_peer_certificate(ssl)) {
+            int size = i2d_X509(cert, nullptr);
+            if (size > 0) {
+                base_request.client_cert.resize(size);
+                auto* out = (unsigned char*)&base_request.client_cert[0];
+                i2d_X509(cert, &out);
+            }
+            X509_free(cert);
+        }
+        base_request.https = true;
+    }
+
+    {
+        std::string pending;
+        char buffer[16 * 1024];
+
+        while (m_running) {
+            size_t header_end;
+            while ((header_end = pending.find("\r\n\r\n")) ==
+                   std::string::npos) {
+                if (pending.size() > MAX_HEADER_SIZE || !wait_readable())
+                    goto cleanup;
+
+                int result = read_some(buffer, sizeof(buffer));
+                if (result <= 0)
+                    goto cleanup;
+                pending.append(buffer, result);
+            }
+
+            std::string header = pending.substr(0, header_end);
+            pending.erase(0, header_end + 4);
+
+            std::string lower = header;
+            std::transform(lower.begin(), lower.end(), lower.begin(),
+                           ::tolower);
+
+            // Bodies are never used by the GameStream protocol, skip them
+            size_t content_length = 0;
+            size_t length_pos = lower.find("\r\ncontent-length:");
+            if (length_pos != std::string::npos)
+                content_length = strtoul(lower.c_str() + length_pos + 17,
+                                         nullptr, 10);
+            while (pending.size() < content_length) {
+                if (!wait_readable())
+                    goto cleanup;
+                int result = read_some(buffer, sizeof(buffer));
+                if (result <= 0)
+                    goto cleanup;
+                pending.append(buffer, result);
+            }
+            pending.erase(0, content_length);
+
+            bool keep_alive =
+                lower.find("\r\nconnection: close") == std::string::npos &&
+                header.find("HTTP/1.0") == std::string::npos;
+
+            HttpRequest request = base_request;
+            size_t method_end = header.find(' ');
+            size_t target_end = header.find(' ', method_end + 1);
+            if (method_end == std::string::npos ||
+                target_end == std::string::npos)
+                goto cleanup;
+            parse_target(header.substr(method_end + 1,
+                                       target_end - method_end - 1),
+                         &request);
+
+            HttpResponse response = m_handler(request);
+
+            if (response.drop)
+                goto cleanup;
+
+            if (response.hang) {
+                while (m_running)
+                    usleep(POLL_INTERVAL_MS * 1000);
+                goto cleanup;
+            }
+
+            std::string head =
+                "HTTP/1.1 " + std::to_string(response.status) + " " +
+                status_text(response.status) +
+                "\r\nContent-Type: " + response.content_type +
+                "\r\nContent-Length: " + std::to_string(response.body.size()) +
+                "\r\nConnection: " + (keep_alive ? "keep-alive" : "close") +
+                "\r\n\r\n";
+
+            if (!write_all(head + response.body) || !keep_alive)
+                goto cleanup;
+        }
+    }
+
+cleanup:
+    if (ssl) {
+        SSL_shutdown(ssl);
+        SSL_free(ssl);
+    }
+    close(fd);
+    m_active--;
+}
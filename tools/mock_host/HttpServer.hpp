@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <openssl/ssl.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct HttpRequest {
+    std::string path;
+    std::map<std::string, std::string> query;
+    bool https = false;
+
+    // Address the client connected to, for URLs pointing back at us
+    std::string local_address;
+
+    // DER of the TLS client certificate, empty over plain HTTP
+    std::string client_cert;
+};
+
+struct HttpResponse {
+    int status = 200;
+    std::string content_type = "application/xml";
+    std::string body;
+
+    // Failure injection: drop the connection without a response,
+    // or keep it open without ever answering
+    bool drop = false;
+    bool hang = false;
+};
+
+using HttpHandler = std::function<HttpResponse(const HttpRequest&)>;
+
+// Minimal HTTP/1.1 server with keep-alive, one thread per connection.
+// Listeners added with a TLS context ask for a client certificate but
+// accept any, like GameStream hosts before pairing.
+class HttpServer {
+  public:
+    explicit HttpServer(HttpHandler handler);
+    ~HttpServer();
+
+    bool listen(int port, SSL_CTX* tls = nullptr);
+
+    // Accepts connections until stop()
+    void run();
+    void stop();
+
+    [[nodiscard]] int active_connections() const { return m_active; }
+    [[nodiscard]] int peak_connections() const { return m_peak; }
+
+  private:
+    struct Listener {
+        int fd;
+        SSL_CTX* tls;
+    };
+
+    void serve(int fd, SSL_CTX* tls);
+
+    HttpHandler m_handler;
+    std::vector<Listener> m_listeners;
+    std::atomic<bool> m_running = {false};
+    std::atomic<int> m_active = {0};
+    std::atomic<int> m_peak = {0};
+};
@@ -0,0 +1,615 @@
+#include "MockHost.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <openssl/pem.h>
+#include <openssl/rand.h>
+#include <openssl/rsa.h>
+#include <thread>
+
+#define APP_ID_BASE 1000
+#define CHALLENGE_SIZE 16
+
+// H264 | HEVC | HEVC Main10
+#define SERVER_CODEC_MODE_SUPPORT 0x301
+
+// MARK: Helpers
+
+static std::string hex(const std::string& data) {
+    static const char digits[] = "0123456789ABCDEF";
+    std::string result;
+    result.reserve(data.size() * 2);
+    for (unsigned char c : data) {
+        result += digits[c >> 4];
+        result += digits[c & 0xF];
+    }
+    return result;
+}
+
+static std::string unhex(const std::string& text) {
+    std::string result;
+    result.reserve(text.size() / 2);
+    for (size_t i = 0; i + 1 < text.size(); i += 2)
+        result += (char)strtol(text.substr(i, 2).c_str(), nullptr, 16);
+    return result;
+}
+
+static std::string random_bytes(size_t size) {
+    std::string result(size, '\0');
+    RAND_bytes((unsigned char*)&result[0], (int)size);
+    return result;
+}
+
+static std::string sha256(const std::string& data) {
+    unsigned char digest[32];
+    unsigned int size = 0;
+    EVP_Digest(data.data(), data.size(), digest, &size, EVP_sha256(), nullptr);
+    return std::string((char*)digest, size);
+}
+
+// Pairing uses AES-128-ECB on block aligned data, no padding
+static std::string aes(const std::string& data, const std::string& key,
+                       bool encrypt) {
+    std::string result(data.size() + 16, '\0');
+    int size = 0, final_size = 0;
+
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    EVP_CipherInit_ex(ctx, EVP_aes_128_ecb(), nullptr,
+                      (const unsigned char*)key.data(), nullptr, encrypt);
+    EVP_CIPHER_CTX_set_padding(ctx, 0);
+    EVP_CipherUpdate(ctx, (unsigned char*)&result[0], &size,
+                     (const unsigned char*)data.data(), (int)data.size());
+    EVP_CipherFinal_ex(ctx, (unsigned char*)&result[size], &final_size);
+    EVP_CIPHER_CTX_free(ctx);
+
+    result.resize(size + final_size);
+    return result;
+}
+
+static std::string cert_signature(X509* cert) {
+    const ASN1_BIT_STRING* signature = nullptr;
+    X509_get0_signature(&signature, nullptr, cert);
+    return signature ? std::string((const char*)signature->data,
+                                   signature->length)
+                     : "";
+}
+
+static std::string cert_der(X509* cert) {
+    std::string result(i2d_X509(cert, nullptr), '\0');
+    auto* out = (unsigned char*)&result[0];
+    i2d_X509(cert, &out);
+    return result;
+}
+
+static X509* cert_from_pem(const std::string& pem) {
+    BIO* bio = BIO_new_mem_buf(pem.data(), (int)pem.size());
+    X509* cert = PEM_read_bio_X509(bio, nullptr, nullptr, nullptr);
+    BIO_free(bio);
+    return cert;
+}
+
+static std::string xml_escape(const std::string& value) {
+    std::string result;
+    for (char c : value) {
+        switch (c) {
+        case '&':
+            result += "&amp;";
+            break;
+        case '<':
+            result += "&lt;";
+            break;
+        case '>':
+            result += "&gt;";
+            break;
+        case '"':
+            result += "&quot;";
+            break;
+        default:
+            result += c;
+        }
+    }
+    return result;
+}
+
+// Protocol level errors travel in the root status, like on real hosts
+static HttpResponse xml(const std::string& content, int status_code = 200,
+                        const std::string& message = "OK") {
+    HttpResponse response;
+    response.body = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+                    "<root status_code=\"" +
+                    std::to_string(status_code) + "\" status_message=\"" +
+                    xml_escape(message) + "\">" + content + "</root>";
+    return response;
+}
+
+static uint32_t crc32(const unsigned char* data, size_t size,
+                      uint32_t crc = 0) {
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+static void png_chunk(std::string* png, const char* type,
+                      const std::string& data) {
+    auto put32 = [png](uint32_t value) {
+        for (int shift = 24; shift >= 0; shift -= 8)
+            *png += (char)(value >> shift);
+    };
+
+    std::string body = std::string(type, 4) + data;
+    put32((uint32_t)data.size());
+    *png += body;
+    put32(crc32((const unsigned char*)body.data(), body.size()));
+}
+
+// MARK: MockHost
+
+MockHost::MockHost(const MockHostConfig& config)
+    : m_config(config),
+      m_server([this](const HttpRequest& request) { return handle(request); }),
+      m_random(config.seed) {}
+
+MockHost::~MockHost() {
+    if (m_tls)
+        SSL_CTX_free(m_tls);
+    if (m_cert)
+        X509_free(m_cert);
+    if (m_key)
+        EVP_PKEY_free(m_key);
+}
+
+bool MockHost::generate_identity() {
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, nullptr);
+    if (!ctx || EVP_PKEY_keygen_init(ctx) <= 0 ||
+        EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, 2048) <= 0 ||
+        EVP_PKEY_keygen(ctx, &m_key) <= 0) {
+        EVP_PKEY_CTX_free(ctx);
+        return false;
+    }
+    EVP_PKEY_CTX_free(ctx);
+
+    m_cert = X509_new();
+    X509_set_version(m_cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(m_cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(m_cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(m_cert), 20L * 365 * 24 * 3600);
+    X509_set_pubkey(m_cert, m_key);
+
+    X509_NAME* name = X509_get_subject_name(m_cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                               (const unsigned char*)"Mock GameStream Host",
+                               -1, -1, 0);
+    X509_set_issuer_name(m_cert, name);
+
+    if (!X509_sign(m_cert, m_key, EVP_sha256()))
+        return false;
+
+    BIO* bio = BIO_new(BIO_s_mem());
+    PEM_write_bio_X509(bio, m_cert);
+    char* pem = nullptr;
+    long size = BIO_get_mem_data(bio, &pem);
+    m_cert_pem = std::string(pem, size);
+    BIO_free(bio);
+
+    m_cert_signature = cert_signature(m_cert);
+    return true;
+}
+
+bool MockHost::start() {
+    if (!generate_identity()) {
+        fprintf(stderr, "MockHost: Failed to generate the server identity\n");
+        return false;
+    }
+
+    m_tls = SSL_CTX_new(TLS_server_method());
+    SSL_CTX_use_certificate(m_tls, m_cert);
+    SSL_CTX_use_PrivateKey(m_tls, m_key);
+
+    // Ask for the client certificate, any one is accepted
+    SSL_CTX_set_verify(m_tls, SSL_VERIFY_PEER,
+                       [](int, X509_STORE_CTX*) { return 1; });
+
+    // Lets clients resume TLS sessions, which needs a context once
+    // client certificates are requested
+    static const unsigned char session_context[] = "moonlight_mock_host";
+    SSL_CTX_set_session_id_context(m_tls, session_context,
+                                   sizeof(session_context) - 1);
+
+    if (!m_server.listen(m_config.http_port) ||
+        !m_server.listen(m_config.https_port, m_tls)) {
+        fprintf(stderr, "MockHost: Failed to listen on ports %d / %d\n",
+                m_config.http_port, m_config.https_port);
+        return false;
+    }
+
+    printf("MockHost: %s \"%s\" with %d apps on http %d, https %d\n",
+           m_config.sunshine ? "Sunshine" : "GameStream",
+           m_config.hostname.c_str(), m_config.app_count, m_config.http_port,
+           m_config.https_port);
+    return true;
+}
+
+void MockHost::run() { m_server.run(); }
+
+void MockHost::stop() { m_server.stop(); }
+
+template <typename T>
+const T* MockHost::rule(const std::map<std::string, T>& rules,
+                        const std::string& endpoint) {
+    auto it = rules.find(endpoint);
+    if (it == rules.end())
+        it = rules.find(MOCK_ALL_ENDPOINTS);
+    return it == rules.end() ? nullptr : &it->second;
+}
+
+HttpResponse MockHost::handle(const HttpRequest& request) {
+    auto start = std::chrono::steady_clock::now();
+    std::string endpoint =
+        request.path.empty() ? "" : request.path.substr(1);
+
+    int delay = 0;
+    bool fail = false;
+    MockFailureMode failure_mode = FAIL_STATUS;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (auto latency = rule(m_config.latency, endpoint)) {
+            delay = latency->delay_ms;
+            if (latency->jitter_ms > 0)
+                delay += (int)(m_random() % (latency->jitter_ms + 1));
+        }
+
+        if (auto failure = rule(m_config.failures, endpoint)) {
+            fail = std::uniform_real_distribution<double>(0, 1)(m_random) <
+                   failure->rate;
+            failure_mode = failure->mode;
+        }
+    }
+
+    if (delay > 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+
+    HttpResponse response;
+    if (fail) {
+        response = xml("", 503, "Injected failure");
+        response.status = 503;
+        response.drop = failure_mode == FAIL_DROP;
+        response.hang = failure_mode == FAIL_HANG;
+    } else if (endpoint == "serverinfo") {
+        response = serverinfo(request);
+    } else if (endpoint == "pair") {
+        response = pair(request);
+    } else if (endpoint == "applist") {
+        response = applist(request);
+    } else if (endpoint == "appasset") {
+        response = appasset(request);
+    } else if (endpoint == "launch") {
+        response = launch(request, false);
+    } else if (endpoint == "resume") {
+        response = launch(request, true);
+    } else if (endpoint == "cancel") {
+        response = cancel(request);
+    } else if (endpoint == "unpair") {
+        response = unpair(request);
+    } else {
+        response = xml("", 404, "Unknown endpoint");
+        response.status = 404;
+    }
+
+    auto time = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& stats = m_stats[endpoint];
+    stats.requests++;
+    stats.failures += fail ? 1 : 0;
+    stats.total_time_us += time;
+    stats.max_time_us = std::max(stats.max_time_us, time);
+    return response;
+}
+
+bool MockHost::is_paired(const HttpRequest& request) {
+    return m_config.auto_pair ||
+           (request.https && m_paired_certs.count(request.client_cert) > 0);
+}
+
+HttpResponse MockHost::serverinfo(const HttpRequest& request) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    bool paired = is_paired(request);
+
+    // Paired clients only over HTTPS, the client falls back to HTTP
+    if (request.https && !paired)
+        return xml("", 401, "The client is not authorized");
+
+    std::string state = m_config.sunshine ? "SUNSHINE_SERVER_" : "MOCK_SERVER_";
+    state += m_current_game ? "BUSY" : "FREE";
+
+    std::string content =
+        "<hostname>" + xml_escape(m_config.hostname) + "</hostname>"
+        "<appversion>" + (m_config.sunshine ? "7.1.431.-1" : "7.1.431.0") +
+        "</appversion>"
+        "<GfeVersion>3.23.0.74</GfeVersion>"
+        "<uniqueid>" + hex(sha256(m_config.hostname)).substr(0, 32) +
+        "</uniqueid>"
+        "<HttpsPort>" + std::to_string(m_config.https_port) + "</HttpsPort>"
+        "<ExternalPort>" + std::to_string(m_config.http_port) +
+        "</ExternalPort>"
+        "<mac>" + m_config.mac + "</mac>"
+        "<LocalIP>" + request.local_address + "</LocalIP>"
+        "<ServerCodecModeSupport>" +
+        std::to_string(SERVER_CODEC_MODE_SUPPORT) +
+        "</ServerCodecModeSupport>"
+        "<MaxLumaPixelsHEVC>1869449984</MaxLumaPixelsHEVC>"
+        "<gputype>Mock GPU</gputype>"
+        "<GsVersion>7.1.431.0</GsVersion>"
+        "<PairStatus>" + (request.https && paired ? "1" : "0") +
+        "</PairStatus>"
+        "<currentgame>" + std::to_string(m_current_game) + "</currentgame>"
+        "<state>" + state + "</state>";
+    return xml(content);
+}
+
+HttpResponse MockHost::pair(const HttpRequest& request) {
+    auto param = [&request](const char* name) -> std::string {
+        auto it = request.query.find(name);
+        return it == request.query.end() ? "" : it->second;
+    };
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::string unique_id = param("uniqueid");
+    auto not_paired = [this, &unique_id]() {
+        m_pairing.erase(unique_id);
+        return xml("<paired>0</paired>");
+    };
+
+    if (param("phrase") == "getservercert") {
+        PairingSession session;
+        session.client_cert_pem = unhex(param("clientcert"));
+        session.aes_key = sha256(unhex(param("salt")) + m_config.pin)
+                              .substr(0, CHALLENGE_SIZE);
+        m_pairing[unique_id] = session;
+        return xml("<paired>1</paired><plaincert>" + hex(m_cert_pem) +
+                   "</plaincert>");
+    }
+
+    auto it = m_pairing.find(unique_id);
+
+    if (param("phrase") == "pairchallenge") {
+        // Pairing completes once the client shows its cert over TLS
+        if (!request.https || it == m_pairing.end() || !it->second.verified)
+            return not_paired();
+
+        X509* cert = cert_from_pem(it->second.client_cert_pem);
+        bool matches = cert && cert_der(cert) == request.client_cert;
+        if (cert)
+            X509_free(cert);
+        if (!matches)
+            return not_paired();
+
+        m_paired_certs[request.client_cert] = unique_id;
+        m_pairing.erase(it);
+        printf("MockHost: Paired %s\n", unique_id.c_str());
+        return xml("<paired>1</paired>");
+    }
+
+    if (it == m_pairing.end())
+        return not_paired();
+    auto& session = it->second;
+
+    if (!param("clientchallenge").empty()) {
+        std::string challenge =
+            aes(unhex(param("clientchallenge")), session.aes_key, false);
+        session.server_challenge = random_bytes(CHALLENGE_SIZE);
+        session.server_secret = random_bytes(CHALLENGE_SIZE);
+
+        std::string hash =
+            sha256(challenge + m_cert_signature + session.server_secret);
+        std::string response =
+            aes(hash + session.server_challenge, session.aes_key, true);
+        return xml("<paired>1</paired><challengeresponse>" + hex(response) +
+                   "</challengeresponse>");
+    }
+
+    if (!param("serverchallengeresp").empty()) {
+        session.client_hash =
+            aes(unhex(param("serverchallengeresp")), session.aes_key, false);
+
+        std::string signature(EVP_PKEY_size(m_key), '\0');
+        size_t signature_size = signature.size();
+        EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+        EVP_DigestSignInit(ctx, nullptr, EVP_sha256(), nullptr, m_key);
+        EVP_DigestSign(ctx, (unsigned char*)&signature[0], &signature_size,
+                       (const unsigned char*)session.server_secret.data(),
+                       session.server_secret.size());
+        EVP_MD_CTX_free(ctx);
+        signature.resize(signature_size);
+
+        return xml("<paired>1</paired><pairingsecret>" +
+                   hex(session.server_secret + signature) +
+                   "</pairingsecret>");
+    }
+
+    if (!param("clientpairingsecret").empty()) {
+        std::string data = unhex(param("clientpairingsecret"));
+        if (data.size() <= CHALLENGE_SIZE)
+            return not_paired();
+
+        std::string client_secret = data.substr(0, CHALLENGE_SIZE);
+        std::string signature = data.substr(CHALLENGE_SIZE);
+
+        X509* cert = cert_from_pem(session.client_cert_pem);
+        if (!cert)
+            return not_paired();
+
+        EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+        bool valid =
+            EVP_DigestVerifyInit(ctx, nullptr, EVP_sha256(), nullptr,
+                                 X509_get0_pubkey(cert)) == 1 &&
+            EVP_DigestVerify(
+                ctx, (const unsigned char*)signature.data(), signature.size(),
+                (const unsigned char*)client_secret.data(),
+                client_secret.size()) == 1;
+        EVP_MD_CTX_free(ctx);
+
+        // Without a configured PIN the AES key is meaningless,
+        // so the challenge hash can only be checked with one
+        if (valid && !m_config.pin.empty()) {
+            std::string expected = sha256(session.server_challenge +
+                                          cert_signature(cert) + client_secret);
+            valid = session.client_hash.compare(0, expected.size(),
+                                                expected) == 0;
+        }
+        X509_free(cert);
+
+        if (!valid) {
+            printf("MockHost: Pairing of %s failed\n", unique_id.c_str());
+            return not_paired();
+        }
+
+        session.verified = true;
+        return xml("<paired>1</paired>");
+    }
+
+    return not_paired();
+}
+
+HttpResponse MockHost::applist(const HttpRequest& request) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!is_paired(request))
+            return xml("", 401, "The client is not authorized");
+    }
+
+    std::string content;
+    content.reserve(m_config.app_count * 96);
+    for (int i = 0; i < m_config.app_count; i++) {
+        content += "<App><IsHdrSupported>" + std::to_string(i % 2) +
+                   "</IsHdrSupported><AppTitle>Mock Game " +
+                   std::to_string(i + 1) + "</AppTitle><ID>" +
+                   std::to_string(APP_ID_BASE + i) + "</ID></App>";
+    }
+    return xml(content);
+}
+
+HttpResponse MockHost::appasset(const HttpRequest& request) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!is_paired(request))
+            return xml("", 401, "The client is not authorized");
+    }
+
+    auto it = request.query.find("appid");
+    int app_id = it == request.query.end() ? 0 : atoi(it->second.c_str());
+    if (app_id < APP_ID_BASE || app_id >= APP_ID_BASE + m_config.app_count)
+        return xml("", 404, "Unknown app");
+
+    HttpResponse response;
+    response.content_type = "image/png";
+    response.body = boxart(app_id);
+    return response;
+}
+
+std::string MockHost::boxart(int app_id) {
+    // 1x1 RGB image in an app specific color
+    std::string png = "\x89PNG\r\n\x1a\n";
+
+    std::string header("\0\0\0\1\0\0\0\1\x08\x02\0\0\0", 13);
+    png_chunk(&png, "IHDR", header);
+
+    unsigned char pixel[] = {0, (unsigned char)(app_id * 53),
+                             (unsigned char)(app_id * 97),
+                             (unsigned char)(app_id * 193)};
+    uint32_t a = 1, b = 0;
+    for (unsigned char c : pixel) {
+        a = (a + c) % 65521;
+        b = (b + a) % 65521;
+    }
+    uint32_t adler = (b << 16) | a;
+
+    // zlib stream with a single stored block
+    std::string idat("\x78\x01\x01\x04\x00\xfb\xff", 7);
+    idat.append((const char*)pixel, sizeof(pixel));
+    for (int shift = 24; shift >= 0; shift -= 8)
+        idat += (char)(adler >> shift);
+    png_chunk(&png, "IDAT", idat);
+
+    // Private ancillary chunk, decoders skip it
+    size_t size = png.size() + 12 + 12;
+    if (m_config.boxart_size > size)
+        png_chunk(&png, "mkPd", std::string(m_config.boxart_size - size, '\0'));
+
+    png_chunk(&png, "IEND", "");
+    return png;
+}
+
+HttpResponse MockHost::launch(const HttpRequest& request, bool resume) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!is_paired(request))
+        return xml("", 401, "The client is not authorized");
+
+    if (resume) {
+        if (m_current_game == 0)
+            return xml("<resume>0</resume>", 503, "No app is running");
+    } else {
+        auto it = request.query.find("appid");
+        int app_id = it == request.query.end() ? 0 : atoi(it->second.c_str());
+        if (app_id < APP_ID_BASE || app_id >= APP_ID_BASE + m_config.app_count)
+            return xml("<gamesession>0</gamesession>", 404, "Unknown app");
+        m_current_game = app_id;
+    }
+
+    std::string session_url =
+        "rtsp://" + request.local_address + ":48010";
+    return xml(std::string(resume ? "<resume>1</resume>" : "") +
+               "<gamesession>1</gamesession><sessionUrl0>" + session_url +
+               "</sessionUrl0>");
+}
+
+HttpResponse MockHost::cancel(const HttpRequest& request) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!is_paired(request))
+        return xml("", 401, "The client is not authorized");
+
+    m_current_game = 0;
+    return xml("<cancel>1</cancel>");
+}
+
+HttpResponse MockHost::unpair(const HttpRequest& request) {
+    auto it = request.query.find("uniqueid");
+    std::string unique_id = it == request.query.end() ? "" : it->second;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pairing.erase(unique_id);
+    for (auto cert = m_paired_certs.begin(); cert != m_paired_certs.end();) {
+        if (cert->second == unique_id)
+            cert = m_paired_certs.erase(cert);
+        else
+            ++cert;
+    }
+    return xml("");
+}
+
+void MockHost::print_stats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    printf("MockHost: %-12s %9s %9s %10s %10s\n", "endpoint", "requests",
+           "failures", "avg ms", "max ms");
+    for (const auto& [endpoint, stats] : m_stats) {
+        printf("MockHost: %-12s %9llu %9llu %10.2f %10.2f\n", endpoint.c_str(),
+               (unsigned long long)stats.requests,
+               (unsigned long long)stats.failures,
+               stats.requests ? stats.total_time_us / 1000.0 / stats.requests
+                              : 0,
+               stats.max_time_us / 1000.0);
+    }
+    printf("MockHost: %d open connections, %d at peak\n",
+           m_server.active_connections(), m_server.peak_connections());
+    fflush(stdout);
+}
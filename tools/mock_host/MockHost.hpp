@@ -0,0 +1,107 @@
+#pragma once
+
+#include "HttpServer.hpp"
+#include <map>
+#include <mutex>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include <random>
+#include <string>
+
+// Endpoint names used in latency / failure rules, "*" matches all
+#define MOCK_ALL_ENDPOINTS "*"
+
+enum MockFailureMode { FAIL_STATUS, FAIL_DROP, FAIL_HANG };
+
+struct MockLatency {
+    int delay_ms = 0;
+    int jitter_ms = 0;
+};
+
+struct MockFailure {
+    double rate = 0;
+    MockFailureMode mode = FAIL_STATUS;
+};
+
+struct MockHostConfig {
+    std::string hostname = "MockHost";
+    std::string mac = "00:11:22:33:44:55";
+    int http_port = 47989;
+    int https_port = 47984;
+    bool sunshine = true;
+
+    int app_count = 10;
+    size_t boxart_size = 0; // Boxart PNGs get padded up to this size
+
+    std::string pin;        // Empty accepts any PIN
+    bool auto_pair = false; // Every client certificate counts as paired
+
+    std::map<std::string, MockLatency> latency;
+    std::map<std::string, MockFailure> failures;
+    unsigned int seed = 0;
+};
+
+// GameStream / Sunshine control plane without any streaming: serverinfo,
+// the pairing handshake, applist, appasset, launch, resume, cancel and
+// unpair, with injected latency and failures per endpoint.
+class MockHost {
+  public:
+    explicit MockHost(const MockHostConfig& config);
+    ~MockHost();
+
+    bool start();
+    void run();
+    void stop();
+
+    // Per endpoint request counts and service times
+    void print_stats();
+
+  private:
+    struct PairingSession {
+        std::string aes_key;
+        std::string client_cert_pem;
+        std::string server_challenge;
+        std::string server_secret;
+        std::string client_hash;
+        bool verified = false;
+    };
+
+    struct EndpointStats {
+        uint64_t requests = 0;
+        uint64_t failures = 0;
+        uint64_t total_time_us = 0;
+        uint64_t max_time_us = 0;
+    };
+
+    HttpResponse handle(const HttpRequest& request);
+    HttpResponse serverinfo(const HttpRequest& request);
+    HttpResponse pair(const HttpRequest& request);
+    HttpResponse applist(const HttpRequest& request);
+    HttpResponse appasset(const HttpRequest& request);
+    HttpResponse launch(const HttpRequest& request, bool resume);
+    HttpResponse cancel(const HttpRequest& request);
+    HttpResponse unpair(const HttpRequest& request);
+
+    bool is_paired(const HttpRequest& request);
+    bool generate_identity();
+    std::string boxart(int app_id);
+
+    template <typename T>
+    const T* rule(const std::map<std::string, T>& rules,
+                  const std::string& endpoint);
+
+    MockHostConfig m_config;
+    HttpServer m_server;
+    SSL_CTX* m_tls = nullptr;
+    EVP_PKEY* m_key = nullptr;
+    X509* m_cert = nullptr;
+    std::string m_cert_pem;
+    std::string m_cert_signature;
+
+    std::mutex m_mutex;
+    std::mt19937 m_random;
+    std::map<std::string, PairingSession> m_pairing;
+    std::map<std::string, std::string> m_paired_certs; // DER -> uniqueid
+    int m_current_game = 0;
+    std::map<std::string, EndpointStats> m_stats;
+};
@@ -0,0 +1,145 @@
+//
+//  Mock GameStream / Sunshine host for control plane tests.
+//
+//  moonlight_mock_host [options]
+//    --hostname=NAME          Host name reported by serverinfo
+//    --http-port=PORT         Default 47989
+//    --https-port=PORT        Default 47984
+//    --gfe                    Report a GeForce Experience host, not Sunshine
+//    --apps=N                 Size of the app library, default 10
+//    --boxart-size=BYTES      Pad boxart images up to BYTES
+//    --pin=PIN                Only accept this PIN, default accepts any
+//    --auto-pair              Treat every client as paired
+//    --latency=[EP:]MS[:JIT]  Delay responses by MS plus up to JIT ms
+//    --fail=[EP:]RATE[:MODE]  Fail RATE (0..1) of requests, MODE is
+//                             status (HTTP 503), drop or hang
+//    --seed=N                 Seed for jitter and failures
+//    --stats=SECONDS          Print endpoint stats periodically
+//
+//  EP is an endpoint name (serverinfo, pair, applist, appasset, launch,
+//  resume, cancel, unpair), rules without one apply to all endpoints.
+//  Stats are printed on exit (Ctrl+C).
+//
+
+#include "MockHost.hpp"
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+static MockHost* host = nullptr;
+
+static void handle_signal(int) {
+    if (host)
+        host->stop();
+}
+
+static bool has_prefix(const std::string& arg, const char* prefix,
+                       std::string* value) {
+    size_t length = strlen(prefix);
+    if (arg.compare(0, length, prefix) != 0)
+        return false;
+    *value = arg.substr(length);
+    return true;
+}
+
+// Splits "[endpoint:]a[:b]" into its parts
+static void parse_rule(const std::string& value, std::string* endpoint,
+                       std::string* first, std::string* second) {
+    std::string rest = value;
+    *endpoint = MOCK_ALL_ENDPOINTS;
+
+    size_t colon = rest.find(':');
+    if (colon != std::string::npos && !isdigit((unsigned char)rest[0]) &&
+        rest[0] != '.') {
+        *endpoint = rest.substr(0, colon);
+        rest = rest.substr(colon + 1);
+        colon = rest.find(':');
+    }
+
+    *first = rest.substr(0, colon);
+    *second = colon == std::string::npos ? "" : rest.substr(colon + 1);
+}
+
+static void print_usage() {
+    printf("Usage: moonlight_mock_host [--hostname=NAME] [--http-port=PORT] "
+           "[--https-port=PORT]\n"
+           "  [--gfe] [--apps=N] [--boxart-size=BYTES] [--pin=PIN] "
+           "[--auto-pair]\n"
+           "  [--latency=[EP:]MS[:JITTER]] [--fail=[EP:]RATE[:status|drop|"
+           "hang]]\n"
+           "  [--seed=N] [--stats=SECONDS]\n");
+}
+
+int main(int argc, char** argv) {
+    MockHostConfig config;
+    int stats_interval = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string value, endpoint, first, second;
+
+        if (has_prefix(arg, "--hostname=", &value)) {
+            config.hostname = value;
+        } else if (has_prefix(arg, "--http-port=", &value)) {
+            config.http_port = atoi(value.c_str());
+        } else if (has_prefix(arg, "--https-port=", &value)) {
+            config.https_port = atoi(value.c_str());
+        } else if (arg == "--gfe") {
+            config.sunshine = false;
+        } else if (has_prefix(arg, "--apps=", &value)) {
+            config.app_count = atoi(value.c_str());
+        } else if (has_prefix(arg, "--boxart-size=", &value)) {
+            config.boxart_size = strtoul(value.c_str(), nullptr, 10);
+        } else if (has_prefix(arg, "--pin=", &value)) {
+            config.pin = value;
+        } else if (arg == "--auto-pair") {
+            config.auto_pair = true;
+        } else if (has_prefix(arg, "--latency=", &value)) {
+            parse_rule(value, &endpoint, &first, &second);
+            config.latency[endpoint] = {atoi(first.c_str()),
+                                        atoi(second.c_str())};
+        } else if (has_prefix(arg, "--fail=", &value)) {
+            parse_rule(value, &endpoint, &first, &second);
+            MockFailure failure;
+            failure.rate = atof(first.c_str());
+            if (second == "drop")
+                failure.mode = FAIL_DROP;
+            else if (second == "hang")
+                failure.mode = FAIL_HANG;
+            config.failures[endpoint] = failure;
+        } else if (has_prefix(arg, "--seed=", &value)) {
+            config.seed = (unsigned int)strtoul(value.c_str(), nullptr, 10);
+        } else if (has_prefix(arg, "--stats=", &value)) {
+            stats_interval = atoi(value.c_str());
+        } else {
+            print_usage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    MockHost mock(config);
+    if (!mock.start())
+        return 1;
+
+    host = &mock;
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+    signal(SIGPIPE, SIG_IGN);
+
+    if (stats_interval > 0) {
+        std::thread([&mock, stats_interval] {
+            while (true) {
+                std::this_thread::sleep_for(
+                    std::chrono::seconds(stats_interval));
+                mock.print_stats();
+            }
+        }).detach();
+    }
+
+    mock.run();
+    mock.print_stats();
+    host = nullptr;
+    return 0;
+}
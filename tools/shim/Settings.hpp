@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+
+// Stands in for the app's settings, the crypto managers only need to know
+// where the client certificate lives
+class Settings {
+  public:
+    static Settings& instance() {
+        static Settings settings;
+        return settings;
+    }
+
+    [[nodiscard]] std::string key_dir() const { return m_key_dir; }
+    void set_key_dir(const std::string& key_dir) { m_key_dir = key_dir; }
+
+  private:
+    std::string m_key_dir = ".";
+};
@@ -0,0 +1,3 @@
+#pragma once
+
+#include "borealis/core/logger.hpp"
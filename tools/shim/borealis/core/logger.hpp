@@ -0,0 +1,25 @@
+#pragma once
+
+// Stands in for the borealis logger, so the libgamestream sources build
+// without the UI library. Logging is dropped, it would skew the timings.
+
+#include <fmt/format.h>
+
+namespace brls {
+
+class Logger {
+  public:
+    template <typename... Args>
+    static void error(fmt::format_string<Args...>, Args&&...) {}
+
+    template <typename... Args>
+    static void warning(fmt::format_string<Args...>, Args&&...) {}
+
+    template <typename... Args>
+    static void info(fmt::format_string<Args...>, Args&&...) {}
+
+    template <typename... Args>
+    static void debug(fmt::format_string<Args...>, Args&&...) {}
+};
+
+} // namespace brls
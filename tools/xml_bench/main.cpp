@@ -0,0 +1,184 @@
+//
+//  Parse time of host responses, one xml_search per field against a single
+//  xml_extract pass.
+//
+//  moonlight_xml_bench [--iterations=N]
+//
+//  The xml_search runs do what load_serverinfo, gs_start_app, gs_quit_app
+//  and the pairing stages did before xml_extract: check the status, then
+//  parse the whole response again for every field.
+//  Then xml_applist parses generated Sunshine libraries of up to 5000 apps,
+//  with the time and heap allocations of each parse.
+//
+
+#include "errors.h"
+#include "payloads.hpp"
+#include "xml.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+// libgamestream's error reporting lives in client.cpp, which needs far
+// more than the XML parser
+static std::string last_error;
+void gs_set_error(std::string error) { last_error = error; }
+std::string gs_error() { return last_error; }
+
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    if (void* memory = malloc(size))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t) noexcept { free(memory); }
+
+struct Response {
+    const char* name;
+    const char* xml;
+    std::vector<const char*> nodes;
+};
+
+static std::vector<Response> responses = {
+    {"gfe serverinfo", gfe_serverinfo,
+     {"currentgame", "PairStatus", "appversion", "state",
+      "ServerCodecModeSupport", "gputype", "GsVersion", "hostname",
+      "GfeVersion", "HttpsPort", "mac"}},
+    {"sunshine serverinfo", sunshine_serverinfo,
+     {"currentgame", "PairStatus", "appversion", "state",
+      "ServerCodecModeSupport", "gputype", "GsVersion", "hostname",
+      "GfeVersion", "HttpsPort", "mac"}},
+    {"launch", launch_response, {"gamesession", "sessionUrl0"}},
+    {"cancel", cancel_response, {"cancel"}},
+    {"pair challenge", pair_challenge_response,
+     {"paired", "challengeresponse"}},
+};
+
+static int search_all(const Data& data, const Response& response,
+                      std::vector<std::string>* values) {
+    if (xml_status(data) != GS_OK)
+        return GS_ERROR;
+
+    for (size_t i = 0; i < response.nodes.size(); i++) {
+        if (xml_search(data, response.nodes[i], &(*values)[i]) != GS_OK)
+            return GS_INVALID;
+    }
+    return GS_OK;
+}
+
+static int extract_all(const Data& data, const Response& response,
+                       std::vector<std::string>* values) {
+    xml_field fields[16];
+    for (size_t i = 0; i < response.nodes.size(); i++)
+        fields[i] = {response.nodes[i], XML_FIELD_STRING, &(*values)[i],
+                     false};
+    return xml_extract(data, fields, response.nodes.size());
+}
+
+static double now_ns() {
+    return std::chrono::duration<double, std::nano>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+template <typename F>
+static double time_per_call(int iterations, F&& call) {
+    double start = now_ns();
+    for (int i = 0; i < iterations; i++)
+        call();
+    return (now_ns() - start) / iterations;
+}
+
+// An applist like Sunshine sends it, with titles of typical length
+static std::string make_applist(int apps) {
+    std::string xml = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+                      "<root status_code=\"200\">";
+    for (int i = 0; i < apps; i++) {
+        xml += "<App><IsHdrSupported>" + std::to_string(i % 3 == 0) +
+               "</IsHdrSupported><AppTitle>Game Title Number " +
+               std::to_string(i) + " &amp; Friends</AppTitle><ID>" +
+               std::to_string(100000 + i) + "</ID></App>";
+    }
+    return xml + "</root>";
+}
+
+static void run_applist(int iterations) {
+    printf("\n%-20s %6s %12s %12s %8s\n", "applist", "apps", "parse",
+           "per app", "allocs");
+
+    for (int apps : {10, 1000, 5000}) {
+        std::string xml = make_applist(apps);
+        Data data((char*)xml.data(), xml.size());
+
+        AppInfoList list;
+        if (xml_applist(data, &list) != GS_OK || (int)list.size() != apps ||
+            list.back().app_id != 100000 + apps - 1 || !list[0].hdr_supported) {
+            fprintf(stderr, "applist of %d apps parsed wrong\n", apps);
+            exit(1);
+        }
+
+        size_t before = allocations;
+        AppInfoList parsed;
+        xml_applist(data, &parsed);
+        size_t allocs = allocations - before;
+
+        int runs = std::max(1, iterations * 10 / apps);
+        double parse = time_per_call(runs, [&] {
+            AppInfoList result;
+            xml_applist(data, &result);
+        });
+
+        printf("%-20s %6d %9.1f us %9.3f us %8zu\n", "", apps, parse / 1000,
+               parse / 1000 / apps, allocs);
+    }
+}
+
+int main(int argc, char** argv) {
+    int iterations = 20000;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--iterations=", 13) == 0) {
+            iterations = std::max(1, atoi(argv[i] + 13));
+        } else {
+            printf("Usage: moonlight_xml_bench [--iterations=N]\n");
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    printf("%-20s %6s %12s %12s %8s\n", "response", "fields", "xml_search",
+           "xml_extract", "speedup");
+
+    for (auto& response : responses) {
+        Data data((char*)response.xml, strlen(response.xml));
+        std::vector<std::string> searched(response.nodes.size());
+        std::vector<std::string> extracted(response.nodes.size());
+
+        if (search_all(data, response, &searched) != GS_OK ||
+            extract_all(data, response, &extracted) != GS_OK ||
+            searched != extracted) {
+            fprintf(stderr, "%s: results differ\n", response.name);
+            return 1;
+        }
+
+        double search = time_per_call(iterations, [&] {
+            search_all(data, response, &searched);
+        });
+        double extract = time_per_call(iterations, [&] {
+            extract_all(data, response, &extracted);
+        });
+
+        printf("%-20s %6zu %9.2f us %9.2f us %7.1fx\n", response.name,
+               response.nodes.size(), search / 1000, extract / 1000,
+               search / extract);
+    }
+
+    run_applist(iterations);
+    return 0;
+}
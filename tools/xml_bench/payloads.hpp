@@ -0,0 +1,113 @@
+#pragma once
+
+// Responses as real hosts send them, identifiers and keys replaced
+
+// GeForce Experience 3.27 serverinfo over HTTPS, paired
+static const char* const gfe_serverinfo =
+    "<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"no\"?>\n"
+    "<root protocol_version=\"0.1\" query=\"serverinfo\" status_code=\"200\" "
+    "status_message=\"OK\">\n"
+    "<hostname>DESKTOP-GAMING</hostname>\n"
+    "<appversion>7.1.450.0</appversion>\n"
+    "<GfeVersion>3.27.0.120</GfeVersion>\n"
+    "<uniqueid>9A1B6E1C-2D6F-4F43-8A2B-1E2F3A4B5C6D</uniqueid>\n"
+    "<HttpsPort>47984</HttpsPort>\n"
+    "<ExternalPort>47989</ExternalPort>\n"
+    "<MaxLumaPixelsHEVC>1869449984</MaxLumaPixelsHEVC>\n"
+    "<mac>2c:f0:5d:11:22:33</mac>\n"
+    "<Permission>4294967295</Permission>\n"
+    "<LocalIP>192.168.1.10</LocalIP>\n"
+    "<ServerCodecModeSupport>3843</ServerCodecModeSupport>\n"
+    "<SupportedDisplayMode>\n"
+    "<DisplayMode><Width>3840</Width><Height>2160</Height>"
+    "<RefreshRate>120</RefreshRate></DisplayMode>\n"
+    "<DisplayMode><Width>2560</Width><Height>1440</Height>"
+    "<RefreshRate>144</RefreshRate></DisplayMode>\n"
+    "<DisplayMode><Width>1920</Width><Height>1080</Height>"
+    "<RefreshRate>60</RefreshRate></DisplayMode>\n"
+    "<DisplayMode><Width>1280</Width><Height>720</Height>"
+    "<RefreshRate>60</RefreshRate></DisplayMode>\n"
+    "</SupportedDisplayMode>\n"
+    "<PairStatus>1</PairStatus>\n"
+    "<currentgame>0</currentgame>\n"
+    "<state>MJOLNIR_STATE_SERVER_AVAILABLE</state>\n"
+    "<numofapps>12</numofapps>\n"
+    "<gputype>NVIDIA GeForce RTX 3080</gputype>\n"
+    "<GsVersion>7.1.450.0</GsVersion>\n"
+    "</root>\n";
+
+// Sunshine 0.23 serverinfo over HTTPS, paired
+static const char* const sunshine_serverinfo =
+    "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+    "<root status_code=\"200\"><hostname>living-room</hostname>"
+    "<appversion>7.1.431.-1</appversion><GfeVersion>3.23.0.74</GfeVersion>"
+    "<uniqueid>4FA64E9394060E40B603E4FE2F082A49</uniqueid>"
+    "<HttpsPort>47984</HttpsPort><ExternalPort>47989</ExternalPort>"
+    "<MaxLumaPixelsHEVC>1869449984</MaxLumaPixelsHEVC>"
+    "<mac>00:1a:2b:3c:4d:5e</mac><Permission>4294967295</Permission>"
+    "<LocalIP>192.168.1.20</LocalIP>"
+    "<ServerCodecModeSupport>259</ServerCodecModeSupport>"
+    "<PairStatus>1</PairStatus><currentgame>0</currentgame>"
+    "<state>SUNSHINE_SERVER_FREE</state></root>";
+
+static const char* const launch_response =
+    "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+    "<root status_code=\"200\" status_message=\"OK\">"
+    "<sessionUrl0>rtsp://192.168.1.10:48010</sessionUrl0>"
+    "<gamesession>1</gamesession></root>";
+
+static const char* const cancel_response =
+    "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+    "<root status_code=\"200\" status_message=\"OK\">"
+    "<cancel>1</cancel></root>";
+
+static const char* const pair_challenge_response =
+    "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+    "<root status_code=\"200\"><paired>1</paired>"
+    "<challengeresponse>D44FB1E048AE396E3B40468DC7D47218D8B5A66F1045DC7EC2DD3A8A"
+    "8EC9AEFCD28CD23F8FD20B75C63AE67F39D817FE</challengeresponse></root>";
+
+// Sunshine 0.23 applist
+static const char* const sunshine_applist =
+    "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+    "<root status_code=\"200\">"
+    "<App><IsHdrSupported>0</IsHdrSupported><AppTitle>Desktop</AppTitle>"
+    "<ID>881448767</ID></App>"
+    "<App><IsHdrSupported>1</IsHdrSupported><AppTitle>Steam Big Picture"
+    "</AppTitle><ID>1093255277</ID></App>"
+    "<App><IsHdrSupported>1</IsHdrSupported><AppTitle>Cyberpunk 2077"
+    "</AppTitle><ID>1245307894</ID></App>"
+    "<App><IsHdrSupported>0</IsHdrSupported><AppTitle>Hades</AppTitle>"
+    "<ID>1392021154</ID></App>"
+    "<App><IsHdrSupported>1</IsHdrSupported><AppTitle>Forza Horizon 5"
+    "</AppTitle><ID>1574823305</ID></App>"
+    "<App><IsHdrSupported>0</IsHdrSupported><AppTitle>Stardew Valley"
+    "</AppTitle><ID>1696434522</ID></App>"
+    "<App><IsHdrSupported>0</IsHdrSupported><AppTitle>Terminal</AppTitle>"
+    "<ID>1823511370</ID></App>"
+    "</root>";
+
+// GeForce Experience 3.27 applist
+static const char* const gfe_applist =
+    "<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"no\"?>\n"
+    "<root protocol_version=\"0.1\" query=\"applist\" status_code=\"200\" "
+    "status_message=\"OK\">\n"
+    "<App>\n<AppInstallPath>C:\\Program Files (x86)\\Steam\\</AppInstallPath>\n"
+    "<AppTitle>Steam</AppTitle>\n<CmsId>100021711</CmsId>\n"
+    "<IsAppCollectorGame>0</IsAppCollectorGame>\n"
+    "<IsHdrSupported>0</IsHdrSupported>\n<ID>1093255277</ID>\n"
+    "<MaxControllersForSingleSession>4</MaxControllersForSingleSession>\n"
+    "<SupportsStandardAudio>1</SupportsStandardAudio>\n</App>\n"
+    "<App>\n<AppInstallPath>D:\\Games\\Control\\</AppInstallPath>\n"
+    "<AppTitle>Control</AppTitle>\n<CmsId>100589211</CmsId>\n"
+    "<IsAppCollectorGame>1</IsAppCollectorGame>\n"
+    "<IsHdrSupported>1</IsHdrSupported>\n<ID>298465521</ID>\n"
+    "<MaxControllersForSingleSession>1</MaxControllersForSingleSession>\n"
+    "<SupportsStandardAudio>1</SupportsStandardAudio>\n</App>\n"
+    "<App>\n<AppInstallPath>D:\\Games\\Witcher 3\\</AppInstallPath>\n"
+    "<AppTitle>The Witcher 3: Wild Hunt</AppTitle>\n<CmsId>100112511</CmsId>\n"
+    "<IsAppCollectorGame>1</IsAppCollectorGame>\n"
+    "<IsHdrSupported>0</IsHdrSupported>\n<ID>372103611</ID>\n"
+    "<MaxControllersForSingleSession>1</MaxControllersForSingleSession>\n"
+    "<SupportsStandardAudio>1</SupportsStandardAudio>\n</App>\n"
+    "</root>\n";